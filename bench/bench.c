@@ -0,0 +1,117 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "config.h"
+
+#define BENCH_SAMPLES 15
+#define BENCH_SAMPLES_SLOW 3
+#define BENCH_MIN_SAMPLE_US 10000
+// Single calls slower than this are only sampled BENCH_SAMPLES_SLOW times
+#define BENCH_SLOW_CALL_US 1000000
+
+static FILE *results_fp = NULL;
+
+static gint64 bench_time_iterations(BenchFunc func, gpointer user_data, guint iterations);
+static int compare_doubles(const void *a, const void *b);
+
+void bench_init(void)
+{
+    const char *results_path = g_getenv("JUMPDF_BENCH_RESULTS");
+
+    g_config = config_new();
+    config_load_default(g_config);
+
+    if (results_path != NULL) {
+        results_fp = fopen(results_path, "a");
+        if (results_fp == NULL) {
+            g_printerr("Could not open \"%s\" for appending benchmark results\n", results_path);
+        }
+    }
+}
+
+void bench_finish(void)
+{
+    if (results_fp != NULL) {
+        fclose(results_fp);
+        results_fp = NULL;
+    }
+
+    config_destroy(g_config);
+    free(g_config);
+    g_config = NULL;
+}
+
+void bench_run(const char *name, BenchFunc func, gpointer user_data)
+{
+    guint iterations = 1;
+    int n_samples = BENCH_SAMPLES;
+    double samples[BENCH_SAMPLES];
+    double sum = 0.0;
+    gint64 elapsed;
+    gchar *line = NULL;
+
+    // Warm up, and grow the batch until one sample is long enough to time reliably
+    elapsed = bench_time_iterations(func, user_data, iterations);
+    while (elapsed < BENCH_MIN_SAMPLE_US && iterations < G_MAXUINT / 2) {
+        iterations *= 2;
+        elapsed = bench_time_iterations(func, user_data, iterations);
+    }
+
+    if (elapsed / iterations > BENCH_SLOW_CALL_US) {
+        n_samples = BENCH_SAMPLES_SLOW;
+    }
+
+    for (int i = 0; i < n_samples; i++) {
+        samples[i] = bench_time_iterations(func, user_data, iterations) * 1000.0 / iterations;
+        sum += samples[i];
+    }
+
+    qsort(samples, n_samples, sizeof(double), compare_doubles);
+
+    line = g_strdup_printf(
+        "{\"benchmark\": \"%s\", \"iterations\": %u, \"min_ns\": %.1f, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"max_ns\": %.1f}",
+        name, iterations * n_samples, samples[0], samples[n_samples / 2],
+        sum / n_samples, samples[n_samples - 1]);
+
+    g_print("%s\n", line);
+    if (results_fp != NULL) {
+        fprintf(results_fp, "%s\n", line);
+    }
+
+    g_free(line);
+}
+
+ViewerMarkManager *bench_new_full_mark_manager(ViewerInfo *info)
+{
+    ViewerMarkGroup *groups[NUM_GROUPS];
+    ViewerCursor *cursors[NUM_MARKS];
+
+    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+        for (unsigned int j = 0; j < NUM_MARKS; j++) {
+            cursors[j] = viewer_cursor_new(info, i * NUM_MARKS + j, 0.0, j, 1.0 + 0.1 * j, TRUE, FALSE, 0);
+        }
+
+        groups[i] = viewer_mark_group_new(cursors, 0, 0);
+    }
+
+    return viewer_mark_manager_new(groups, 0, 0);
+}
+
+static gint64 bench_time_iterations(BenchFunc func, gpointer user_data, guint iterations)
+{
+    gint64 start = g_get_monotonic_time();
+
+    for (guint i = 0; i < iterations; i++) {
+        func(user_data);
+    }
+
+    return g_get_monotonic_time() - start;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
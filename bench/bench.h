@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glib.h>
+
+#include "viewer_mark_manager.h"
+
+typedef void (*BenchFunc)(gpointer user_data);
+
+void bench_init(void);
+void bench_finish(void);
+
+/*
+* Runs func repeatedly and prints one JSON object per line to stdout:
+* {"benchmark": name, "iterations": n, "min_ns": ..., "median_ns": ..., "mean_ns": ..., "max_ns": ...}
+* where the *_ns values are per call. If JUMPDF_BENCH_RESULTS is set, the
+* line is also appended to that file, for tracking regressions across runs.
+*/
+void bench_run(const char *name, BenchFunc func, gpointer user_data);
+
+ViewerMarkManager *bench_new_full_mark_manager(ViewerInfo *info);
@@ -0,0 +1,145 @@
+#include <glib/gstdio.h>
+
+#include "bench.h"
+#include "database.h"
+
+#define BENCH_URI "file:///tmp/jumpdf-bench.pdf"
+#define BENCH_FINGERPRINT "bench"
+#define BENCH_TEXT_PAGES 1000
+// Only on every 100th page of the indexed text
+#define BENCH_TEXT_QUERY "needle 7"
+
+typedef struct {
+    Database *db;
+    ViewerMarkManager *manager;
+    // What database_save_mark_manager compares against
+    ViewerMarkManager *saved;
+} DatabaseBench;
+
+static void bench_update_mark_manager(gpointer user_data);
+static void bench_save_mark_manager_changes(gpointer user_data);
+static void bench_get_mark_manager(gpointer user_data);
+static void bench_index_text(Database *db);
+static void bench_find_text_pages(gpointer user_data);
+static void bench_remove_journal(const char *db_filename, const char *suffix);
+
+int main(void)
+{
+    GError *error = NULL;
+    gchar *tmp_dir = NULL;
+    gchar *db_filename = NULL;
+    DatabaseBench bench;
+
+    bench_init();
+
+    tmp_dir = g_dir_make_tmp("jumpdf-bench-XXXXXX", &error);
+    if (tmp_dir == NULL) {
+        g_printerr("Could not create temporary directory: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    db_filename = g_build_filename(tmp_dir, "jumpdf.db", NULL);
+    bench.db = database_open(db_filename);
+    database_check_update(bench.db, db_filename);
+
+    bench.manager = bench_new_full_mark_manager(NULL);
+    database_insert_mark_manager(bench.db, BENCH_URI, bench.manager);
+
+    bench_run("database_update_mark_manager", bench_update_mark_manager, &bench);
+    bench.saved = viewer_mark_manager_copy_deep(bench.manager);
+    bench_run("database_save_mark_manager_changes", bench_save_mark_manager_changes, &bench);
+    viewer_mark_manager_destroy(bench.saved);
+    bench_run("database_get_mark_manager", bench_get_mark_manager, &bench);
+    bench_index_text(bench.db);
+    bench_run("database_find_text_pages", bench_find_text_pages, &bench);
+
+    viewer_mark_manager_destroy(bench.manager);
+    database_close(bench.db);
+    free(bench.db);
+
+    g_remove(db_filename);
+    // Normally removed when the last connection closes
+    bench_remove_journal(db_filename, "-wal");
+    bench_remove_journal(db_filename, "-shm");
+    g_rmdir(tmp_dir);
+    g_free(db_filename);
+    g_free(tmp_dir);
+
+    bench_finish();
+
+    return 0;
+}
+
+static void bench_update_mark_manager(gpointer user_data)
+{
+    DatabaseBench *bench = user_data;
+    ViewerCursor *cursor = viewer_mark_manager_get_current_cursor(bench->manager);
+
+    cursor->y_offset += 1.0;
+    database_update_mark_manager(bench->db, BENCH_URI, bench->manager);
+}
+
+/* One moved cursor, as saved by the database writer thread */
+static void bench_save_mark_manager_changes(gpointer user_data)
+{
+    DatabaseBench *bench = user_data;
+    ViewerCursor *cursor = viewer_mark_manager_get_current_cursor(bench->manager);
+
+    cursor->y_offset += 1.0;
+    database_save_mark_manager(bench->db, BENCH_URI, bench->manager, bench->saved);
+    viewer_mark_manager_get_current_cursor(bench->saved)->y_offset = cursor->y_offset;
+}
+
+static void bench_get_mark_manager(gpointer user_data)
+{
+    DatabaseBench *bench = user_data;
+    ViewerMarkManager *manager = database_get_mark_manager(bench->db, BENCH_URI);
+
+    // Also frees manager
+    viewer_mark_manager_destroy(manager);
+}
+
+/* Pages of filler text, with a numbered needle on every 10th one */
+static void bench_index_text(Database *db)
+{
+    GString *text = g_string_new(NULL);
+    sqlite3_int64 document_id;
+    int indexed_pages;
+
+    document_id = database_get_text_document(db, BENCH_FINGERPRINT, BENCH_URI, BENCH_TEXT_PAGES, &indexed_pages);
+    database_begin(db);
+    for (int i = 0; i < BENCH_TEXT_PAGES; i++) {
+        g_string_truncate(text, 0);
+        for (int j = 0; j < 200; j++) {
+            g_string_append_printf(text, "lorem ipsum %d dolor\n", i * j);
+        }
+        if (i % 10 == 0) {
+            g_string_append_printf(text, "needle %d", i / 10 % 10);
+        }
+        database_insert_page_text(db, document_id, i, text->str);
+    }
+    database_set_indexed_pages(db, document_id, BENCH_TEXT_PAGES);
+    database_commit(db);
+
+    g_string_free(text, TRUE);
+}
+
+static void bench_find_text_pages(gpointer user_data)
+{
+    DatabaseBench *bench = user_data;
+    int indexed_pages;
+    GArray *pages = database_find_text_pages(bench->db, BENCH_FINGERPRINT, BENCH_TEXT_QUERY, &indexed_pages);
+
+    if (pages != NULL) {
+        g_array_unref(pages);
+    }
+}
+
+static void bench_remove_journal(const char *db_filename, const char *suffix)
+{
+    gchar *journal_filename = g_strconcat(db_filename, suffix, NULL);
+
+    g_remove(journal_filename);
+    g_free(journal_filename);
+}
@@ -0,0 +1,246 @@
+#include "bench.h"
+#include "renderer.h"
+#include "viewer.h"
+#include "outline.h"
+#include "toc_filter.h"
+
+/* Must match CORPUS_SEARCH_NEEDLE in corpus.c */
+#define BENCH_SEARCH_NEEDLE "zyxwvutsrq"
+#define BENCH_SCROLL_STEPS 1
+#define BENCH_TOC_QUERY "section 12"
+
+typedef struct {
+    const char *uri;
+    Viewer *viewer;
+    Renderer *renderer;
+    Outline *outline;
+    // outline as cached in the database
+    GVariant *outline_variant;
+} DocumentBench;
+
+static Viewer *bench_open_viewer(const char *uri);
+static void bench_close_viewer(Viewer *viewer);
+
+static void bench_open(gpointer user_data);
+static void bench_outline(gpointer user_data);
+static void bench_outline_cached(gpointer user_data);
+static void bench_toc_filter(gpointer user_data);
+static void bench_find_section(gpointer user_data);
+static void bench_search(gpointer user_data);
+static void bench_follow_links(gpointer user_data);
+static void bench_link_hit_test(gpointer user_data);
+static void bench_scroll(gpointer user_data);
+
+/* Usage: bench_document <corpus pdf>... as written by jumpdf-corpus */
+int main(int argc, char *argv[])
+{
+    DocumentBench bench;
+    gchar *basename = NULL;
+    gchar *name = NULL;
+
+    bench_init();
+
+    for (int i = 1; i < argc; i++) {
+        basename = g_path_get_basename(argv[i]);
+        bench.uri = g_filename_to_uri(argv[i], NULL, NULL);
+        bench.viewer = bench_open_viewer(bench.uri);
+        if (bench.viewer == NULL) {
+            g_free(basename);
+            g_free((gchar *)bench.uri);
+            continue;
+        }
+        bench.renderer = renderer_new(NULL, NULL);
+
+        name = g_strdup_printf("open/%s", basename);
+        bench_run(name, bench_open, &bench);
+        g_free(name);
+
+        name = g_strdup_printf("scroll/%s", basename);
+        bench_run(name, bench_scroll, &bench);
+        g_free(name);
+
+        if (g_strcmp0(basename, "outline.pdf") == 0) {
+            bench_run("outline/outline.pdf", bench_outline, &bench);
+
+            bench.outline = outline_new(bench.viewer->info->doc);
+            bench.outline_variant = g_variant_ref_sink(outline_to_variant(bench.outline));
+            bench_run("outline_cached/outline.pdf", bench_outline_cached, &bench);
+            g_variant_unref(bench.outline_variant);
+            bench_run("toc_filter/outline.pdf", bench_toc_filter, &bench);
+            bench_run("find_section/outline.pdf", bench_find_section, &bench);
+            outline_unref(bench.outline);
+        } else if (g_strcmp0(basename, "text.pdf") == 0) {
+            bench_run("search/text.pdf", bench_search, &bench);
+        } else if (g_strcmp0(basename, "links.pdf") == 0) {
+            bench_run("follow_links/links.pdf", bench_follow_links, &bench);
+            bench_run("link_hit_test/links.pdf", bench_link_hit_test, &bench);
+        }
+
+        renderer_destroy(bench.renderer);
+        free(bench.renderer);
+        bench_close_viewer(bench.viewer);
+        g_free((gchar *)bench.uri);
+        g_free(basename);
+    }
+
+    bench_finish();
+
+    return 0;
+}
+
+static Viewer *bench_open_viewer(const char *uri)
+{
+    GError *error = NULL;
+    PopplerDocument *doc = poppler_document_new_from_file(uri, NULL, &error);
+    ViewerInfo *info = NULL;
+    ViewerCursor *cursor = NULL;
+    Viewer *viewer = NULL;
+
+    if (doc == NULL) {
+        g_printerr("Error opening document: %s\n", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    info = viewer_info_new(doc);
+    info->view_width = 1920;
+    info->view_height = 1080;
+    cursor = viewer_cursor_new(info, 0, 0.0, 0.0, 1.0, TRUE, FALSE, 0);
+    viewer = viewer_new(info, cursor, viewer_search_new(), viewer_links_new());
+    viewer_update_current_page_size(viewer);
+
+    return viewer;
+}
+
+static void bench_close_viewer(Viewer *viewer)
+{
+    viewer_destroy(viewer);
+    free(viewer);
+}
+
+static void bench_open(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+
+    bench_close_viewer(bench_open_viewer(bench->uri));
+}
+
+static void bench_outline(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+
+    outline_unref(outline_new(bench->viewer->info->doc));
+}
+
+/* What reopening a document costs instead of bench_outline */
+static void bench_outline_cached(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+
+    outline_unref(outline_new_from_variant(bench->outline_variant));
+}
+
+/* Types the query one character at a time, as into the TOC search entry */
+static void bench_toc_filter(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    TocFilter filter;
+    gchar *query;
+
+    toc_filter_init(&filter, bench->outline);
+    for (size_t i = 1; i <= strlen(BENCH_TOC_QUERY); i++) {
+        query = g_strndup(BENCH_TOC_QUERY, i);
+        g_array_free(toc_filter_match(&filter, query), TRUE);
+        g_free(query);
+    }
+    toc_filter_destroy(&filter);
+}
+
+/* Looks up the section at a few points of every page, as scrolling through the document would */
+static void bench_find_section(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    ViewerInfo *info = bench->viewer->info;
+
+    for (int i = 0; i < info->n_pages; i++) {
+        for (double top = info->max_page_height; top >= 0; top -= info->max_page_height / 8) {
+            outline_find_section(bench->outline, i, top);
+        }
+    }
+}
+
+static void bench_search(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    ViewerSearch *search = bench->viewer->search;
+    ViewerCursor *result = NULL;
+
+    if (search->search_text == NULL) {
+        search->search_text = g_strdup(BENCH_SEARCH_NEEDLE);
+    }
+    search->last_goto_page = -1;
+    bench->viewer->cursor->current_page = 0;
+
+    result = viewer_search_get_next_search(search, bench->viewer->cursor);
+    if (result != NULL) {
+        viewer_cursor_destroy(result);
+        free(result);
+    }
+}
+
+static void bench_follow_links(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    ViewerInfo *info = bench->viewer->info;
+
+    for (int i = 0; i < info->n_pages; i++) {
+        viewer_links_get_links(bench->viewer->links, viewer_info_get_link_map(info, i));
+    }
+    viewer_links_clear_links(bench->viewer->links);
+}
+
+/* Hit tests a grid of points over every page, as hovering the mouse would */
+static void bench_link_hit_test(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    ViewerInfo *info = bench->viewer->info;
+    LinkMap *link_map;
+
+    for (int i = 0; i < info->n_pages; i++) {
+        link_map = viewer_info_get_link_map(info, i);
+        for (double y = 0; y < info->pages[i]->height; y += 8.0) {
+            for (double x = 0; x < info->pages[i]->width; x += 8.0) {
+                link_map_hit_test(link_map, x, y);
+            }
+        }
+    }
+}
+
+/* Scroll one step and synchronously render whatever the renderer requests */
+static void bench_scroll(gpointer user_data)
+{
+    DocumentBench *bench = user_data;
+    Viewer *viewer = bench->viewer;
+    ViewerCursor *cursor = viewer->cursor;
+    RenderRequest request;
+    cairo_surface_t *surface;
+
+    if (cursor->current_page == viewer->info->n_pages - 1) {
+        cursor->current_page = 0;
+        cursor->y_offset = 0;
+    }
+
+    cursor->y_offset += BENCH_SCROLL_STEPS;
+    viewer_cursor_handle_offset_update(cursor);
+    viewer_update_current_page_size(viewer);
+
+    request = renderer_generate_request(bench->renderer, viewer);
+    if (request.render_from < 0 || request.render_to < 0) {
+        return;
+    }
+
+    for (int i = request.render_from; i <= request.render_to; i++) {
+        surface = renderer_render_page_surface(bench->renderer, viewer, viewer->info->pages[i], cursor->scale, 0, 0);
+        cairo_surface_destroy(surface);
+    }
+}
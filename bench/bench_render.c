@@ -0,0 +1,133 @@
+#include <cairo-pdf.h>
+#include <glib/gstdio.h>
+
+#include "bench.h"
+#include "config.h"
+#include "renderer.h"
+#include "viewer.h"
+
+#define BENCH_PAGE_WIDTH 612.0
+#define BENCH_PAGE_HEIGHT 792.0
+
+typedef struct {
+    Renderer *renderer;
+    Viewer *viewer;
+    double scale;
+} RenderBench;
+
+static const double scales[] = {0.5, 1.0, 2.0, 4.0};
+
+static void bench_write_pdf(const char *filename);
+static void bench_render_page(gpointer user_data);
+
+int main(void)
+{
+    GError *error = NULL;
+    gchar *tmp_dir = NULL;
+    gchar *pdf_filename = NULL;
+    gchar *pdf_uri = NULL;
+    gchar *name = NULL;
+    PopplerDocument *doc = NULL;
+    ViewerInfo *info = NULL;
+    ViewerCursor *cursor = NULL;
+    Viewer *viewer = NULL;
+    RenderBench bench;
+
+    bench_init();
+
+    tmp_dir = g_dir_make_tmp("jumpdf-bench-XXXXXX", &error);
+    if (tmp_dir == NULL) {
+        g_printerr("Could not create temporary directory: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    pdf_filename = g_build_filename(tmp_dir, "render.pdf", NULL);
+    bench_write_pdf(pdf_filename);
+
+    pdf_uri = g_filename_to_uri(pdf_filename, NULL, NULL);
+    doc = poppler_document_new_from_file(pdf_uri, NULL, &error);
+    if (doc == NULL) {
+        g_printerr("Error opening document: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    info = viewer_info_new(doc);
+    cursor = viewer_cursor_new(info, 0, 0.0, 0.0, 1.0, TRUE, FALSE, 0);
+    viewer = viewer_new(info, cursor, viewer_search_new(), viewer_links_new());
+    viewer_update_current_page_size(viewer);
+
+    bench.renderer = renderer_new(NULL, NULL);
+    bench.viewer = viewer;
+
+    for (size_t i = 0; i < G_N_ELEMENTS(scales); i++) {
+        bench.scale = scales[i];
+        name = g_strdup_printf("renderer_render_page_surface/scale=%.1f", scales[i]);
+        bench_run(name, bench_render_page, &bench);
+        g_free(name);
+    }
+
+    // The first call records the page, later ones replay the recording
+    config_set_record_pages(g_config, true);
+    for (size_t i = 0; i < G_N_ELEMENTS(scales); i++) {
+        bench.scale = scales[i];
+        name = g_strdup_printf("renderer_render_page_surface/recorded/scale=%.1f", scales[i]);
+        bench_run(name, bench_render_page, &bench);
+        g_free(name);
+    }
+
+    renderer_destroy(bench.renderer);
+    free(bench.renderer);
+    viewer_destroy(viewer);
+    free(viewer);
+
+    g_remove(pdf_filename);
+    g_rmdir(tmp_dir);
+    g_free(pdf_uri);
+    g_free(pdf_filename);
+    g_free(tmp_dir);
+
+    bench_finish();
+
+    return 0;
+}
+
+/* A single page of text and vector shapes, similar in cost to a textbook page */
+static void bench_write_pdf(const char *filename)
+{
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, BENCH_PAGE_WIDTH, BENCH_PAGE_HEIGHT);
+    cairo_t *cr = cairo_create(surface);
+    gchar *line = NULL;
+
+    cairo_select_font_face(cr, "Serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 10.0);
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+
+    for (int i = 0; i < 60; i++) {
+        line = g_strdup_printf("%d. The quick brown fox jumps over the lazy dog, again and again and again.", i + 1);
+        cairo_move_to(cr, 72.0, 72.0 + i * 10.5);
+        cairo_show_text(cr, line);
+        g_free(line);
+    }
+
+    for (int i = 0; i < 200; i++) {
+        cairo_move_to(cr, 72.0 + (i % 20) * 23.0, 720.0);
+        cairo_curve_to(cr, 80.0 + i, 700.0, 90.0 + i, 760.0, 100.0 + (i % 40) * 11.0, 740.0);
+    }
+    cairo_set_line_width(cr, 0.5);
+    cairo_stroke(cr);
+
+    cairo_show_page(cr);
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+static void bench_render_page(gpointer user_data)
+{
+    RenderBench *bench = user_data;
+    cairo_surface_t *surface = renderer_render_page_surface(bench->renderer, bench->viewer,
+        bench->viewer->info->pages[0], bench->scale, 0, 0);
+
+    cairo_surface_destroy(surface);
+}
@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "renderer.h"
+#include "viewer.h"
+
+#define BENCH_N_PAGES 10000
+
+typedef struct {
+    Viewer *viewer;
+    Renderer *renderer;
+} RequestBench;
+
+static void bench_get_visible_pages(gpointer user_data);
+static void bench_generate_request_scroll(gpointer user_data);
+static void bench_generate_request_zoom(gpointer user_data);
+static void bench_switch_mark(gpointer user_data);
+static void bench_switch_to_previous_mark(gpointer user_data);
+static void bench_switch_group(gpointer user_data);
+static void bench_switch_to_previous_group(gpointer user_data);
+
+int main(void)
+{
+    ViewerInfo info = {
+        .doc = NULL,
+        .pages = NULL,
+        .n_pages = BENCH_N_PAGES,
+        .view_width = 1920,
+        .view_height = 1080,
+        .min_page_width = 612.0,
+        .min_page_height = 792.0,
+        .max_page_width = 612.0,
+        .max_page_height = 792.0,
+    };
+    ViewerCursor cursor;
+    ViewerSearch search;
+    ViewerLinks links;
+    Viewer viewer;
+    RequestBench request_bench;
+    ViewerMarkManager *manager;
+
+    bench_init();
+
+    viewer_cursor_init(&cursor, &info, BENCH_N_PAGES / 2, 0.0, 0.0, 1.0, TRUE, FALSE, 0);
+    viewer_search_init(&search);
+    viewer_links_init(&links);
+    viewer_init(&viewer, &info, &cursor, &search, &links);
+
+    bench_run("viewer_cursor_get_visible_pages", bench_get_visible_pages, &cursor);
+
+    request_bench.viewer = &viewer;
+    request_bench.renderer = renderer_new(NULL, NULL);
+    bench_run("renderer_generate_request/scroll", bench_generate_request_scroll, &request_bench);
+    bench_run("renderer_generate_request/zoom", bench_generate_request_zoom, &request_bench);
+    renderer_destroy(request_bench.renderer);
+    free(request_bench.renderer);
+
+    manager = bench_new_full_mark_manager(&info);
+    bench_run("viewer_mark_manager_switch_mark", bench_switch_mark, manager);
+    bench_run("viewer_mark_manager_switch_to_previous_mark", bench_switch_to_previous_mark, manager);
+    bench_run("viewer_mark_manager_switch_group", bench_switch_group, manager);
+    bench_run("viewer_mark_manager_switch_to_previous_group", bench_switch_to_previous_group, manager);
+    viewer_mark_manager_destroy(manager);
+
+    viewer_links_destroy(&links);
+    bench_finish();
+
+    return 0;
+}
+
+static void bench_get_visible_pages(gpointer user_data)
+{
+    ViewerCursor *cursor = user_data;
+    int from, to;
+
+    cursor->current_page = (cursor->current_page + 1) % cursor->info->n_pages;
+    viewer_cursor_get_visible_pages(cursor, &from, &to);
+}
+
+static void bench_generate_request_scroll(gpointer user_data)
+{
+    RequestBench *bench = user_data;
+    ViewerCursor *cursor = bench->viewer->cursor;
+
+    cursor->current_page = (cursor->current_page + 1) % cursor->info->n_pages;
+    renderer_generate_request(bench->renderer, bench->viewer);
+}
+
+static void bench_generate_request_zoom(gpointer user_data)
+{
+    RequestBench *bench = user_data;
+    ViewerCursor *cursor = bench->viewer->cursor;
+
+    cursor->scale = cursor->scale < 2.0 ? cursor->scale + 0.1 : 0.5;
+    renderer_generate_request(bench->renderer, bench->viewer);
+}
+
+static void bench_switch_mark(gpointer user_data)
+{
+    ViewerMarkManager *manager = user_data;
+    unsigned int next_mark = (viewer_mark_manager_get_current_mark_index(manager) + 1) % NUM_MARKS;
+
+    viewer_mark_manager_switch_mark(manager, next_mark);
+}
+
+static void bench_switch_to_previous_mark(gpointer user_data)
+{
+    viewer_mark_manager_switch_to_previous_mark(user_data);
+}
+
+static void bench_switch_group(gpointer user_data)
+{
+    ViewerMarkManager *manager = user_data;
+    unsigned int next_group = (viewer_mark_manager_get_current_group_index(manager) + 1) % NUM_GROUPS;
+
+    viewer_mark_manager_switch_group(manager, next_group);
+}
+
+static void bench_switch_to_previous_group(gpointer user_data)
+{
+    viewer_mark_manager_switch_to_previous_group(user_data);
+}
@@ -0,0 +1,404 @@
+/*
+* Generates synthetic stress documents with cairo's PDF surface, so that
+* performance problems can be reproduced without the original PDFs.
+* Usage: jumpdf-corpus <output_dir>
+* Output is deterministic, as all content comes from fixed-seed generators.
+*/
+
+#include <errno.h>
+#include <cairo-pdf.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#define CORPUS_SEED 0x6a756d70
+#define CORPUS_MARGIN 72.0
+#define CORPUS_FONT_SIZE 10.0
+#define CORPUS_LINE_HEIGHT 12.0
+
+/* Appears only on the last page of text.pdf, for worst-case search timing */
+#define CORPUS_SEARCH_NEEDLE "zyxwvutsrq"
+
+#define TEXT_N_PAGES 10000
+#define TEXT_LINES_PER_PAGE 40
+
+#define SCANS_N_PAGES 100
+#define SCANS_DPI 150
+
+#define LINKS_N_BODY_PAGES 50
+#define LINKS_PER_BODY_PAGE 150
+#define LINKS_REFERENCES_PER_PAGE 60
+
+#define OUTLINE_N_CHAPTERS 200
+#define OUTLINE_SECTIONS_PER_CHAPTER 10
+#define OUTLINE_SUBSECTIONS_PER_SECTION 3
+
+#define MIXED_N_PAGES 500
+
+typedef struct {
+    double width;
+    double height;
+} PageSize;
+
+static const PageSize mixed_sizes[] = {
+    {595.0, 842.0},  // A4
+    {612.0, 792.0},  // Letter
+    {842.0, 1191.0}, // A3
+    {842.0, 595.0},  // A4 landscape
+    {420.0, 595.0},  // A5
+    {226.0, 1200.0}, // Receipt
+};
+
+static const char *words[] = {
+    "lemma", "theorem", "proof", "definition", "corollary", "space", "measure",
+    "function", "bounded", "continuous", "compact", "sequence", "converges",
+    "integral", "operator", "linear", "vector", "norm", "metric", "open", "closed",
+    "set", "the", "of", "and", "is", "a", "for", "every", "there", "exists", "such",
+    "that", "then", "hence", "by", "we", "have", "let", "be", "an", "element",
+};
+
+static void corpus_write_text(const char *filename);
+static void corpus_write_scans(const char *filename);
+static void corpus_write_links(const char *filename);
+static void corpus_write_outline(const char *filename);
+static void corpus_write_mixed(const char *filename);
+
+static cairo_t *corpus_create_cairo(cairo_surface_t *surface);
+static void corpus_finish(cairo_t *cr, cairo_surface_t *surface);
+static void corpus_show_random_line(cairo_t *cr, GRand *rand, double x, double y, double max_width);
+static cairo_surface_t *corpus_create_scan_image(GRand *rand, int width, int height);
+
+typedef void (*CorpusWriter)(const char *filename);
+
+typedef struct {
+    const char *name;
+    CorpusWriter write;
+} CorpusDocument;
+
+static const CorpusDocument documents[] = {
+    {"text.pdf", corpus_write_text},
+    {"scans.pdf", corpus_write_scans},
+    {"links.pdf", corpus_write_links},
+    {"outline.pdf", corpus_write_outline},
+    {"mixed.pdf", corpus_write_mixed},
+};
+
+int main(int argc, char *argv[])
+{
+    gchar *filename = NULL;
+
+    if (argc != 2) {
+        g_printerr("Usage: %s <output_dir>\n", argv[0]);
+        return 1;
+    }
+
+    if (g_mkdir_with_parents(argv[1], 0755) == -1) {
+        g_printerr("Could not create \"%s\": %s\n", argv[1], g_strerror(errno));
+        return 1;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(documents); i++) {
+        filename = g_build_filename(argv[1], documents[i].name, NULL);
+        g_print("Generating %s\n", filename);
+        documents[i].write(filename);
+        g_free(filename);
+    }
+
+    return 0;
+}
+
+/* Long plain text document, for open time, search and scrolling */
+static void corpus_write_text(const char *filename)
+{
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, 612.0, 792.0);
+    cairo_t *cr = corpus_create_cairo(surface);
+    GRand *rand = g_rand_new_with_seed(CORPUS_SEED);
+
+    for (int page = 0; page < TEXT_N_PAGES; page++) {
+        for (int line = 0; line < TEXT_LINES_PER_PAGE; line++) {
+            corpus_show_random_line(cr, rand, CORPUS_MARGIN, CORPUS_MARGIN + line * CORPUS_LINE_HEIGHT, 612.0 - 2 * CORPUS_MARGIN);
+        }
+
+        if (page == TEXT_N_PAGES - 1) {
+            cairo_move_to(cr, CORPUS_MARGIN, 792.0 - CORPUS_MARGIN);
+            cairo_show_text(cr, CORPUS_SEARCH_NEEDLE);
+        }
+
+        cairo_show_page(cr);
+    }
+
+    g_rand_free(rand);
+    corpus_finish(cr, surface);
+}
+
+/* Every page is a full-page raster image, like a scanned book */
+static void corpus_write_scans(const char *filename)
+{
+    const double page_width = 612.0;
+    const double page_height = 792.0;
+    const int image_width = page_width / 72.0 * SCANS_DPI;
+    const int image_height = page_height / 72.0 * SCANS_DPI;
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, page_width, page_height);
+    cairo_t *cr = corpus_create_cairo(surface);
+    GRand *rand = g_rand_new_with_seed(CORPUS_SEED);
+    cairo_surface_t *image = NULL;
+
+    for (int page = 0; page < SCANS_N_PAGES; page++) {
+        image = corpus_create_scan_image(rand, image_width, image_height);
+
+        cairo_save(cr);
+        cairo_scale(cr, page_width / image_width, page_height / image_height);
+        cairo_set_source_surface(cr, image, 0.0, 0.0);
+        cairo_paint(cr);
+        cairo_restore(cr);
+
+        cairo_surface_destroy(image);
+        cairo_show_page(cr);
+    }
+
+    g_rand_free(rand);
+    corpus_finish(cr, surface);
+}
+
+/*
+* Body pages dense with citation links to named destinations in a
+* bibliography, plus external URI links, for follow links mode
+*/
+static void corpus_write_links(const char *filename)
+{
+    const double page_width = 612.0;
+    const double page_height = 792.0;
+    const int links_per_row = 10;
+    const int n_references = LINKS_N_BODY_PAGES * LINKS_PER_BODY_PAGE / 4;
+    const int n_reference_pages = (n_references + LINKS_REFERENCES_PER_PAGE - 1) / LINKS_REFERENCES_PER_PAGE;
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, page_width, page_height);
+    cairo_t *cr = corpus_create_cairo(surface);
+    GRand *rand = g_rand_new_with_seed(CORPUS_SEED);
+    gchar *attributes = NULL;
+    gchar *text = NULL;
+    int reference = 0;
+    double x, y;
+
+    for (int page = 0; page < LINKS_N_BODY_PAGES; page++) {
+        for (int i = 0; i < LINKS_PER_BODY_PAGE; i++) {
+            x = CORPUS_MARGIN + (i % links_per_row) * 46.0;
+            y = CORPUS_MARGIN + (i / links_per_row) * 3 * CORPUS_LINE_HEIGHT;
+
+            if (i % 25 == 24) {
+                attributes = g_strdup_printf("uri='https://example.org/%d/%d'", page, i);
+                text = g_strdup("[url]");
+            } else {
+                reference = g_rand_int_range(rand, 0, n_references);
+                attributes = g_strdup_printf("dest='ref%d'", reference);
+                text = g_strdup_printf("[%d]", reference + 1);
+            }
+
+            cairo_move_to(cr, x, y);
+            cairo_tag_begin(cr, CAIRO_TAG_LINK, attributes);
+            cairo_show_text(cr, text);
+            cairo_tag_end(cr, CAIRO_TAG_LINK);
+
+            corpus_show_random_line(cr, rand, CORPUS_MARGIN, y + CORPUS_LINE_HEIGHT, page_width - 2 * CORPUS_MARGIN);
+
+            g_free(attributes);
+            g_free(text);
+        }
+
+        cairo_show_page(cr);
+    }
+
+    reference = 0;
+    for (int page = 0; page < n_reference_pages; page++) {
+        for (int i = 0; i < LINKS_REFERENCES_PER_PAGE && reference < n_references; i++, reference++) {
+            y = CORPUS_MARGIN + i * CORPUS_LINE_HEIGHT;
+            attributes = g_strdup_printf("name='ref%d' y=%f", reference, y);
+            text = g_strdup_printf("[%d]", reference + 1);
+
+            cairo_tag_begin(cr, CAIRO_TAG_DEST, attributes);
+            cairo_move_to(cr, CORPUS_MARGIN, y);
+            cairo_show_text(cr, text);
+            cairo_tag_end(cr, CAIRO_TAG_DEST);
+
+            corpus_show_random_line(cr, rand, CORPUS_MARGIN + 40.0, y, page_width - 2 * CORPUS_MARGIN - 40.0);
+
+            g_free(attributes);
+            g_free(text);
+        }
+
+        cairo_show_page(cr);
+    }
+
+    g_rand_free(rand);
+    corpus_finish(cr, surface);
+}
+
+/*
+* An outline with thousands of nested entries. Sections point to named
+* destinations, subsections to explicit page positions
+*/
+static void corpus_write_outline(const char *filename)
+{
+    const double page_width = 612.0;
+    const double page_height = 792.0;
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, page_width, page_height);
+    cairo_t *cr = corpus_create_cairo(surface);
+    GRand *rand = g_rand_new_with_seed(CORPUS_SEED);
+    gchar *title = NULL;
+    gchar *attributes = NULL;
+    int chapter_id, section_id;
+    int page = 0;
+    double y;
+
+    for (int c = 0; c < OUTLINE_N_CHAPTERS; c++) {
+        title = g_strdup_printf("Chapter %d", c + 1);
+        attributes = g_strdup_printf("page=%d", page + 1);
+        chapter_id = cairo_pdf_surface_add_outline(surface, CAIRO_PDF_OUTLINE_ROOT, title, attributes, 0);
+        g_free(title);
+        g_free(attributes);
+
+        for (int s = 0; s < OUTLINE_SECTIONS_PER_CHAPTER; s++, page++) {
+            title = g_strdup_printf("Section %d.%d", c + 1, s + 1);
+            attributes = g_strdup_printf("name='sec%d.%d'", c + 1, s + 1);
+
+            cairo_tag_begin(cr, CAIRO_TAG_DEST, attributes);
+            cairo_move_to(cr, CORPUS_MARGIN, CORPUS_MARGIN);
+            cairo_show_text(cr, title);
+            cairo_tag_end(cr, CAIRO_TAG_DEST);
+            g_free(attributes);
+
+            attributes = g_strdup_printf("dest='sec%d.%d'", c + 1, s + 1);
+            section_id = cairo_pdf_surface_add_outline(surface, chapter_id, title, attributes, 0);
+            g_free(title);
+            g_free(attributes);
+
+            for (int ss = 0; ss < OUTLINE_SUBSECTIONS_PER_SECTION; ss++) {
+                y = CORPUS_MARGIN + (ss + 1) * (page_height - 2 * CORPUS_MARGIN) / (OUTLINE_SUBSECTIONS_PER_SECTION + 1);
+                title = g_strdup_printf("Subsection %d.%d.%d", c + 1, s + 1, ss + 1);
+                attributes = g_strdup_printf("page=%d pos=[%f %f]", page + 1, CORPUS_MARGIN, y);
+
+                cairo_move_to(cr, CORPUS_MARGIN, y);
+                cairo_show_text(cr, title);
+                corpus_show_random_line(cr, rand, CORPUS_MARGIN, y + CORPUS_LINE_HEIGHT, page_width - 2 * CORPUS_MARGIN);
+                cairo_pdf_surface_add_outline(surface, section_id, title, attributes, 0);
+
+                g_free(title);
+                g_free(attributes);
+            }
+
+            cairo_show_page(cr);
+        }
+    }
+
+    g_rand_free(rand);
+    corpus_finish(cr, surface);
+}
+
+/* Cycles through very different page sizes, for min/max page size handling */
+static void corpus_write_mixed(const char *filename)
+{
+    cairo_surface_t *surface = cairo_pdf_surface_create(filename, mixed_sizes[0].width, mixed_sizes[0].height);
+    cairo_t *cr = corpus_create_cairo(surface);
+    GRand *rand = g_rand_new_with_seed(CORPUS_SEED);
+    PageSize size;
+    int n_lines;
+
+    for (int page = 0; page < MIXED_N_PAGES; page++) {
+        size = mixed_sizes[page % G_N_ELEMENTS(mixed_sizes)];
+        cairo_pdf_surface_set_size(surface, size.width, size.height);
+
+        n_lines = (size.height - 2 * CORPUS_MARGIN) / CORPUS_LINE_HEIGHT;
+        for (int line = 0; line < n_lines; line++) {
+            corpus_show_random_line(cr, rand, CORPUS_MARGIN / 2, CORPUS_MARGIN + line * CORPUS_LINE_HEIGHT, size.width - CORPUS_MARGIN);
+        }
+
+        cairo_show_page(cr);
+    }
+
+    g_rand_free(rand);
+    corpus_finish(cr, surface);
+}
+
+static cairo_t *corpus_create_cairo(cairo_surface_t *surface)
+{
+    cairo_t *cr = cairo_create(surface);
+
+    cairo_select_font_face(cr, "Serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, CORPUS_FONT_SIZE);
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+
+    return cr;
+}
+
+static void corpus_finish(cairo_t *cr, cairo_surface_t *surface)
+{
+    cairo_destroy(cr);
+    cairo_surface_finish(surface);
+
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+        g_printerr("cairo: %s\n", cairo_status_to_string(cairo_surface_status(surface)));
+    }
+
+    cairo_surface_destroy(surface);
+}
+
+static void corpus_show_random_line(cairo_t *cr, GRand *rand, double x, double y, double max_width)
+{
+    GString *line = g_string_new(NULL);
+    cairo_text_extents_t extents;
+
+    // Assume an average of 5 points per character to avoid measuring every word
+    while (line->len * 5.0 < max_width) {
+        if (line->len > 0) {
+            g_string_append_c(line, ' ');
+        }
+        g_string_append(line, words[g_rand_int_range(rand, 0, G_N_ELEMENTS(words))]);
+    }
+
+    cairo_text_extents(cr, line->str, &extents);
+    while (extents.x_advance > max_width && line->len > 0) {
+        g_string_truncate(line, line->len - 1);
+        cairo_text_extents(cr, line->str, &extents);
+    }
+
+    cairo_move_to(cr, x, y);
+    cairo_show_text(cr, line->str);
+
+    g_string_free(line, TRUE);
+}
+
+/* Off-white paper with runs of dark "words" on every text line and some speckles */
+static cairo_surface_t *corpus_create_scan_image(GRand *rand, int width, int height)
+{
+    const int line_height = 24;
+    const int margin = width / 10;
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    cairo_t *cr = cairo_create(image);
+    int word_width;
+    int x;
+
+    cairo_set_source_rgb(cr, 0.95, 0.94, 0.91);
+    cairo_paint(cr);
+
+    cairo_set_source_rgb(cr, 0.15, 0.15, 0.15);
+    for (int y = margin; y < height - margin; y += line_height) {
+        x = margin;
+        while (TRUE) {
+            word_width = g_rand_int_range(rand, line_height, 4 * line_height);
+            if (x + word_width > width - margin) {
+                break;
+            }
+
+            cairo_rectangle(cr, x, y, word_width, line_height / 2);
+            x += word_width + g_rand_int_range(rand, line_height / 3, line_height);
+        }
+    }
+    cairo_fill(cr);
+
+    for (int i = 0; i < width * height / 500; i++) {
+        cairo_rectangle(cr, g_rand_int_range(rand, 0, width), g_rand_int_range(rand, 0, height), 1, 1);
+    }
+    cairo_fill(cr);
+
+    cairo_destroy(cr);
+
+    return image;
+}
@@ -1,17 +1,47 @@
 #include <gtk/gtk.h>
+#include <glib-unix.h>
+#include <signal.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include "app.h"
 #include "project_config.h"
 #include "config.h"
 #include "utils.h"
 #include "database.h"
+#include "database_writer.h"
+#include "fingerprint.h"
+#include "text_indexer.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "metrics.h"
+#include "replay.h"
+#include "automation.h"
+#include "surface_pool.h"
 
 static void window_update_cursor_cb(gpointer win_ptr, gpointer user_data);
 static void window_redraw_cb(gpointer win_ptr, gpointer user_data);
-static void database_update_mark_manager_cb(gpointer uri_ptr, gpointer manager_ptr, gpointer user_data);
+static void window_update_statusline_cb(gpointer win_ptr, gpointer user_data);
+static gboolean on_save_timeout(gpointer user_data);
+static gboolean on_memory_budget_idle(gpointer user_data);
+static gboolean on_text_indexed(gpointer user_data);
+static Window *app_open_window(App *app, GFile *file);
 
 static void on_file_dialog_response(GObject *source_object, GAsyncResult *res, gpointer user_data);
+static void app_start_replay(App *app, Window *win);
+static gboolean on_sigusr1(gpointer user_data);
+static void on_low_memory_warning(GMemoryMonitor *monitor, GMemoryMonitorWarningLevel level, gpointer user_data);
+static void app_shed_memory(App *app, bool suspend_background, bool release_pages);
+static void app_release_recordings(App *app);
+static gssize app_get_resident_bytes(void);
+
+static const GOptionEntry option_entries[] = {
+    {"trace", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL, "Write a Chrome trace of the render pipeline to FILE on exit. Same as setting JUMPDF_TRACE", "FILE"},
+    {"record", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL, "Record key presses with timestamps to FILE", "FILE"},
+    {"replay", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL, "Replay the key presses recorded in FILE, print a latency report and quit", "FILE"},
+    {"replay-speed", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, NULL, "Multiplier for the recorded pace of --replay, 0 replays as fast as possible. Defaults to 1", "FACTOR"},
+    {NULL, 0, 0, 0, NULL, NULL, NULL}
+};
 
 struct _App {
     GtkApplication parent;
@@ -25,6 +55,24 @@ struct _App {
     GHashTable *uri_mark_manager_map;
     GPtrArray *windows;
     Database *db;
+    DatabaseWriter *db_writer;
+    // URIs of mark managers changed since they were last saved
+    GHashTable *dirty_uris;
+    guint save_source_id;
+    guint memory_budget_source_id;
+    // NULL if index_text is disabled or the database has no text index
+    TextIndexer *text_indexer;
+    RenderScheduler *render_scheduler;
+    // NULL if pages are rendered in this process
+    RenderProcessPool *render_processes;
+    guint sigusr1_source_id;
+    guint automation_registration_id;
+    GMemoryMonitor *memory_monitor;
+
+    KeyRecorder *key_recorder;
+    gchar *replay_path;
+    double replay_speed;
+    KeyReplayer *key_replayer;
 };
 
 G_DEFINE_TYPE(App, app, GTK_TYPE_APPLICATION)
@@ -40,39 +88,186 @@ int app_run(int argc, char *argv[])
 
 static void app_init(App *app)
 {
-    gchar *db_filename = NULL;
-
     g_config = config_new();
     config_load(g_config);
 
-    db_filename = g_build_filename(g_get_user_data_dir(), APP_NAME_STR, "jumpdf.db", NULL);
-    ensure_path_exists(db_filename);
-    app->db = database_open(db_filename);
-    database_check_update(app->db, db_filename);
-    g_free(db_filename);
+    trace_init(g_getenv("JUMPDF_TRACE"));
+    g_application_add_main_option_entries(G_APPLICATION(app), option_entries);
+    automation_add_actions(app);
+
+    // Created in app_startup, which a launch forwarding its files to a running instance doesn't run
+    app->db = NULL;
+    app->db_writer = NULL;
+    app->text_indexer = NULL;
+    app->render_scheduler = NULL;
+    app->render_processes = NULL;
+    app->dirty_uris = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    app->save_source_id = 0;
+    app->memory_budget_source_id = 0;
 
     app->uri_mark_manager_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)viewer_mark_manager_destroy);
     app->windows = g_ptr_array_new();
+
+    app->key_recorder = NULL;
+    app->replay_path = NULL;
+    app->replay_speed = 1.0;
+    app->key_replayer = NULL;
 }
 
 static void app_finalize(GObject *object)
 {
     App *app = JUMPDF_APP(object);
 
-    app_update_database_mark_managers(app);
+    watchdog_stop();
+    if (app->sigusr1_source_id != 0) {
+        g_source_remove(app->sigusr1_source_id);
+    }
+    if (app->memory_budget_source_id != 0) {
+        g_source_remove(app->memory_budget_source_id);
+    }
+    if (app->memory_monitor != NULL) {
+        g_signal_handlers_disconnect_by_func(app->memory_monitor, on_low_memory_warning, app);
+        g_object_unref(app->memory_monitor);
+    }
+
+    if (app->key_recorder != NULL) {
+        key_recorder_destroy(app->key_recorder);
+        free(app->key_recorder);
+    }
+
+    if (app->key_replayer != NULL) {
+        key_replayer_destroy(app->key_replayer);
+        free(app->key_replayer);
+    }
+    g_free(app->replay_path);
+
+    if (app->db_writer != NULL) {
+        app_save_mark_managers(app);
+        database_writer_destroy(app->db_writer);
+        free(app->db_writer);
+    }
+    if (app->text_indexer != NULL) {
+        text_indexer_destroy(app->text_indexer);
+        free(app->text_indexer);
+    }
+    g_hash_table_destroy(app->dirty_uris);
     g_hash_table_destroy(app->uri_mark_manager_map);
 
     g_ptr_array_free(app->windows, TRUE);
 
-    database_close(app->db);
-    free(app->db);
+    // All renderers are destroyed with their windows by now
+    if (app->render_scheduler != NULL) {
+        render_scheduler_destroy(app->render_scheduler);
+        free(app->render_scheduler);
+    }
+    if (app->render_processes != NULL) {
+        render_process_pool_destroy(app->render_processes);
+        free(app->render_processes);
+    }
+
+    if (app->db != NULL) {
+        database_close(app->db);
+        free(app->db);
+    }
 
     config_destroy(g_config);
     free(g_config);
 
+    trace_finish();
+
     G_OBJECT_CLASS(app_parent_class)->finalize(object);
 }
 
+static gint app_handle_local_options(GApplication *app, GVariantDict *options)
+{
+    App *self = JUMPDF_APP(app);
+    gchar *trace_path = NULL;
+    gchar *record_path = NULL;
+
+    if (g_variant_dict_lookup(options, "trace", "^ay", &trace_path)) {
+        trace_init(trace_path);
+        g_free(trace_path);
+    }
+
+    if (g_variant_dict_lookup(options, "record", "^ay", &record_path)) {
+        self->key_recorder = key_recorder_new(record_path);
+        g_free(record_path);
+        if (self->key_recorder == NULL) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (g_variant_dict_lookup(options, "replay", "^ay", &self->replay_path)) {
+        g_variant_dict_lookup(options, "replay-speed", "d", &self->replay_speed);
+        if (self->replay_speed < 0) {
+            g_printerr("--replay-speed must be greater than or equal to 0\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Keys are only seen by the process that shows the windows, so don't forward to a running instance
+    if (self->key_recorder != NULL || self->replay_path != NULL) {
+        g_application_set_flags(app, g_application_get_flags(app) | G_APPLICATION_NON_UNIQUE);
+    }
+
+    // Continue with the default processing
+    return -1;
+}
+
+static void app_startup(GApplication *app)
+{
+    App *self = JUMPDF_APP(app);
+    gchar *db_filename = NULL;
+
+    G_APPLICATION_CLASS(app_parent_class)->startup(app);
+
+    db_filename = g_build_filename(g_get_user_data_dir(), APP_NAME_STR, "jumpdf.db", NULL);
+    ensure_path_exists(db_filename);
+    self->db = database_open(db_filename);
+    database_check_update(self->db, db_filename);
+    self->db_writer = database_writer_new(db_filename);
+    // Off the main thread, as it checks whether every document still exists
+    database_writer_collect_garbage(self->db_writer, g_config->max_documents);
+    if (g_config->index_text && database_has_text_index(self->db)) {
+        self->text_indexer = text_indexer_new(db_filename, on_text_indexed, app);
+    }
+    g_free(db_filename);
+
+    self->render_scheduler = render_scheduler_new(g_config->render_threads);
+    if (g_config->render_processes > 0) {
+        self->render_processes = render_process_pool_new(g_config->render_processes, g_config->render_timeout_ms);
+    }
+
+    // Only the primary instance runs the main loop, so it is the only one watched
+    watchdog_start(g_config->stall_threshold_ms);
+
+    self->sigusr1_source_id = g_unix_signal_add(SIGUSR1, on_sigusr1, app);
+
+    self->memory_monitor = g_memory_monitor_dup_default();
+    g_signal_connect(self->memory_monitor, "low-memory-warning", G_CALLBACK(on_low_memory_warning), app);
+}
+
+static gboolean app_dbus_register(GApplication *app, GDBusConnection *connection, const gchar *object_path, GError **error)
+{
+    if (!G_APPLICATION_CLASS(app_parent_class)->dbus_register(app, connection, object_path, error)) {
+        return FALSE;
+    }
+
+    JUMPDF_APP(app)->automation_registration_id = automation_register(JUMPDF_APP(app), connection, object_path, error);
+
+    return JUMPDF_APP(app)->automation_registration_id != 0;
+}
+
+static void app_dbus_unregister(GApplication *app, GDBusConnection *connection, const gchar *object_path)
+{
+    if (JUMPDF_APP(app)->automation_registration_id != 0) {
+        g_dbus_connection_unregister_object(connection, JUMPDF_APP(app)->automation_registration_id);
+        JUMPDF_APP(app)->automation_registration_id = 0;
+    }
+
+    G_APPLICATION_CLASS(app_parent_class)->dbus_unregister(app, connection, object_path);
+}
+
 static void app_activate(GApplication *app)
 {
     app_open_file_chooser(JUMPDF_APP(app));
@@ -83,29 +278,32 @@ static void app_open(GApplication *app, GFile **files, int n_files,
 {
     UNUSED(hint);
 
-    ViewerMarkManager *mark_manager;
     Window *win;
     GPtrArray *new_windows = g_ptr_array_sized_new(n_files);
 
     for (int i = 0; i < n_files; i++) {
-        mark_manager = app_get_mark_manager(JUMPDF_APP(app), files[i]);
-        if (mark_manager != NULL) {
-            win = window_new(JUMPDF_APP(app));
+        win = app_open_window(JUMPDF_APP(app), files[i]);
+        if (win != NULL) {
             g_ptr_array_add(new_windows, win);
-
-            window_open(win, files[i], mark_manager);
-            gtk_window_present(GTK_WINDOW(win));
         }
     }
 
+    if (JUMPDF_APP(app)->replay_path != NULL && JUMPDF_APP(app)->key_replayer == NULL && new_windows->len > 0) {
+        app_start_replay(JUMPDF_APP(app), g_ptr_array_index(new_windows, 0));
+    }
+
     g_ptr_array_extend_and_steal(JUMPDF_APP(app)->windows, new_windows);
 }
 
 static void app_class_init(AppClass *class)
 {
     G_OBJECT_CLASS(class)->finalize = app_finalize;
+    G_APPLICATION_CLASS(class)->startup = app_startup;
     G_APPLICATION_CLASS(class)->activate = app_activate;
     G_APPLICATION_CLASS(class)->open = app_open;
+    G_APPLICATION_CLASS(class)->handle_local_options = app_handle_local_options;
+    G_APPLICATION_CLASS(class)->dbus_register = app_dbus_register;
+    G_APPLICATION_CLASS(class)->dbus_unregister = app_dbus_unregister;
 }
 
 App *app_new(void)
@@ -125,18 +323,44 @@ ViewerMarkManager *app_get_mark_manager(App *app, GFile *file)
     ViewerMarkManager *mark_manager = NULL;
     ViewerMarkManager *mark_manager_memory = NULL;
     ViewerMarkManager *mark_manager_db = NULL;
+    const char *previous_operation = NULL;
+    gchar *fingerprint = NULL;
+    GVariant *page_sizes = NULL;
 
-    info = viewer_info_new_from_gfile(file);
+    uri = g_file_get_uri(file);
+    fingerprint = fingerprint_new_from_gfile(file);
+    if (fingerprint != NULL) {
+        page_sizes = database_get_metadata(app->db, fingerprint, DATABASE_METADATA_PAGE_SIZES,
+            G_VARIANT_TYPE(VIEWER_INFO_PAGE_SIZES_TYPE));
+    }
+
+    previous_operation = watchdog_enter("viewer_info_new_from_gfile");
+    info = viewer_info_new_from_gfile(file, fingerprint, page_sizes);
+    watchdog_leave(previous_operation);
     if (info == NULL) {
         g_free(uri);
+        g_free(fingerprint);
+        if (page_sizes != NULL) {
+            g_variant_unref(page_sizes);
+        }
         return NULL;
     }
 
-    uri = g_file_get_uri(file);
+    // Sizes are cached by content, so reopening skips loading every page
+    if (fingerprint != NULL && page_sizes == NULL) {
+        database_writer_put_metadata(app->db_writer, fingerprint, uri, DATABASE_METADATA_PAGE_SIZES,
+            viewer_info_page_sizes_to_variant(info));
+    }
+    g_free(fingerprint);
+    if (page_sizes != NULL) {
+        g_variant_unref(page_sizes);
+    }
+
     mark_manager_memory = g_hash_table_lookup(JUMPDF_APP(app)->uri_mark_manager_map, uri);
     if (mark_manager_memory == NULL) {
-        app_update_database_mark_managers(JUMPDF_APP(app));
+        previous_operation = watchdog_enter("database_get_mark_manager");
         mark_manager_db = database_get_mark_manager(app->db, uri);
+        watchdog_leave(previous_operation);
 
         if (mark_manager_db == NULL) {
             groups = malloc(NUM_GROUPS * sizeof(ViewerMarkGroup *));
@@ -153,11 +377,11 @@ ViewerMarkManager *app_get_mark_manager(App *app, GFile *file)
 
             mark_manager = viewer_mark_manager_new(groups, 0, 0);
             free(groups);
-
-            database_insert_mark_manager(app->db, uri, mark_manager);
         } else {
             mark_manager = mark_manager_db;
         }
+        // Saved even if unchanged, as saving records when it was last opened
+        app_mark_dirty(app, uri);
 
         g_hash_table_insert(JUMPDF_APP(app)->uri_mark_manager_map,
             uri, mark_manager);
@@ -188,6 +412,42 @@ ViewerMarkManager *app_get_mark_manager(App *app, GFile *file)
     return mark_manager;
 }
 
+Window *app_open_at_page(App *app, GFile *file, int page)
+{
+    Window *win = app_present(app, file);
+
+    if (win != NULL) {
+        window_goto_page(win, page);
+    }
+
+    return win;
+}
+
+Window *app_present(App *app, GFile *file)
+{
+    gchar *uri = g_file_get_uri(file);
+    Window *win = NULL;
+
+    for (guint i = 0; i < app->windows->len && win == NULL; i++) {
+        if (g_strcmp0(window_get_uri(g_ptr_array_index(app->windows, i)), uri) == 0) {
+            win = g_ptr_array_index(app->windows, i);
+        }
+    }
+    g_free(uri);
+
+    if (win == NULL) {
+        win = app_open_window(app, file);
+        if (win == NULL) {
+            return NULL;
+        }
+        g_ptr_array_add(app->windows, win);
+    }
+
+    gtk_window_present(GTK_WINDOW(win));
+
+    return win;
+}
+
 void app_remove_window(App *app, Window *win)
 {
     g_ptr_array_remove_fast(app->windows, win);
@@ -203,10 +463,35 @@ void app_redraw_windows(App *app)
     g_ptr_array_foreach(app->windows, window_redraw_cb, NULL);
 }
 
-void app_update_database_mark_managers(App *app)
+void app_mark_dirty(App *app, const char *uri)
+{
+    g_hash_table_add(app->dirty_uris, g_strdup(uri));
+
+    // Not pushed back by later changes, so continuous scrolling is still saved
+    if (app->save_source_id == 0) {
+        app->save_source_id = g_timeout_add(APP_SAVE_DELAY_MS, on_save_timeout, app);
+    }
+}
+
+void app_save_mark_managers(App *app)
 {
-    g_hash_table_foreach(app->uri_mark_manager_map,
-        (GHFunc)database_update_mark_manager_cb, app);
+    GHashTableIter iter;
+    gpointer uri;
+    ViewerMarkManager *manager;
+
+    if (app->save_source_id != 0) {
+        g_source_remove(app->save_source_id);
+        app->save_source_id = 0;
+    }
+
+    g_hash_table_iter_init(&iter, app->dirty_uris);
+    while (g_hash_table_iter_next(&iter, &uri, NULL)) {
+        manager = g_hash_table_lookup(app->uri_mark_manager_map, uri);
+        if (manager != NULL) {
+            database_writer_save(app->db_writer, uri, viewer_mark_manager_copy_deep(manager));
+        }
+    }
+    g_hash_table_remove_all(app->dirty_uris);
 }
 
 void app_open_file_chooser(App *app)
@@ -224,6 +509,130 @@ void app_open_file_chooser(App *app)
     gtk_file_dialog_open_multiple(file_dialog, NULL, NULL, (GAsyncReadyCallback)on_file_dialog_response, app);
 }
 
+Database *app_get_database(App *app)
+{
+    return app->db;
+}
+
+DatabaseWriter *app_get_database_writer(App *app)
+{
+    return app->db_writer;
+}
+
+TextIndexer *app_get_text_indexer(App *app)
+{
+    return app->text_indexer;
+}
+
+RenderScheduler *app_get_render_scheduler(App *app)
+{
+    return app->render_scheduler;
+}
+
+RenderProcessPool *app_get_render_process_pool(App *app)
+{
+    return app->render_processes;
+}
+
+KeyRecorder *app_get_key_recorder(App *app)
+{
+    return app->key_recorder;
+}
+
+void app_enforce_memory_budget(App *app)
+{
+    // Not while drawing, shedding would drop the pages of the window being drawn
+    if (g_config->memory_budget_mb != 0 && app->memory_budget_source_id == 0) {
+        app->memory_budget_source_id = g_idle_add(on_memory_budget_idle, app);
+    }
+}
+
+static void app_shed_memory(App *app, bool suspend_background, bool release_pages)
+{
+    GtkWindow *active = gtk_application_get_active_window(GTK_APPLICATION(app));
+
+    for (guint i = 0; i < app->windows->len; i++) {
+        Window *win = g_ptr_array_index(app->windows, i);
+        Viewer *viewer = window_get_viewer(win);
+        Renderer *renderer = window_get_renderer(win);
+
+        // Without a focused window, any of them may be the one on screen
+        if (suspend_background && active != NULL && GTK_WINDOW(win) != active) {
+            renderer_suspend(renderer, viewer);
+        } else {
+            renderer_evict_prefetched(renderer, viewer);
+        }
+
+        // Pages that are still rendered keep their poppler page
+        if (release_pages) {
+            viewer_info_release_poppler_pages(viewer->info);
+        }
+    }
+}
+
+/* Drops the recordings of the pages each window doesn't show */
+static void app_release_recordings(App *app)
+{
+    int from, to;
+
+    for (guint i = 0; i < app->windows->len; i++) {
+        Viewer *viewer = window_get_viewer(g_ptr_array_index(app->windows, i));
+
+        viewer_cursor_get_visible_pages(viewer->cursor, &from, &to);
+        viewer_info_release_recordings(viewer->info, from, to);
+    }
+}
+
+/* Page surfaces and recordings, what memory_budget_mb limits */
+static gssize app_get_resident_bytes(void)
+{
+    return renderer_get_total_resident_bytes() + page_get_total_recording_bytes();
+}
+
+void app_dump_metrics(App *app)
+{
+    GString *json = g_string_new(NULL);
+    GHashTableIter iter;
+    gpointer uri, manager;
+    gchar *path = NULL;
+    bool first = true;
+
+    g_string_append_printf(json, "{\"pid\": %d, \"timestamp_us\": %" G_GINT64_FORMAT ", \"threads\": %d",
+        getpid(), g_get_real_time(), metrics_get_thread_count());
+
+    g_string_append(json, ",\n\"database\": ");
+    metrics_append_file_size(json, app->db->path);
+
+    g_string_append(json, ",\n\"documents\": [");
+    g_hash_table_iter_init(&iter, app->uri_mark_manager_map);
+    while (g_hash_table_iter_next(&iter, &uri, &manager)) {
+        g_string_append(json, first ? "\n" : ",\n");
+        metrics_append_mark_manager(json, uri, manager);
+        first = false;
+    }
+
+    g_string_append(json, "],\n\"windows\": [");
+    for (guint i = 0; i < app->windows->len; i++) {
+        g_string_append(json, i == 0 ? "\n" : ",\n");
+        metrics_append_window(json, g_ptr_array_index(app->windows, i));
+    }
+
+    g_string_append(json, "],\n\"surface_pool\": ");
+    metrics_append_surface_pool(json);
+
+    g_string_append(json, ",\n\"latency\": ");
+    metrics_append_latency(json);
+    g_string_append(json, "}\n");
+
+    path = metrics_write(json->str);
+    if (path != NULL) {
+        g_print("Metrics written to %s\n", path);
+        g_free(path);
+    }
+
+    g_string_free(json, TRUE);
+}
+
 static void window_update_cursor_cb(gpointer win_ptr, gpointer user_data)
 {
     UNUSED(user_data);
@@ -242,13 +651,85 @@ static void window_redraw_cb(gpointer win_ptr, gpointer user_data)
     window_redraw(win);
 }
 
-static void database_update_mark_manager_cb(gpointer uri_ptr, gpointer manager_ptr, gpointer user_data)
+static void window_update_statusline_cb(gpointer win_ptr, gpointer user_data)
+{
+    UNUSED(user_data);
+
+    Window *win = win_ptr;
+
+    window_update_statusline(win);
+}
+
+/* Shows the progress of the text indexer */
+static gboolean on_text_indexed(gpointer user_data)
+{
+    App *app = user_data;
+
+    g_ptr_array_foreach(app->windows, window_update_statusline_cb, NULL);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Not added to windows, NULL if the document can't be opened */
+static Window *app_open_window(App *app, GFile *file)
+{
+    ViewerMarkManager *mark_manager = app_get_mark_manager(app, file);
+    Window *win;
+
+    if (mark_manager == NULL) {
+        return NULL;
+    }
+
+    win = window_new(app);
+    window_open(win, file, mark_manager);
+    gtk_window_present(GTK_WINDOW(win));
+
+    return win;
+}
+
+static gboolean on_save_timeout(gpointer user_data)
+{
+    App *app = (App *)user_data;
+
+    app->save_source_id = 0;
+    app_save_mark_managers(app);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_memory_budget_idle(gpointer user_data)
 {
-    const char *uri = uri_ptr;
-    ViewerMarkManager *manager = manager_ptr;
     App *app = (App *)user_data;
+    const gssize budget = (gssize)g_config->memory_budget_mb * 1024 * 1024;
+    static bool warned = false;
+
+    app->memory_budget_source_id = 0;
+
+    // Hysteresis, so prefetching doesn't toggle on every draw near the limit
+    if (app_get_resident_bytes() < budget / 4 * 3) {
+        renderer_set_prefetch_throttled(false);
+        return G_SOURCE_REMOVE;
+    }
+    if (app_get_resident_bytes() <= budget) {
+        return G_SOURCE_REMOVE;
+    }
 
-    database_update_mark_manager(app->db, uri, manager);
+    renderer_set_prefetch_throttled(true);
+    // Only costs a slower render of those pages later, so before any surface
+    app_release_recordings(app);
+    if (app_get_resident_bytes() <= budget) {
+        return G_SOURCE_REMOVE;
+    }
+
+    app_shed_memory(app, true, false);
+    // Released surfaces are pooled, which would keep the memory in use
+    surface_pool_trim();
+    if (app_get_resident_bytes() > budget && !warned) {
+        g_warning("app_enforce_memory_budget: visible pages alone exceed the memory budget of %d MiB", g_config->memory_budget_mb);
+        warned = true;
+    }
+
+    return G_SOURCE_REMOVE;
 }
 
 static void on_file_dialog_response(GObject *source_object, GAsyncResult *res, gpointer user_data)
@@ -282,4 +763,33 @@ static void on_file_dialog_response(GObject *source_object, GAsyncResult *res, g
 
     g_object_unref(dialog);
     g_application_release(app);
-}
\ No newline at end of file
+}
+
+static void app_start_replay(App *app, Window *win)
+{
+    app->key_replayer = key_replayer_new(app->replay_path, app->replay_speed);
+    if (app->key_replayer == NULL) {
+        g_application_quit(G_APPLICATION(app));
+        return;
+    }
+
+    key_replayer_start(app->key_replayer, win);
+}
+
+static gboolean on_sigusr1(gpointer user_data)
+{
+    app_dump_metrics(JUMPDF_APP(user_data));
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void on_low_memory_warning(GMemoryMonitor *monitor, GMemoryMonitorWarningLevel level, gpointer user_data)
+{
+    App *app = JUMPDF_APP(user_data);
+    UNUSED(monitor);
+
+    // Lifted again by app_enforce_memory_budget once usage is low
+    renderer_set_prefetch_throttled(true);
+    app_shed_memory(app, level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM, level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+    surface_pool_trim();
+}
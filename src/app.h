@@ -3,6 +3,15 @@
 #include <gtk/gtk.h>
 
 #include "window.h"
+#include "replay.h"
+#include "render_scheduler.h"
+#include "render_process.h"
+#include "database.h"
+#include "database_writer.h"
+#include "text_indexer.h"
+
+/* Longest time a change of marks or cursors goes unsaved */
+#define APP_SAVE_DELAY_MS 1000
 
 #define APP_TYPE (app_get_type())
 G_DECLARE_FINAL_TYPE(App, app, JUMPDF, APP, GtkApplication)
@@ -12,8 +21,28 @@ int app_run(int argc, char *argv[]);
 App *app_new(void);
 
 ViewerMarkManager *app_get_mark_manager(App *app, GFile *file);
+/* Opens file at page, or goes to page in a window that already shows it. NULL on failure */
+Window *app_open_at_page(App *app, GFile *file, int page);
+/* Opens file at its current cursor, or presents a window that already shows it. NULL on failure */
+Window *app_present(App *app, GFile *file);
 void app_remove_window(App *app, Window *win);
 void app_update_cursors(App *app);
 void app_redraw_windows(App *app);
-void app_update_database_mark_managers(App *app);
-void app_open_file_chooser(App *app);
\ No newline at end of file
+/* Schedules a save of the mark manager of uri within APP_SAVE_DELAY_MS */
+void app_mark_dirty(App *app, const char *uri);
+/* Hands the changed mark managers to the database writer thread */
+void app_save_mark_managers(App *app);
+void app_open_file_chooser(App *app);
+void app_dump_metrics(App *app);
+/* Connection of the main thread */
+Database *app_get_database(App *app);
+DatabaseWriter *app_get_database_writer(App *app);
+/* NULL if index_text is disabled or SQLite lacks FTS5 */
+TextIndexer *app_get_text_indexer(App *app);
+RenderScheduler *app_get_render_scheduler(App *app);
+/* NULL if pages are rendered in this process */
+RenderProcessPool *app_get_render_process_pool(App *app);
+/* Sheds rendered pages once the main loop is idle if they use more than memory_budget_mb */
+void app_enforce_memory_budget(App *app);
+/* NULL if not recording */
+KeyRecorder *app_get_key_recorder(App *app);
\ No newline at end of file
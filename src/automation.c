@@ -0,0 +1,376 @@
+#include <math.h>
+
+#include "automation.h"
+#include "project_config.h"
+#include "input_cmd.h"
+#include "renderer.h"
+#include "utils.h"
+
+#define AUTOMATION_INTERFACE APP_ID_STR ".Automation"
+/* Largest scale set-scale accepts, as the surfaces of a page grow with its square */
+#define AUTOMATION_MAX_SCALE 16.0
+
+typedef struct {
+    App *app;
+    GDBusMethodInvocation *invocation;
+    gint64 start;
+    // Set once the invocation has been returned
+    gboolean returned;
+} WaitForRenderIdleData;
+
+static const gchar introspection_xml[] =
+    "<node>"
+    "  <interface name='" AUTOMATION_INTERFACE "'>"
+    "    <method name='Run'>"
+    "      <arg type='a(sv)' name='commands' direction='in'/>"
+    "      <arg type='a{sv}' name='state' direction='out'/>"
+    "    </method>"
+    "    <method name='QueryState'>"
+    "      <arg type='a{sv}' name='state' direction='out'/>"
+    "    </method>"
+    "    <method name='WaitForRenderIdle'>"
+    "      <arg type='x' name='waited_us' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+static Window *automation_get_window(App *app);
+static void automation_refresh(App *app);
+static void on_goto_page(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void on_switch_mark(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void on_set_mark(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void on_switch_group(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void on_search(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void on_set_scale(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void automation_method_call(GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+    const gchar *interface_name, const gchar *method_name, GVariant *parameters,
+    GDBusMethodInvocation *invocation, gpointer user_data);
+static void automation_run(App *app, GVariant *parameters, GDBusMethodInvocation *invocation);
+static GVariant *automation_query_state(App *app);
+static bool automation_render_idle(App *app);
+static gboolean automation_wait_for_render_idle(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data);
+static void automation_return_render_idle(WaitForRenderIdleData *data);
+static void automation_wait_for_render_idle_free(gpointer user_data);
+static const gchar *automation_check_parameter(const gchar *name, GVariant *parameter);
+
+static const GActionEntry action_entries[] = {
+    {"goto-page", on_goto_page, "u", NULL, NULL, {0}},
+    {"switch-mark", on_switch_mark, "u", NULL, NULL, {0}},
+    {"set-mark", on_set_mark, "u", NULL, NULL, {0}},
+    {"switch-group", on_switch_group, "u", NULL, NULL, {0}},
+    {"search", on_search, "s", NULL, NULL, {0}},
+    {"set-scale", on_set_scale, "d", NULL, NULL, {0}},
+};
+
+static const GDBusInterfaceVTable interface_vtable = {
+    automation_method_call,
+    NULL,
+    NULL,
+    {0},
+};
+
+void automation_add_actions(App *app)
+{
+    g_action_map_add_action_entries(G_ACTION_MAP(app), action_entries, G_N_ELEMENTS(action_entries), app);
+}
+
+guint automation_register(App *app, GDBusConnection *connection, const gchar *object_path, GError **error)
+{
+    GDBusNodeInfo *introspection_data = g_dbus_node_info_new_for_xml(introspection_xml, error);
+    guint registration_id = 0;
+
+    if (introspection_data == NULL) {
+        return 0;
+    }
+
+    registration_id = g_dbus_connection_register_object(connection, object_path,
+        introspection_data->interfaces[0], &interface_vtable, app, NULL, error);
+    g_dbus_node_info_unref(introspection_data);
+
+    return registration_id;
+}
+
+/* The most recently focused document window, if any */
+static Window *automation_get_window(App *app)
+{
+    GtkWindow *win = gtk_application_get_active_window(GTK_APPLICATION(app));
+
+    return win != NULL && JUMPDF_IS_WINDOW(win) ? JUMPDF_WINDOW(win) : NULL;
+}
+
+static void automation_refresh(App *app)
+{
+    app_update_cursors(app);
+    app_redraw_windows(app);
+}
+
+static void on_goto_page(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+    Viewer *viewer;
+    guint32 page = g_variant_get_uint32(parameter);
+
+    if (win == NULL) {
+        return;
+    }
+
+    viewer = window_get_viewer(win);
+    viewer_cursor_goto_page(viewer->cursor, CLAMP(page, 1, (guint32)viewer->info->n_pages) - 1);
+    automation_refresh(app);
+}
+
+static void on_switch_mark(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+    guint32 mark = g_variant_get_uint32(parameter);
+
+    if (win == NULL || mark < 1 || mark > NUM_MARKS) {
+        return;
+    }
+
+    viewer_mark_manager_switch_mark(window_get_mark_manager(win), mark - 1);
+    automation_refresh(app);
+}
+
+static void on_set_mark(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+    guint32 mark = g_variant_get_uint32(parameter);
+
+    if (win == NULL || mark < 1 || mark > NUM_MARKS) {
+        return;
+    }
+
+    viewer_mark_manager_overwrite_mark(window_get_mark_manager(win), mark - 1);
+    automation_refresh(app);
+}
+
+static void on_switch_group(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+    guint32 group = g_variant_get_uint32(parameter);
+
+    if (win == NULL || group < 1 || group > NUM_GROUPS) {
+        return;
+    }
+
+    viewer_mark_manager_switch_group(window_get_mark_manager(win), group - 1);
+    automation_refresh(app);
+}
+
+static void on_search(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+
+    if (win == NULL) {
+        return;
+    }
+
+    window_set_search_text(win, g_variant_get_string(parameter, NULL));
+    forward_search(window_get_viewer(win), 1, window_get_mark_manager(win));
+    automation_refresh(app);
+}
+
+static void on_set_scale(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    UNUSED(action);
+
+    App *app = JUMPDF_APP(user_data);
+    Window *win = automation_get_window(app);
+
+    if (win == NULL) {
+        return;
+    }
+
+    if (automation_check_parameter("set-scale", parameter) != NULL) {
+        return;
+    }
+
+    viewer_cursor_set_scale(window_get_viewer(win)->cursor, MIN(g_variant_get_double(parameter), AUTOMATION_MAX_SCALE));
+    automation_refresh(app);
+}
+
+static void automation_method_call(GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+    const gchar *interface_name, const gchar *method_name, GVariant *parameters,
+    GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    UNUSED(connection);
+    UNUSED(sender);
+    UNUSED(object_path);
+    UNUSED(interface_name);
+
+    App *app = JUMPDF_APP(user_data);
+    WaitForRenderIdleData *data;
+    Window *win;
+
+    if (g_strcmp0(method_name, "Run") == 0) {
+        automation_run(app, parameters, invocation);
+    } else if (g_strcmp0(method_name, "QueryState") == 0) {
+        g_dbus_method_invocation_return_value(invocation,
+            g_variant_new_tuple((GVariant *[]){ automation_query_state(app) }, 1));
+    } else if (g_strcmp0(method_name, "WaitForRenderIdle") == 0) {
+        data = g_new0(WaitForRenderIdleData, 1);
+        data->app = g_object_ref(app);
+        data->invocation = invocation;
+        data->start = g_get_monotonic_time();
+        data->returned = FALSE;
+
+        win = automation_get_window(app);
+        if (win == NULL || automation_render_idle(app)) {
+            automation_return_render_idle(data);
+            automation_wait_for_render_idle_free(data);
+        } else {
+            // Checked once per frame, as polling faster would compete with the renders being measured
+            gtk_widget_add_tick_callback(GTK_WIDGET(win), automation_wait_for_render_idle, data,
+                automation_wait_for_render_idle_free);
+        }
+    }
+}
+
+static void automation_run(App *app, GVariant *parameters, GDBusMethodInvocation *invocation)
+{
+    GVariant *commands = g_variant_get_child_value(parameters, 0);
+    const gsize n_commands = g_variant_n_children(commands);
+    const gchar *name = NULL;
+    GVariant *parameter = NULL;
+    const GVariantType *parameter_type = NULL;
+    gchar *error_message = NULL;
+
+    if (automation_get_window(app) == NULL) {
+        error_message = g_strdup("No document window is open");
+    }
+
+    // Validate the whole batch first, so that it either runs completely or not at all
+    for (gsize i = 0; i < n_commands && error_message == NULL; i++) {
+        g_variant_get_child(commands, i, "(&sv)", &name, &parameter);
+
+        if (!g_action_group_query_action(G_ACTION_GROUP(app), name, NULL, &parameter_type, NULL, NULL, NULL)) {
+            error_message = g_strdup_printf("Command %" G_GSIZE_FORMAT ": Unknown action \"%s\"", i, name);
+        } else if (parameter_type == NULL || !g_variant_is_of_type(parameter, parameter_type)) {
+            error_message = g_strdup_printf("Command %" G_GSIZE_FORMAT ": \"%s\" expects a parameter of type %s",
+                i, name, parameter_type != NULL ? g_variant_type_peek_string(parameter_type) : "()");
+        } else if (automation_check_parameter(name, parameter) != NULL) {
+            error_message = g_strdup_printf("Command %" G_GSIZE_FORMAT ": \"%s\" %s",
+                i, name, automation_check_parameter(name, parameter));
+        }
+
+        g_variant_unref(parameter);
+    }
+
+    if (error_message != NULL) {
+        g_dbus_method_invocation_return_error_literal(invocation, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS, error_message);
+        g_free(error_message);
+        g_variant_unref(commands);
+        return;
+    }
+
+    for (gsize i = 0; i < n_commands; i++) {
+        g_variant_get_child(commands, i, "(&sv)", &name, &parameter);
+        g_action_group_activate_action(G_ACTION_GROUP(app), name, parameter);
+        g_variant_unref(parameter);
+    }
+    g_variant_unref(commands);
+
+    g_dbus_method_invocation_return_value(invocation,
+        g_variant_new_tuple((GVariant *[]){ automation_query_state(app) }, 1));
+}
+
+static GVariant *automation_query_state(App *app)
+{
+    GVariantBuilder builder;
+    Window *win = automation_get_window(app);
+    Viewer *viewer;
+    ViewerMarkManager *mark_manager;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "render-idle", g_variant_new_boolean(automation_render_idle(app)));
+
+    if (win != NULL) {
+        viewer = window_get_viewer(win);
+        mark_manager = window_get_mark_manager(win);
+
+        g_variant_builder_add(&builder, "{sv}", "uri", g_variant_new_string(window_get_uri(win) != NULL ? window_get_uri(win) : ""));
+        g_variant_builder_add(&builder, "{sv}", "page", g_variant_new_uint32(viewer->cursor->current_page + 1));
+        g_variant_builder_add(&builder, "{sv}", "n-pages", g_variant_new_uint32(viewer->info->n_pages));
+        g_variant_builder_add(&builder, "{sv}", "scale", g_variant_new_double(viewer->cursor->scale));
+        g_variant_builder_add(&builder, "{sv}", "group", g_variant_new_uint32(viewer_mark_manager_get_current_group_index(mark_manager) + 1));
+        g_variant_builder_add(&builder, "{sv}", "mark", g_variant_new_uint32(viewer_mark_manager_get_current_mark_index(mark_manager) + 1));
+        g_variant_builder_add(&builder, "{sv}", "search-text",
+            g_variant_new_string(viewer->search->search_text != NULL ? viewer->search->search_text : ""));
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+static bool automation_render_idle(App *app)
+{
+    bool idle = true;
+
+    for (GList *l = gtk_application_get_windows(GTK_APPLICATION(app)); l != NULL && idle; l = l->next) {
+        if (JUMPDF_IS_WINDOW(l->data)) {
+            idle = renderer_is_idle(window_get_renderer(l->data), window_get_viewer(l->data));
+        }
+    }
+
+    return idle;
+}
+
+static gboolean automation_wait_for_render_idle(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+    UNUSED(widget);
+    UNUSED(frame_clock);
+
+    WaitForRenderIdleData *data = (WaitForRenderIdleData *)user_data;
+
+    if (!automation_render_idle(data->app)) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    automation_return_render_idle(data);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void automation_return_render_idle(WaitForRenderIdleData *data)
+{
+    g_dbus_method_invocation_return_value(data->invocation,
+        g_variant_new("(x)", g_get_monotonic_time() - data->start));
+    data->returned = TRUE;
+}
+
+/* Also called when the window closes while waiting, which leaves nothing to render */
+static void automation_wait_for_render_idle_free(gpointer user_data)
+{
+    WaitForRenderIdleData *data = (WaitForRenderIdleData *)user_data;
+
+    if (!data->returned) {
+        automation_return_render_idle(data);
+    }
+    g_object_unref(data->app);
+    g_free(data);
+}
+
+/* Why parameter is out of range for the action name, or NULL if it is fine */
+static const gchar *automation_check_parameter(const gchar *name, GVariant *parameter)
+{
+    if (g_strcmp0(name, "set-scale") == 0 && !(isfinite(g_variant_get_double(parameter)) && g_variant_get_double(parameter) > 0)) {
+        return "expects a finite scale greater than 0";
+    }
+
+    return NULL;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "app.h"
+
+/*
+* Actions that drive the active window without synthetic key events:
+*   app.goto-page (u): 1-based page number
+*   app.switch-mark, app.set-mark, app.switch-group (u): 1-based index
+*   app.search (s): set the search text and go to the next match
+*   app.set-scale (d)
+*
+* They are exported on the session bus by GApplication (org.gtk.Actions).
+* APP_ID.Automation on the same object path additionally provides:
+*   Run(a(sv) commands) -> (a{sv} state): activates the actions in order
+*   QueryState() -> (a{sv} state)
+*   WaitForRenderIdle() -> (x waited_us): returns once all windows are idle
+*/
+
+void automation_add_actions(App *app);
+guint automation_register(App *app, GDBusConnection *connection, const gchar *object_path, GError **error);
@@ -8,6 +8,15 @@
 #define DEFAULT_STEPS 15 // Number of steps in a page.
 #define DEFAULT_MIN_SCALE 0.3 // To prevent divide by zero
 #define DEFAULT_SCALE_STEP 0.1 // How much to scale the PDF on each event
+#define DEFAULT_STALL_THRESHOLD_MS 500 // Main loop stalls longer than this are reported, 0 disables
+#define DEFAULT_RENDER_THREADS 0 // Render worker threads shared by all windows, 0 uses one per processor
+#define DEFAULT_RENDER_PROCESSES 0 // Helper processes that render pages, 0 renders in the viewer process
+#define DEFAULT_RENDER_TIMEOUT_MS 10000 // Render processes are killed after rendering a page this long, 0 disables
+#define DEFAULT_PREFETCH_PAGES 1 // Pages rendered ahead on each side of the visible ones
+#define DEFAULT_MEMORY_BUDGET_MB 1024 // Memory for rendered pages of all windows in MiB, 0 disables the limit
+#define DEFAULT_RECORD_PAGES false // Keep a display list of each rendered page to replay at other scales
+#define DEFAULT_MAX_DOCUMENTS 500 // Documents whose marks are kept in the database, 0 disables the limit
+#define DEFAULT_INDEX_TEXT true // Keep the text of opened documents in the database to speed up searches
 #define DEFAULT_STATUSLINE_SEPARATOR " | "
 
 Config *g_config = NULL;
@@ -37,6 +46,15 @@ void config_init(Config *config)
     config->steps = -1;
     config->min_scale = -1.0;
     config->scale_step = -1.0;
+    config->stall_threshold_ms = -1;
+    config->render_threads = -1;
+    config->render_processes = -1;
+    config->render_timeout_ms = -1;
+    config->prefetch_pages = -1;
+    config->memory_budget_mb = -1;
+    config->record_pages = false;
+    config->max_documents = -1;
+    config->index_text = false;
 
     config->statusline_separator = NULL;
     config->statusline_left = g_array_new(FALSE, TRUE, sizeof(StatuslineComponent));
@@ -92,6 +110,86 @@ void config_set_scale_step(Config *config, double scale_step)
     }
 }
 
+void config_set_stall_threshold_ms(Config *config, int stall_threshold_ms)
+{
+    if (stall_threshold_ms < 0) {
+        g_printerr("\"stall_threshold_ms\" must be greater than or equal to 0. Using default value.\n");
+        config->stall_threshold_ms = DEFAULT_STALL_THRESHOLD_MS;
+    } else {
+        config->stall_threshold_ms = stall_threshold_ms;
+    }
+}
+
+void config_set_render_threads(Config *config, int render_threads)
+{
+    if (render_threads < 0) {
+        g_printerr("\"render_threads\" must be greater than or equal to 0. Using default value.\n");
+        config->render_threads = DEFAULT_RENDER_THREADS;
+    } else {
+        config->render_threads = render_threads;
+    }
+}
+
+void config_set_render_processes(Config *config, int render_processes)
+{
+    if (render_processes < 0) {
+        g_printerr("\"render_processes\" must be greater than or equal to 0. Using default value.\n");
+        config->render_processes = DEFAULT_RENDER_PROCESSES;
+    } else {
+        config->render_processes = render_processes;
+    }
+}
+
+void config_set_render_timeout_ms(Config *config, int render_timeout_ms)
+{
+    if (render_timeout_ms < 0) {
+        g_printerr("\"render_timeout_ms\" must be greater than or equal to 0. Using default value.\n");
+        config->render_timeout_ms = DEFAULT_RENDER_TIMEOUT_MS;
+    } else {
+        config->render_timeout_ms = render_timeout_ms;
+    }
+}
+
+void config_set_prefetch_pages(Config *config, int prefetch_pages)
+{
+    if (prefetch_pages < 0) {
+        g_printerr("\"prefetch_pages\" must be greater than or equal to 0. Using default value.\n");
+        config->prefetch_pages = DEFAULT_PREFETCH_PAGES;
+    } else {
+        config->prefetch_pages = prefetch_pages;
+    }
+}
+
+void config_set_memory_budget_mb(Config *config, int memory_budget_mb)
+{
+    if (memory_budget_mb < 0) {
+        g_printerr("\"memory_budget_mb\" must be greater than or equal to 0. Using default value.\n");
+        config->memory_budget_mb = DEFAULT_MEMORY_BUDGET_MB;
+    } else {
+        config->memory_budget_mb = memory_budget_mb;
+    }
+}
+
+void config_set_record_pages(Config *config, bool record_pages)
+{
+    config->record_pages = record_pages;
+}
+
+void config_set_max_documents(Config *config, int max_documents)
+{
+    if (max_documents < 0) {
+        g_printerr("\"max_documents\" must be greater than or equal to 0. Using default value.\n");
+        config->max_documents = DEFAULT_MAX_DOCUMENTS;
+    } else {
+        config->max_documents = max_documents;
+    }
+}
+
+void config_set_index_text(Config *config, bool index_text)
+{
+    config->index_text = index_text;
+}
+
 void config_set_statusline_separator(Config *config, gchar *statusline_separator)
 {
     config->statusline_separator = statusline_separator;
@@ -120,6 +218,15 @@ void config_load_default(Config *config)
     config_set_steps(config, DEFAULT_STEPS);
     config_set_min_scale(config, DEFAULT_MIN_SCALE);
     config_set_scale_step(config, DEFAULT_SCALE_STEP);
+    config_set_stall_threshold_ms(config, DEFAULT_STALL_THRESHOLD_MS);
+    config_set_render_threads(config, DEFAULT_RENDER_THREADS);
+    config_set_render_processes(config, DEFAULT_RENDER_PROCESSES);
+    config_set_render_timeout_ms(config, DEFAULT_RENDER_TIMEOUT_MS);
+    config_set_prefetch_pages(config, DEFAULT_PREFETCH_PAGES);
+    config_set_memory_budget_mb(config, DEFAULT_MEMORY_BUDGET_MB);
+    config_set_record_pages(config, DEFAULT_RECORD_PAGES);
+    config_set_max_documents(config, DEFAULT_MAX_DOCUMENTS);
+    config_set_index_text(config, DEFAULT_INDEX_TEXT);
     config_set_statusline_separator(config, g_strdup(DEFAULT_STATUSLINE_SEPARATOR));
 
     config_load_default_statusline_left(config);
@@ -178,6 +285,78 @@ static void config_parse(Config *config, FILE *fp)
             config_set_scale_step(config, DEFAULT_SCALE_STEP);
         }
 
+        datum = toml_int_in(settings, "stall_threshold_ms");
+        if (datum.ok) {
+            config_set_stall_threshold_ms(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"stall_threshold_ms\". Using default value.\n");
+            config_set_stall_threshold_ms(config, DEFAULT_STALL_THRESHOLD_MS);
+        }
+
+        datum = toml_int_in(settings, "render_threads");
+        if (datum.ok) {
+            config_set_render_threads(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"render_threads\". Using default value.\n");
+            config_set_render_threads(config, DEFAULT_RENDER_THREADS);
+        }
+
+        datum = toml_int_in(settings, "render_processes");
+        if (datum.ok) {
+            config_set_render_processes(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"render_processes\". Using default value.\n");
+            config_set_render_processes(config, DEFAULT_RENDER_PROCESSES);
+        }
+
+        datum = toml_int_in(settings, "render_timeout_ms");
+        if (datum.ok) {
+            config_set_render_timeout_ms(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"render_timeout_ms\". Using default value.\n");
+            config_set_render_timeout_ms(config, DEFAULT_RENDER_TIMEOUT_MS);
+        }
+
+        datum = toml_int_in(settings, "prefetch_pages");
+        if (datum.ok) {
+            config_set_prefetch_pages(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"prefetch_pages\". Using default value.\n");
+            config_set_prefetch_pages(config, DEFAULT_PREFETCH_PAGES);
+        }
+
+        datum = toml_int_in(settings, "memory_budget_mb");
+        if (datum.ok) {
+            config_set_memory_budget_mb(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"memory_budget_mb\". Using default value.\n");
+            config_set_memory_budget_mb(config, DEFAULT_MEMORY_BUDGET_MB);
+        }
+
+        datum = toml_bool_in(settings, "record_pages");
+        if (datum.ok) {
+            config_set_record_pages(config, datum.u.b);
+        } else {
+            g_printerr("Error parsing \"record_pages\". Using default value.\n");
+            config_set_record_pages(config, DEFAULT_RECORD_PAGES);
+        }
+
+        datum = toml_int_in(settings, "max_documents");
+        if (datum.ok) {
+            config_set_max_documents(config, datum.u.i);
+        } else {
+            g_printerr("Error parsing \"max_documents\". Using default value.\n");
+            config_set_max_documents(config, DEFAULT_MAX_DOCUMENTS);
+        }
+
+        datum = toml_bool_in(settings, "index_text");
+        if (datum.ok) {
+            config_set_index_text(config, datum.u.b);
+        } else {
+            g_printerr("Error parsing \"index_text\". Using default value.\n");
+            config_set_index_text(config, DEFAULT_INDEX_TEXT);
+        }
+
         datum = toml_string_in(settings, "statusline_separator");
         if (datum.ok) {
             config_set_statusline_separator(config, datum.u.s);
@@ -9,6 +9,15 @@ typedef struct Config {
     int steps;
     double min_scale;
     double scale_step;
+    int stall_threshold_ms;
+    int render_threads;
+    int render_processes;
+    int render_timeout_ms;
+    int prefetch_pages;
+    int memory_budget_mb;
+    bool record_pages;
+    int max_documents;
+    bool index_text;
 
     gchar *statusline_separator;
     GArray *statusline_left;
@@ -26,6 +35,15 @@ void config_set_file_chooser_initial_folder_path(Config *config, gchar *file_cho
 void config_set_steps(Config *config, int steps);
 void config_set_min_scale(Config *config, double min_scale);
 void config_set_scale_step(Config *config, double scale_step);
+void config_set_stall_threshold_ms(Config *config, int stall_threshold_ms);
+void config_set_render_threads(Config *config, int render_threads);
+void config_set_render_processes(Config *config, int render_processes);
+void config_set_render_timeout_ms(Config *config, int render_timeout_ms);
+void config_set_prefetch_pages(Config *config, int prefetch_pages);
+void config_set_memory_budget_mb(Config *config, int memory_budget_mb);
+void config_set_record_pages(Config *config, bool record_pages);
+void config_set_max_documents(Config *config, int max_documents);
+void config_set_index_text(Config *config, bool index_text);
 void config_set_statusline_separator(Config *config, gchar *statusline_separator);
 
 void config_load(Config *config);
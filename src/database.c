@@ -1,15 +1,136 @@
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <gtk/gtk.h>
 
 #include "database.h"
 #include "utils.h"
 #include "config.h"
 
-// TODO: A lot of repetition in these functions
-
-#define DATABASE_VERSION 1
-
+#define DATABASE_VERSION 5
+#define DATABASE_BUSY_TIMEOUT_MS 5000
+/* Page p of text document d is row d * stride + p of page_text */
+#define DATABASE_TEXT_ROWID_STRIDE 1048576
+/* Shortest query the trigram tokenizer can look up */
+#define DATABASE_TEXT_MIN_QUERY_LENGTH 3
+
+static const char *database_stmt_sql[DATABASE_N_STMTS] = {
+    [DATABASE_STMT_BEGIN] = "BEGIN IMMEDIATE;",
+    [DATABASE_STMT_COMMIT] = "COMMIT;",
+    [DATABASE_STMT_ROLLBACK] = "ROLLBACK;",
+    [DATABASE_STMT_INSERT_CURSOR] =
+        "INSERT INTO cursor (current_page, x_offset, y_offset, scale, center_mode, dark_mode, input_number) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?);",
+    [DATABASE_STMT_UPDATE_CURSOR] =
+        "UPDATE cursor "
+        "SET current_page = ?, x_offset = ?, y_offset = ?, scale = ?, center_mode = ?, dark_mode = ?, input_number = ? "
+        "WHERE id = ?;",
+    [DATABASE_STMT_DELETE_CURSOR] =
+        "DELETE FROM cursor "
+        "WHERE id = ?;",
+    [DATABASE_STMT_DELETE_CURSOR_FROM_GROUP] =
+        "DELETE FROM group_contains_cursor "
+        "WHERE cursor_id = ?;",
+    [DATABASE_STMT_INSERT_GROUP] =
+        "INSERT INTO cursor_group (current_mark, previous_mark) "
+        "VALUES (?, ?);",
+    [DATABASE_STMT_UPDATE_GROUP] =
+        "UPDATE cursor_group "
+        "SET current_mark = ?, previous_mark = ? "
+        "WHERE id = ?;",
+    [DATABASE_STMT_INSERT_CURSOR_INTO_GROUP] =
+        "INSERT INTO "
+        "group_contains_cursor (group_id, cursor_id, cursor_index) "
+        "VALUES (?, ?, ?);",
+    [DATABASE_STMT_UPSERT_MARK_MANAGER] =
+        "INSERT INTO mark_manager (uri, current_group, previous_group, last_opened) "
+        "VALUES (?, ?, ?, unixepoch()) "
+        "ON CONFLICT(uri) DO UPDATE SET current_group = excluded.current_group, previous_group = excluded.previous_group, last_opened = excluded.last_opened;",
+    [DATABASE_STMT_INSERT_GROUP_INTO_MARK_MANAGER] =
+        "INSERT INTO "
+        "mark_manager_contains_group (mark_manager_uri, group_id, group_index) "
+        "VALUES (?, ?, ?);",
+    [DATABASE_STMT_GET_MARK_MANAGER_IDS] =
+        "SELECT mg.group_index, mg.group_id, gc.cursor_index, gc.cursor_id "
+        "FROM mark_manager_contains_group mg "
+        "LEFT JOIN group_contains_cursor gc ON gc.group_id = mg.group_id "
+        "WHERE mg.mark_manager_uri = ?;",
+    [DATABASE_STMT_GET_MARK_MANAGER] =
+        "SELECT m.current_group, m.previous_group, "
+        "   mg.group_index, g.current_mark, g.previous_mark, "
+        "   gc.cursor_index, c.current_page, c.x_offset, c.y_offset, c.scale, c.center_mode, c.dark_mode, c.input_number "
+        "FROM mark_manager m "
+        "LEFT JOIN mark_manager_contains_group mg ON mg.mark_manager_uri = m.uri "
+        "LEFT JOIN cursor_group g ON g.id = mg.group_id "
+        "LEFT JOIN group_contains_cursor gc ON gc.group_id = g.id "
+        "LEFT JOIN cursor c ON c.id = gc.cursor_id "
+        "WHERE m.uri = ?;",
+    [DATABASE_STMT_GET_TEXT_DOCUMENT] =
+        "SELECT id, indexed_pages FROM text_document "
+        "WHERE fingerprint = ?;",
+    [DATABASE_STMT_INSERT_TEXT_DOCUMENT] =
+        "INSERT INTO text_document (fingerprint, uri, n_pages) "
+        "VALUES (?, ?, ?);",
+    [DATABASE_STMT_GET_REPLACED_TEXT_DOCUMENTS] =
+        "SELECT id FROM text_document "
+        "WHERE uri = ? AND fingerprint != ?;",
+    [DATABASE_STMT_DELETE_TEXT_DOCUMENT] =
+        "DELETE FROM text_document "
+        "WHERE id = ?;",
+    [DATABASE_STMT_DELETE_PAGE_TEXTS] =
+        "DELETE FROM page_text "
+        "WHERE rowid BETWEEN ? AND ?;",
+    [DATABASE_STMT_INSERT_PAGE_TEXT] =
+        "INSERT INTO page_text (rowid, text) "
+        "VALUES (?, ?);",
+    [DATABASE_STMT_SET_INDEXED_PAGES] =
+        "UPDATE text_document "
+        "SET indexed_pages = ? "
+        "WHERE id = ?;",
+    [DATABASE_STMT_FIND_TEXT_PAGES] =
+        "SELECT rowid FROM page_text "
+        "WHERE page_text MATCH ? AND rowid BETWEEN ? AND ? "
+        "ORDER BY rowid;",
+    [DATABASE_STMT_SEARCH_TEXT] =
+        "SELECT d.uri, page_text.rowid - d.id * " G_STRINGIFY(DATABASE_TEXT_ROWID_STRIDE) ", "
+        "   snippet(page_text, 0, '', '', '…', 12) "
+        "FROM page_text "
+        "JOIN text_document d ON d.id = page_text.rowid / " G_STRINGIFY(DATABASE_TEXT_ROWID_STRIDE) " "
+        "WHERE page_text MATCH ? AND d.uri IN (SELECT uri FROM mark_manager) "
+        "ORDER BY rank "
+        "LIMIT ?;",
+    [DATABASE_STMT_GET_METADATA] =
+        "SELECT data FROM document_metadata "
+        "WHERE fingerprint = ? AND kind = ?;",
+    [DATABASE_STMT_DELETE_REPLACED_METADATA] =
+        "DELETE FROM document_metadata "
+        "WHERE uri = ? AND fingerprint != ?;",
+    [DATABASE_STMT_UPSERT_METADATA] =
+        "INSERT INTO document_metadata (fingerprint, kind, uri, data) "
+        "VALUES (?, ?, ?, ?) "
+        "ON CONFLICT(fingerprint, kind) DO UPDATE SET uri = excluded.uri, data = excluded.data;",
+    [DATABASE_STMT_GET_RECENT_DOCUMENTS] =
+        "SELECT m.uri, d.data FROM mark_manager m "
+        "LEFT JOIN document_metadata d ON d.uri = m.uri AND d.kind = ? "
+        "ORDER BY m.last_opened DESC "
+        "LIMIT ?;",
+};
+
+static sqlite3_stmt *database_get_stmt(Database *db, DatabaseStmt id);
+static bool database_step_done(Database *db, sqlite3_stmt *stmt);
+static bool database_cursor_equal(ViewerCursor *a, ViewerCursor *b);
+static bool database_group_equal(ViewerMarkGroup *a, ViewerMarkGroup *b);
+static bool database_mark_manager_equal(ViewerMarkManager *a, ViewerMarkManager *b);
+static bool database_migrate_v2(Database *db);
+static bool database_migrate_v3(Database *db);
+static bool database_migrate_v4(Database *db);
+static bool database_migrate_v5(Database *db);
+static bool database_create_text_tables(Database *db);
+static void database_delete_text_document(Database *db, sqlite3_int64 id);
+static gchar *database_text_to_match(const char *text);
+static gchar *database_normalize_text(const char *text);
+static GPtrArray *database_get_stale_uris(Database *db);
+static bool database_exec(Database *db, const char *sql);
 static void database_printerr_stmt(Database *db, sqlite3_stmt *stmt);
 static void database_printerr_sql(Database *db, char *sql);
 
@@ -31,12 +152,29 @@ void database_init(Database *db, const char *path) {
         return;
     }
 
+    db->path = g_strdup(path);
+    for (int i = 0; i < DATABASE_N_STMTS; i++) {
+        db->stmts[i] = NULL;
+    }
+
     rc = sqlite3_open(path, &(db->handle));
     if (rc != SQLITE_OK) {
         g_printerr("database_init: %s\n", sqlite3_errmsg(db->handle));
         sqlite3_close(db->handle);
         return;
     }
+
+    /*
+    * With a write-ahead log, a commit appends to the log instead of
+    * rewriting pages, and only needs an fsync at checkpoints
+    */
+    rc = sqlite3_exec(db->handle, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        g_printerr("database_init: %s\n", sqlite3_errmsg(db->handle));
+    }
+
+    // The writer thread has its own connection
+    sqlite3_busy_timeout(db->handle, DATABASE_BUSY_TIMEOUT_MS);
 }
 
 void database_close(Database *db)
@@ -47,15 +185,25 @@ void database_close(Database *db)
         return;
     }
 
+    for (int i = 0; i < DATABASE_N_STMTS; i++) {
+        sqlite3_finalize(db->stmts[i]);
+        db->stmts[i] = NULL;
+    }
+
     rc = sqlite3_close(db->handle);
     if (rc != SQLITE_OK) {
         g_printerr("database_close: %s\n", sqlite3_errmsg(db->handle));
     }
+
+    g_free(db->path);
+    db->path = NULL;
 }
 
 void database_create_tables(Database *db)
 {
     const char *sql =
+        // Only takes effect before the first table is created
+        "PRAGMA auto_vacuum = INCREMENTAL;"
         "PRAGMA user_version = " G_STRINGIFY(DATABASE_VERSION) ";"
         "CREATE TABLE IF NOT EXISTS cursor ("
         "   id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -75,7 +223,8 @@ void database_create_tables(Database *db)
         "CREATE TABLE IF NOT EXISTS mark_manager ("
         "   uri TEXT PRIMARY KEY,"
         "   current_group INTEGER NOT NULL,"
-        "   previous_group INTEGER NOT NULL"
+        "   previous_group INTEGER NOT NULL,"
+        "   last_opened INTEGER NOT NULL DEFAULT 0"
         ");"
         "CREATE TABLE IF NOT EXISTS group_contains_cursor ("
         "   group_id INTEGER NOT NULL,"
@@ -98,6 +247,15 @@ void database_create_tables(Database *db)
         "CREATE INDEX IF NOT EXISTS idx_mark_manager_uri ON mark_manager(uri);"
         "CREATE INDEX IF NOT EXISTS idx_group_contains_cursor_group_id_cursor_id ON group_contains_cursor(group_id, cursor_id);"
         "CREATE INDEX IF NOT EXISTS idx_mark_manager_contains_group_mark_manager_uri ON mark_manager_contains_group(mark_manager_uri);"
+        "CREATE INDEX IF NOT EXISTS idx_mark_manager_last_opened ON mark_manager(last_opened);"
+        "CREATE TABLE IF NOT EXISTS document_metadata ("
+        "   fingerprint TEXT NOT NULL,"
+        "   kind INTEGER NOT NULL,"
+        "   uri TEXT NOT NULL,"
+        "   data BLOB NOT NULL,"
+        "   PRIMARY KEY(fingerprint, kind)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_document_metadata_uri ON document_metadata(uri);"
         ;
     char *errmsg = NULL;
     int rc = sqlite3_exec(db->handle, sql, NULL, NULL, &errmsg);
@@ -106,6 +264,8 @@ void database_create_tables(Database *db)
         g_printerr("database_create_tables: %s\n", errmsg);
         sqlite3_free(errmsg);
     }
+
+    database_create_text_tables(db);
 }
 
 int database_get_version(Database *db)
@@ -136,27 +296,67 @@ int database_get_version(Database *db)
 void database_check_update(Database *db, const char *path)
 {
     int version = database_get_version(db);
+    gchar *journal_path = NULL;
+
+    // database_migrate_vN migrates from version N - 1 to N
+    if (version == 1 && database_migrate_v2(db)) {
+        version = 2;
+    }
+    if (version == 2 && database_migrate_v3(db)) {
+        version = 3;
+    }
+    if (version == 3 && database_migrate_v4(db)) {
+        version = 4;
+    }
+    if (version == 4 && database_migrate_v5(db)) {
+        version = 5;
+    }
+
     if (version != DATABASE_VERSION) {
         g_print("Database version is %d, expected %d. Recreating database\n", version, DATABASE_VERSION);
 
         database_close(db);
         /* Dropping the database is acceptable, as it only serves to persist state */
         remove(path);
+        journal_path = g_strconcat(path, "-wal", NULL);
+        remove(journal_path);
+        g_free(journal_path);
+        journal_path = g_strconcat(path, "-shm", NULL);
+        remove(journal_path);
+        g_free(journal_path);
         database_init(db, path);
         database_create_tables(db);
     }
 }
 
+bool database_begin(Database *db)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_BEGIN);
+
+    return stmt != NULL && database_step_done(db, stmt);
+}
+
+bool database_commit(Database *db)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_COMMIT);
+
+    return stmt != NULL && database_step_done(db, stmt);
+}
+
+void database_rollback(Database *db)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_ROLLBACK);
+
+    if (stmt != NULL) {
+        database_step_done(db, stmt);
+    }
+}
+
 sqlite3_int64 database_insert_cursor(Database *db, ViewerCursor *cursor)
 {
-    const char *sql = "INSERT INTO cursor (current_page, x_offset, y_offset, scale, center_mode, dark_mode, input_number) VALUES (?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt;
-    int rc;
-    int cursor_id = -1;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_INSERT_CURSOR);
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_insert_cursor: %s\n", sqlite3_errmsg(db->handle));
+    if (stmt == NULL) {
         return -1;
     }
 
@@ -168,71 +368,37 @@ sqlite3_int64 database_insert_cursor(Database *db, ViewerCursor *cursor)
     sqlite3_bind_int(stmt, 6, cursor->dark_mode);
     sqlite3_bind_int(stmt, 7, cursor->input_number);
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        database_printerr_stmt(db, stmt);
-    } else {
-        cursor_id = sqlite3_last_insert_rowid(db->handle);
-    }
-
-    sqlite3_finalize(stmt);
-
-    return cursor_id;
+    return database_step_done(db, stmt) ? sqlite3_last_insert_rowid(db->handle) : -1;
 }
 
-void database_delete_cursor(Database *db, int id)
+bool database_delete_cursor(Database *db, sqlite3_int64 id)
 {
-    const char *sql_delete_cursor =
-        "DELETE FROM cursor "
-        "WHERE id = ?;";
-    const char *sql_delete_group_contains_cursor =
-        "DELETE FROM group_contains_cursor "
-        "WHERE cursor_id = ?;";
-    sqlite3_stmt *stmt;
-    int rc;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_DELETE_CURSOR_FROM_GROUP);
 
-    rc = sqlite3_prepare_v2(db->handle, sql_delete_group_contains_cursor, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_delete_cursor (DELETE group_contains_cursor): %s\n", sqlite3_errmsg(db->handle));
-        return;
+    if (stmt == NULL) {
+        return false;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        database_printerr_stmt(db, stmt);
+    sqlite3_bind_int64(stmt, 1, id);
+    if (!database_step_done(db, stmt)) {
+        return false;
     }
-    sqlite3_finalize(stmt);
 
-    rc = sqlite3_prepare_v2(db->handle, sql_delete_cursor, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_delete_cursor (DELETE cursor): %s\n", sqlite3_errmsg(db->handle));
-        return;
+    stmt = database_get_stmt(db, DATABASE_STMT_DELETE_CURSOR);
+    if (stmt == NULL) {
+        return false;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        database_printerr_stmt(db, stmt);
-    }
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int64(stmt, 1, id);
+    return database_step_done(db, stmt);
 }
 
-void database_update_cursor(Database *db, int id, ViewerCursor *cursor)
+bool database_update_cursor(Database *db, sqlite3_int64 id, ViewerCursor *cursor)
 {
-    const char *sql =
-        "UPDATE cursor "
-        "SET current_page = ?, x_offset = ?, y_offset = ?, scale = ?, center_mode = ?, dark_mode = ?, input_number = ? "
-        "WHERE id = ?;";
-    sqlite3_stmt *stmt;
-    int rc;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_UPDATE_CURSOR);
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_update_cursor: %s\n", sqlite3_errmsg(db->handle));
-        return;
+    if (stmt == NULL) {
+        return false;
     }
 
     sqlite3_bind_int(stmt, 1, cursor->current_page);
@@ -242,514 +408,969 @@ void database_update_cursor(Database *db, int id, ViewerCursor *cursor)
     sqlite3_bind_int(stmt, 5, cursor->center_mode);
     sqlite3_bind_int(stmt, 6, cursor->dark_mode);
     sqlite3_bind_int(stmt, 7, cursor->input_number);
-    sqlite3_bind_int(stmt, 8, id);
+    sqlite3_bind_int64(stmt, 8, id);
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        database_printerr_stmt(db, stmt);
-    }
-
-    sqlite3_finalize(stmt);
+    return database_step_done(db, stmt);
 }
 
-ViewerCursor *database_get_cursor(Database *db, int id)
+sqlite3_int64 database_insert_group(Database *db, ViewerMarkGroup *group)
 {
-    const char *sql = "SELECT current_page, x_offset, y_offset, scale, center_mode, dark_mode, input_number FROM cursor WHERE id = ?;";
-    sqlite3_stmt *stmt;
-    int rc;
-    int current_page;
-    double x_offset, y_offset, scale;
-    int center_mode;
-    int dark_mode;
-    int input_number;
-    ViewerCursor *cursor = NULL;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_INSERT_GROUP);
+    sqlite3_int64 group_id = -1;
+    sqlite3_int64 cursor_id = -1;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_get_cursor: %s\n", sqlite3_errmsg(db->handle));
-        return NULL;
+    if (stmt == NULL) {
+        return -1;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
+    sqlite3_bind_int(stmt, 1, group->current_mark);
+    sqlite3_bind_int(stmt, 2, group->previous_mark);
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        current_page = sqlite3_column_int(stmt, 0);
-        x_offset = sqlite3_column_double(stmt, 1);
-        y_offset = sqlite3_column_double(stmt, 2);
-        scale = sqlite3_column_double(stmt, 3);
-        center_mode = sqlite3_column_int(stmt, 4);
-        dark_mode = sqlite3_column_int(stmt, 5);
-        input_number = sqlite3_column_int(stmt, 6);
-
-        cursor = viewer_cursor_new(NULL, current_page, x_offset, y_offset, scale, center_mode, dark_mode, input_number);
-    } else {
-        database_printerr_stmt(db, stmt);
+    if (!database_step_done(db, stmt)) {
+        return -1;
     }
+    group_id = sqlite3_last_insert_rowid(db->handle);
 
-    sqlite3_finalize(stmt);
+    for (unsigned int i = 0; i < NUM_MARKS; i++) {
+        if (group->marks[i] != NULL) {
+            cursor_id = database_insert_cursor(db, group->marks[i]);
+            if (cursor_id < 0 || database_insert_cursor_into_group(db, group_id, cursor_id, i) < 0) {
+                return -1;
+            }
+        }
+    }
 
-    return cursor;
+    return group_id;
 }
 
-sqlite3_int64 database_insert_group(Database *db, ViewerMarkGroup *group)
+sqlite3_int64 database_insert_cursor_into_group(Database *db, sqlite3_int64 group_id, sqlite3_int64 cursor_id, int cursor_index)
 {
-    const char *sql =
-        "INSERT INTO cursor_group (current_mark, previous_mark)"
-        "VALUES (?, ?);";
-    sqlite3_stmt *stmt;
-    int rc;
-    sqlite3_int64 group_id = -1;
-    sqlite3_int64 cursor_id = -1;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_INSERT_CURSOR_INTO_GROUP);
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_insert_group: %s\n", sqlite3_errmsg(db->handle));
+    if (stmt == NULL) {
         return -1;
     }
 
+    sqlite3_bind_int64(stmt, 1, group_id);
+    sqlite3_bind_int64(stmt, 2, cursor_id);
+    sqlite3_bind_int(stmt, 3, cursor_index);
+
+    return database_step_done(db, stmt) ? sqlite3_last_insert_rowid(db->handle) : -1;
+}
+
+/* Only the row of the group, see database_update_mark_manager for its marks */
+bool database_update_group(Database *db, sqlite3_int64 id, ViewerMarkGroup *group)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_UPDATE_GROUP);
+
+    if (stmt == NULL) {
+        return false;
+    }
+
     sqlite3_bind_int(stmt, 1, group->current_mark);
     sqlite3_bind_int(stmt, 2, group->previous_mark);
+    sqlite3_bind_int64(stmt, 3, id);
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        database_printerr_stmt(db, stmt);
-    } else {
-        group_id = sqlite3_last_insert_rowid(db->handle);
+    return database_step_done(db, stmt);
+}
+
+void database_insert_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager)
+{
+    database_save_mark_manager(db, uri, manager, NULL);
+}
+
+sqlite3_int64 database_insert_group_into_mark_manager(Database *db, const char *uri, sqlite3_int64 group_id, int group_index)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_INSERT_GROUP_INTO_MARK_MANAGER);
+
+    if (stmt == NULL) {
+        return -1;
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, group_id);
+    sqlite3_bind_int(stmt, 3, group_index);
 
-    for (unsigned int i = 0; i < NUM_MARKS; i++) {
-        if (group->marks[i] != NULL) {
-            cursor_id = database_insert_cursor(db, group->marks[i]);
-            database_insert_cursor_into_group(db, group_id, cursor_id, i);
+    return database_step_done(db, stmt) ? sqlite3_last_insert_rowid(db->handle) : -1;
+}
+
+void database_update_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager)
+{
+    database_save_mark_manager(db, uri, manager, NULL);
+}
+
+ViewerMarkManager *database_get_mark_manager(Database *db, const char *uri)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_GET_MARK_MANAGER);
+    ViewerCursor *cursors[NUM_GROUPS][NUM_MARKS] = { { NULL } };
+    int current_marks[NUM_GROUPS] = { 0 };
+    int previous_marks[NUM_GROUPS] = { 0 };
+    bool has_group[NUM_GROUPS] = { false };
+    ViewerMarkGroup *groups[NUM_GROUPS] = { NULL };
+    ViewerMarkManager *manager = NULL;
+    int current_group = 0;
+    int previous_group = 0;
+    bool found = false;
+    int group_index;
+    int cursor_index;
+    int rc;
+
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+
+    // One row per cursor, or per group or mark manager without any
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        found = true;
+        current_group = sqlite3_column_int(stmt, 0);
+        previous_group = sqlite3_column_int(stmt, 1);
+
+        if (sqlite3_column_type(stmt, 2) == SQLITE_NULL) {
+            continue;
+        }
+        group_index = sqlite3_column_int(stmt, 2);
+        if (group_index < 0 || group_index >= NUM_GROUPS) {
+            continue;
+        }
+        has_group[group_index] = true;
+        current_marks[group_index] = sqlite3_column_int(stmt, 3);
+        previous_marks[group_index] = sqlite3_column_int(stmt, 4);
+
+        if (sqlite3_column_type(stmt, 5) == SQLITE_NULL || sqlite3_column_type(stmt, 6) == SQLITE_NULL) {
+            continue;
+        }
+        cursor_index = sqlite3_column_int(stmt, 5);
+        if (cursor_index < 0 || cursor_index >= NUM_MARKS || cursors[group_index][cursor_index] != NULL) {
+            continue;
         }
+        cursors[group_index][cursor_index] = viewer_cursor_new(NULL,
+            sqlite3_column_int(stmt, 6),
+            sqlite3_column_double(stmt, 7),
+            sqlite3_column_double(stmt, 8),
+            sqlite3_column_double(stmt, 9),
+            sqlite3_column_int(stmt, 10),
+            sqlite3_column_int(stmt, 11),
+            sqlite3_column_int(stmt, 12));
     }
 
-    return group_id;
+    if (rc != SQLITE_DONE) {
+        database_printerr_stmt(db, stmt);
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (found) {
+        for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+            if (has_group[i]) {
+                groups[i] = viewer_mark_group_new(cursors[i], current_marks[i], previous_marks[i]);
+            }
+        }
+        manager = viewer_mark_manager_new(groups, current_group, previous_group);
+    } else {
+        for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+            for (unsigned int j = 0; j < NUM_MARKS; j++) {
+                viewer_cursor_destroy(cursors[i][j]);
+                free(cursors[i][j]);
+            }
+        }
+    }
+
+    return manager;
 }
 
-sqlite3_int64 database_insert_cursor_into_group(Database *db, int group_id, int cursor_id, int cursor_index)
+/* Prepares the statement the first time it is used. Reset after each use by database_step_done */
+static sqlite3_stmt *database_get_stmt(Database *db, DatabaseStmt id)
 {
-    const char *sql =
-        "INSERT INTO "
-        "group_contains_cursor (group_id, cursor_id, cursor_index) "
-        "VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt;
     int rc;
-    sqlite3_int64 inserted_rowid = -1;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_insert_cursor_into_group: %s\n", sqlite3_errmsg(db->handle));
-        return -1;
+    if (db->stmts[id] == NULL) {
+        rc = sqlite3_prepare_v3(db->handle, database_stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT, &db->stmts[id], NULL);
+        if (rc != SQLITE_OK) {
+            g_printerr("database_get_stmt: %s\n", sqlite3_errmsg(db->handle));
+            db->stmts[id] = NULL;
+        }
     }
 
-    sqlite3_bind_int(stmt, 1, group_id);
-    sqlite3_bind_int(stmt, 2, cursor_id);
-    sqlite3_bind_int(stmt, 3, cursor_index);
+    return db->stmts[id];
+}
+
+/* Runs a statement that returns no rows and resets it for the next use */
+static bool database_step_done(Database *db, sqlite3_stmt *stmt)
+{
+    const int rc = sqlite3_step(stmt);
 
-    rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
-    } else {
-        inserted_rowid = sqlite3_last_insert_rowid(db->handle);
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
-    return inserted_rowid;
+    return rc == SQLITE_DONE;
 }
 
-void database_update_group(Database *db, int id, ViewerMarkGroup *group)
+/*
+* Looks up the rows of the mark manager with one query, then writes the
+* differences in a single transaction, so a save costs one commit
+*/
+bool database_save_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager, ViewerMarkManager *saved)
 {
-    const char *sql =
-        "UPDATE cursor_group "
-        "SET current_mark = ?, previous_mark = ? "
-        "WHERE id = ?;";
     sqlite3_stmt *stmt;
+    sqlite3_int64 group_ids[NUM_GROUPS];
+    sqlite3_int64 cursor_ids[NUM_GROUPS][NUM_MARKS];
+    ViewerMarkGroup *group;
+    ViewerMarkGroup *saved_group;
+    sqlite3_int64 cursor_id;
+    int group_index;
+    int cursor_index;
+    bool ok = true;
     int rc;
-    ViewerCursor **cursors_db;
-    int new_cursor_id = -1;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_update_group: %s\n", sqlite3_errmsg(db->handle));
-        return;
+    // Redraws mark the manager dirty whether or not anything changed
+    if (saved != NULL && database_mark_manager_equal(manager, saved)) {
+        return true;
     }
 
-    sqlite3_bind_int(stmt, 1, group->current_mark);
-    sqlite3_bind_int(stmt, 2, group->previous_mark);
-    sqlite3_bind_int(stmt, 3, id);
+    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+        group_ids[i] = -1;
+        for (unsigned int j = 0; j < NUM_MARKS; j++) {
+            cursor_ids[i][j] = -1;
+        }
+    }
 
-    rc = sqlite3_step(stmt);
+    if (!database_begin(db)) {
+        return false;
+    }
+
+    stmt = database_get_stmt(db, DATABASE_STMT_UPSERT_MARK_MANAGER);
+    if (stmt == NULL) {
+        database_rollback(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, manager->current_group);
+    sqlite3_bind_int(stmt, 3, manager->previous_group);
+    if (!database_step_done(db, stmt)) {
+        database_rollback(db);
+        return false;
+    }
+
+    stmt = database_get_stmt(db, DATABASE_STMT_GET_MARK_MANAGER_IDS);
+    if (stmt == NULL) {
+        database_rollback(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        group_index = sqlite3_column_int(stmt, 0);
+        if (group_index < 0 || group_index >= NUM_GROUPS) {
+            continue;
+        }
+        group_ids[group_index] = sqlite3_column_int64(stmt, 1);
+
+        if (sqlite3_column_type(stmt, 2) != SQLITE_NULL) {
+            cursor_index = sqlite3_column_int(stmt, 2);
+            if (cursor_index >= 0 && cursor_index < NUM_MARKS) {
+                cursor_ids[group_index][cursor_index] = sqlite3_column_int64(stmt, 3);
+            }
+        }
+    }
     if (rc != SQLITE_DONE) {
+        // Missing ids would insert the rows a second time
         database_printerr_stmt(db, stmt);
+        ok = false;
     }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    // Stops at the first failure, so nothing of a partial save is committed
+    for (unsigned int i = 0; i < NUM_GROUPS && ok; i++) {
+        group = manager->groups[i];
+        saved_group = saved != NULL ? saved->groups[i] : NULL;
+        if (group == NULL) {
+            continue;
+        }
 
-    sqlite3_finalize(stmt);
+        if (group_ids[i] < 0) {
+            group_ids[i] = database_insert_group(db, group);
+            ok = group_ids[i] >= 0 && database_insert_group_into_mark_manager(db, uri, group_ids[i], i) >= 0;
+            continue;
+        }
 
-    cursors_db = database_get_group_cursors(db, id);
-    for (unsigned int i = 0; i < NUM_MARKS; i++) {
-        if (cursors_db[i] == NULL && group->marks[i] != NULL) {
-            new_cursor_id = database_insert_cursor(db, group->marks[i]);
-            database_insert_cursor_into_group(db, id, new_cursor_id, i);
-        } else if (cursors_db[i] != NULL) {
-            database_update_cursor_in_group(db, id, i, group->marks[i]);
+        if (saved_group == NULL || group->current_mark != saved_group->current_mark || group->previous_mark != saved_group->previous_mark) {
+            ok = database_update_group(db, group_ids[i], group);
+        }
+        for (unsigned int j = 0; j < NUM_MARKS && ok; j++) {
+            if (group->marks[j] != NULL && cursor_ids[i][j] < 0) {
+                cursor_id = database_insert_cursor(db, group->marks[j]);
+                ok = cursor_id >= 0 && database_insert_cursor_into_group(db, group_ids[i], cursor_id, j) >= 0;
+            } else if (group->marks[j] != NULL) {
+                if (saved_group == NULL || !database_cursor_equal(group->marks[j], saved_group->marks[j])) {
+                    ok = database_update_cursor(db, cursor_ids[i][j], group->marks[j]);
+                }
+            } else if (cursor_ids[i][j] >= 0) {
+                ok = database_delete_cursor(db, cursor_ids[i][j]);
+            }
         }
     }
 
-    for (unsigned int i = 0; i < NUM_MARKS; i++) {
-        if (cursors_db[i] != NULL) {
-            viewer_cursor_destroy(cursors_db[i]);
-            free(cursors_db[i]);
-        }
+    if (!ok || !database_commit(db)) {
+        database_rollback(db);
+        return false;
     }
-    free(cursors_db);
+
+    return true;
 }
 
-void database_update_cursor_in_group(Database *db, int group_id, int cursor_index, ViewerCursor *cursor)
+sqlite3_int64 database_get_text_document(Database *db, const char *fingerprint, const char *uri, int n_pages, int *indexed_pages)
 {
-    const char *sql =
-        "SELECT cursor_id "
-        "FROM group_contains_cursor "
-        "WHERE group_id = ? AND cursor_index = ?;";
-    sqlite3_stmt *stmt;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_GET_TEXT_DOCUMENT);
+    sqlite3_int64 id = -1;
     int rc;
-    int cursor_id;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_update_cursor_in_group: %s\n", sqlite3_errmsg(db->handle));
-        return;
+    *indexed_pages = 0;
+    if (stmt == NULL) {
+        return -1;
     }
 
-    sqlite3_bind_int(stmt, 1, group_id);
-    sqlite3_bind_int(stmt, 2, cursor_index);
-
+    sqlite3_bind_text(stmt, 1, fingerprint, -1, SQLITE_STATIC);
     rc = sqlite3_step(stmt);
     if (rc == SQLITE_ROW) {
-        cursor_id = sqlite3_column_int(stmt, 0);
-        if (cursor == NULL) {
-            database_delete_cursor(db, cursor_id);
-        } else {
-            database_update_cursor(db, cursor_id, cursor);
-        }
+        id = sqlite3_column_int64(stmt, 0);
+        *indexed_pages = sqlite3_column_int(stmt, 1);
     } else if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
     }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
-    sqlite3_finalize(stmt);
+    if (id >= 0 || rc != SQLITE_DONE) {
+        return id;
+    }
+
+    if (!database_begin(db)) {
+        return -1;
+    }
+
+    // The file changed since it was indexed, so its old text is never found again
+    stmt = database_get_stmt(db, DATABASE_STMT_GET_REPLACED_TEXT_DOCUMENTS);
+    if (stmt != NULL) {
+        GArray *replaced = g_array_new(FALSE, FALSE, sizeof(sqlite3_int64));
+
+        sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, fingerprint, -1, SQLITE_STATIC);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            id = sqlite3_column_int64(stmt, 0);
+            g_array_append_val(replaced, id);
+        }
+        if (rc != SQLITE_DONE) {
+            database_printerr_stmt(db, stmt);
+        }
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+
+        for (guint i = 0; i < replaced->len; i++) {
+            database_delete_text_document(db, g_array_index(replaced, sqlite3_int64, i));
+        }
+        g_array_free(replaced, TRUE);
+    }
+
+    stmt = database_get_stmt(db, DATABASE_STMT_INSERT_TEXT_DOCUMENT);
+    if (stmt == NULL) {
+        database_rollback(db);
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, fingerprint, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, uri, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, n_pages);
+    if (!database_step_done(db, stmt)) {
+        database_rollback(db);
+        return -1;
+    }
+    id = sqlite3_last_insert_rowid(db->handle);
+
+    if (!database_commit(db)) {
+        database_rollback(db);
+        return -1;
+    }
+
+    return id;
 }
 
-ViewerMarkGroup *database_get_group(Database *db, int id)
+bool database_insert_page_text(Database *db, sqlite3_int64 document_id, int page, const char *text)
 {
-    const char *sql =
-        "SELECT current_mark, previous_mark "
-        "FROM cursor_group "
-        "WHERE id = ?;";
-    sqlite3_stmt *stmt;
-    int rc;
-    ViewerCursor **cursors;
-    int current_mark;
-    int previous_mark;
-    ViewerMarkGroup *group = NULL;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_INSERT_PAGE_TEXT);
+    gchar *normalized;
+    bool inserted;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_get_group: %s\n", sqlite3_errmsg(db->handle));
-        return NULL;
+    if (stmt == NULL || page >= DATABASE_TEXT_ROWID_STRIDE) {
+        return false;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
+    normalized = database_normalize_text(text);
+    sqlite3_bind_int64(stmt, 1, document_id * DATABASE_TEXT_ROWID_STRIDE + page);
+    sqlite3_bind_text(stmt, 2, normalized, -1, SQLITE_STATIC);
+    inserted = database_step_done(db, stmt);
+    g_free(normalized);
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        cursors = database_get_group_cursors(db, id);
-        current_mark = sqlite3_column_int(stmt, 0);
-        previous_mark = sqlite3_column_int(stmt, 1);
-        group = viewer_mark_group_new(cursors, current_mark, previous_mark);
+    return inserted;
+}
 
-        free(cursors);
-    } else {
-        database_printerr_stmt(db, stmt);
+bool database_set_indexed_pages(Database *db, sqlite3_int64 document_id, int indexed_pages)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_SET_INDEXED_PAGES);
+
+    if (stmt == NULL) {
+        return false;
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int(stmt, 1, indexed_pages);
+    sqlite3_bind_int64(stmt, 2, document_id);
 
-    return group;
+    return database_step_done(db, stmt);
 }
 
-ViewerCursor **database_get_group_cursors(Database *db, int id)
+bool database_has_text_index(Database *db)
 {
-    const char *sql =
-        "SELECT cursor_id, cursor_index "
-        "FROM group_contains_cursor "
-        "WHERE group_id = ?;";
+    const char *sql = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'page_text';";
     sqlite3_stmt *stmt;
+    bool found;
+
+    if (sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        g_printerr("database_has_text_index: %s\n", sqlite3_errmsg(db->handle));
+        return false;
+    }
+    found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+
+    return found;
+}
+
+GArray *database_find_text_pages(Database *db, const char *fingerprint, const char *text, int *indexed_pages)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_GET_TEXT_DOCUMENT);
+    gchar *match = database_text_to_match(text);
+    sqlite3_int64 id = -1;
+    GArray *pages;
+    int page;
     int rc;
-    int cursor_id;
-    int cursor_index;
-    ViewerCursor **cursors = NULL;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_get_group_cursors: %s\n", sqlite3_errmsg(db->handle));
+    *indexed_pages = 0;
+    if (stmt == NULL || match == NULL) {
+        g_free(match);
         return NULL;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
-
-    cursors = malloc(NUM_MARKS * sizeof(ViewerCursor *));
-    for (unsigned int i = 0; i < NUM_MARKS; i++) {
-        cursors[i] = NULL;
+    sqlite3_bind_text(stmt, 1, fingerprint, -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+        *indexed_pages = sqlite3_column_int(stmt, 1);
+    } else if (rc != SQLITE_DONE) {
+        database_printerr_stmt(db, stmt);
     }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
-    while (TRUE) {
-        rc = sqlite3_step(stmt);
-        if (rc == SQLITE_ROW) {
-            cursor_id = sqlite3_column_int(stmt, 0);
-            cursor_index = sqlite3_column_int(stmt, 1);
-            cursors[cursor_index] = database_get_cursor(db, cursor_id);
-        } else if (rc == SQLITE_DONE) {
-            break;
-        } else {
-            database_printerr_stmt(db, stmt);
-        }
+    stmt = database_get_stmt(db, DATABASE_STMT_FIND_TEXT_PAGES);
+    if (id < 0 || *indexed_pages == 0 || stmt == NULL) {
+        *indexed_pages = 0;
+        g_free(match);
+        return NULL;
     }
 
-    sqlite3_finalize(stmt);
+    pages = g_array_new(FALSE, FALSE, sizeof(int));
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, id * DATABASE_TEXT_ROWID_STRIDE);
+    sqlite3_bind_int64(stmt, 3, id * DATABASE_TEXT_ROWID_STRIDE + *indexed_pages - 1);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        page = sqlite3_column_int64(stmt, 0) - id * DATABASE_TEXT_ROWID_STRIDE;
+        g_array_append_val(pages, page);
+    }
+    if (rc != SQLITE_DONE) {
+        database_printerr_stmt(db, stmt);
+        g_clear_pointer(&pages, g_array_unref);
+        *indexed_pages = 0;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    g_free(match);
 
-    return cursors;
+    return pages;
 }
 
-void database_insert_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager)
+GPtrArray *database_search_text(Database *db, const char *text, int limit)
 {
-    const char *sql =
-        "INSERT INTO mark_manager (uri, current_group, previous_group) "
-        "VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt;
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_SEARCH_TEXT);
+    gchar *match = database_text_to_match(text);
+    GPtrArray *matches = g_ptr_array_new_with_free_func((GDestroyNotify)database_text_match_free);
+    DatabaseTextMatch *text_match;
     int rc;
-    sqlite3_int64 group_id = -1;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_insert_mark_manager: %s\n", sqlite3_errmsg(db->handle));
-        return;
+    if (stmt == NULL || match == NULL) {
+        g_free(match);
+        return matches;
     }
 
-    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, manager->current_group);
-    sqlite3_bind_int(stmt, 3, manager->previous_group);
-
-    rc = sqlite3_step(stmt);
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, limit);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        text_match = g_new(DatabaseTextMatch, 1);
+        text_match->uri = g_strdup((const char *)sqlite3_column_text(stmt, 0));
+        text_match->page = sqlite3_column_int(stmt, 1);
+        text_match->snippet = g_strdup((const char *)sqlite3_column_text(stmt, 2));
+        g_ptr_array_add(matches, text_match);
+    }
     if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
     }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    g_free(match);
 
-    sqlite3_finalize(stmt);
+    return matches;
+}
 
-    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
-        if (manager->groups[i] != NULL) {
-            group_id = database_insert_group(db, manager->groups[i]);
-            database_insert_group_into_mark_manager(db, uri, group_id, i);
-        }
+void database_text_match_free(DatabaseTextMatch *match)
+{
+    g_free(match->uri);
+    g_free(match->snippet);
+    g_free(match);
+}
+
+GVariant *database_get_metadata(Database *db, const char *fingerprint, DatabaseMetadataKind kind, const GVariantType *type)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_GET_METADATA);
+    GVariant *data = NULL;
+    GBytes *bytes;
+    int rc;
+
+    if (stmt == NULL) {
+        return NULL;
     }
+
+    sqlite3_bind_text(stmt, 1, fingerprint, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, kind);
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        bytes = g_bytes_new(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        // Not trusted, so a corrupt row reads as default values instead of out of bounds
+        data = g_variant_ref_sink(g_variant_new_from_bytes(type, bytes, FALSE));
+        g_bytes_unref(bytes);
+    } else if (rc != SQLITE_DONE) {
+        database_printerr_stmt(db, stmt);
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    return data;
 }
 
-sqlite3_int64 database_insert_group_into_mark_manager(Database *db, const char *uri, int group_id, int group_index)
+bool database_put_metadata(Database *db, const char *fingerprint, const char *uri, DatabaseMetadataKind kind, GVariant *data)
 {
-    const char *sql =
-        "INSERT INTO "
-        "mark_manager_contains_group (mark_manager_uri, group_id, group_index) "
-        "VALUES (?, ?, ?);";
     sqlite3_stmt *stmt;
-    int rc;
-    sqlite3_int64 inserted_id = -1;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_insert_group_into_mark_manager: %s\n", sqlite3_errmsg(db->handle));
-        return -1;
+    if (!database_begin(db)) {
+        return false;
     }
 
+    // The file changed, so what was cached for it is never used again
+    stmt = database_get_stmt(db, DATABASE_STMT_DELETE_REPLACED_METADATA);
+    if (stmt == NULL) {
+        database_rollback(db);
+        return false;
+    }
     sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, group_id);
-    sqlite3_bind_int(stmt, 3, group_index);
+    sqlite3_bind_text(stmt, 2, fingerprint, -1, SQLITE_STATIC);
+    if (!database_step_done(db, stmt)) {
+        database_rollback(db);
+        return false;
+    }
 
-    rc = sqlite3_step(stmt);
+    stmt = database_get_stmt(db, DATABASE_STMT_UPSERT_METADATA);
+    if (stmt == NULL) {
+        database_rollback(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, fingerprint, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, kind);
+    sqlite3_bind_text(stmt, 3, uri, -1, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 4, g_variant_get_data(data), g_variant_get_size(data), SQLITE_STATIC);
+    if (!database_step_done(db, stmt) || !database_commit(db)) {
+        database_rollback(db);
+        return false;
+    }
+
+    return true;
+}
+
+GPtrArray *database_get_recent_documents(Database *db, int limit)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_GET_RECENT_DOCUMENTS);
+    GPtrArray *documents = g_ptr_array_new_with_free_func((GDestroyNotify)database_recent_document_free);
+    DatabaseRecentDocument *document;
+    int rc;
+
+    if (stmt == NULL) {
+        return documents;
+    }
+
+    sqlite3_bind_int(stmt, 1, DATABASE_METADATA_THUMBNAIL);
+    sqlite3_bind_int(stmt, 2, limit);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        document = g_new(DatabaseRecentDocument, 1);
+        document->uri = g_strdup((const char *)sqlite3_column_text(stmt, 0));
+        // The serialized form of a bytestring variant is the bytes themselves
+        document->thumbnail = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? NULL :
+            g_bytes_new(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1));
+        g_ptr_array_add(documents, document);
+    }
     if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
-    } else {
-        inserted_id = sqlite3_last_insert_rowid(db->handle);
     }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
-    sqlite3_finalize(stmt);
+    return documents;
+}
 
-    return inserted_id;
+void database_recent_document_free(DatabaseRecentDocument *document)
+{
+    g_free(document->uri);
+    if (document->thumbnail != NULL) {
+        g_bytes_unref(document->thumbnail);
+    }
+    g_free(document);
 }
 
-void database_update_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager)
+void database_collect_text_garbage(Database *db)
 {
     const char *sql =
-        "UPDATE mark_manager "
-        "SET current_group = ?, previous_group = ? "
-        "WHERE uri = ?;";
+        "SELECT id FROM text_document "
+        "WHERE uri NOT IN (SELECT uri FROM mark_manager);";
+    GArray *ids = g_array_new(FALSE, FALSE, sizeof(sqlite3_int64));
     sqlite3_stmt *stmt;
+    sqlite3_int64 id;
     int rc;
-    ViewerMarkGroup **groups_db;
 
     rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        g_printerr("database_update_mark_manager: %s\n", sqlite3_errmsg(db->handle));
+        g_printerr("database_collect_text_garbage: %s\n", sqlite3_errmsg(db->handle));
+        g_array_free(ids, TRUE);
         return;
     }
 
-    sqlite3_bind_int(stmt, 1, manager->current_group);
-    sqlite3_bind_int(stmt, 2, manager->previous_group);
-    sqlite3_bind_text(stmt, 3, uri, -1, SQLITE_STATIC);
-
-    rc = sqlite3_step(stmt);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+        g_array_append_val(ids, id);
+    }
     if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
     }
-
     sqlite3_finalize(stmt);
 
-    database_update_groups_in_mark_manager(db, uri, manager->groups);
-    groups_db = database_get_mark_manager_groups(db, uri);
-    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
-        if (groups_db[i] == NULL && manager->groups[i] != NULL) {
-            database_insert_group(db, manager->groups[i]);
+    if (ids->len > 0 && database_begin(db)) {
+        for (guint i = 0; i < ids->len; i++) {
+            database_delete_text_document(db, g_array_index(ids, sqlite3_int64, i));
         }
-    }
-
-    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
-        if (groups_db[i] != NULL) {
-            viewer_mark_group_destroy(groups_db[i]);
-            free(groups_db[i]);
+        if (!database_commit(db)) {
+            database_rollback(db);
         }
     }
-    free(groups_db);
+    g_array_free(ids, TRUE);
 }
 
-void database_update_groups_in_mark_manager(Database *db, const char *uri, ViewerMarkGroup **groups)
+void database_collect_garbage(Database *db, int max_documents)
 {
-    const char *sql =
-        "SELECT group_id, group_index "
-        "FROM mark_manager_contains_group "
-        "WHERE mark_manager_uri = ?;";
+    const char *sql_delete_uri = "DELETE FROM mark_manager WHERE uri = ?;";
+    const char *sql_bound =
+        "DELETE FROM mark_manager WHERE uri NOT IN ("
+        "   SELECT uri FROM mark_manager ORDER BY last_opened DESC LIMIT ?"
+        ");";
+    const char *sql_orphans =
+        "DELETE FROM mark_manager_contains_group WHERE mark_manager_uri NOT IN (SELECT uri FROM mark_manager);"
+        "DELETE FROM cursor_group WHERE id NOT IN (SELECT group_id FROM mark_manager_contains_group);"
+        "DELETE FROM group_contains_cursor WHERE group_id NOT IN (SELECT id FROM cursor_group);"
+        "DELETE FROM cursor WHERE id NOT IN (SELECT cursor_id FROM group_contains_cursor);"
+        "DELETE FROM document_metadata WHERE uri NOT IN (SELECT uri FROM mark_manager);";
+    // Checked before the transaction, as it touches the file system
+    GPtrArray *stale_uris = database_get_stale_uris(db);
     sqlite3_stmt *stmt;
     int rc;
-    int group_id;
-    int group_index;
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_update_groups_in_mark_manager: %s\n", sqlite3_errmsg(db->handle));
+    if (!database_begin(db)) {
+        g_ptr_array_free(stale_uris, TRUE);
         return;
     }
 
-    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
-
-    while (TRUE) {
-        rc = sqlite3_step(stmt);
-        if (rc == SQLITE_ROW) {
-            group_id = sqlite3_column_int(stmt, 0);
-            group_index = sqlite3_column_int(stmt, 1);
-            database_update_group(db, group_id, groups[group_index]);
-        } else if (rc == SQLITE_DONE) {
-            break;
+    rc = sqlite3_prepare_v2(db->handle, sql_delete_uri, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        for (guint i = 0; i < stale_uris->len; i++) {
+            sqlite3_bind_text(stmt, 1, g_ptr_array_index(stale_uris, i), -1, SQLITE_STATIC);
+            database_step_done(db, stmt);
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        g_printerr("database_collect_garbage: %s\n", sqlite3_errmsg(db->handle));
+    }
+    g_ptr_array_free(stale_uris, TRUE);
+
+    if (max_documents > 0) {
+        rc = sqlite3_prepare_v2(db->handle, sql_bound, -1, &stmt, NULL);
+        if (rc == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, max_documents);
+            database_step_done(db, stmt);
+            sqlite3_finalize(stmt);
         } else {
-            database_printerr_stmt(db, stmt);
+            g_printerr("database_collect_garbage: %s\n", sqlite3_errmsg(db->handle));
         }
     }
 
-    sqlite3_finalize(stmt);
+    if (!database_exec(db, sql_orphans) || !database_commit(db)) {
+        database_rollback(db);
+        return;
+    }
+
+    // Returns the pages freed above to the file system
+    database_exec(db, "PRAGMA incremental_vacuum;");
 }
 
-ViewerMarkManager *database_get_mark_manager(Database *db, const char *uri)
+/*
+* Local files that were deleted or moved. A file is only stale if its
+* directory still exists, so documents on unmounted drives are kept
+*/
+static GPtrArray *database_get_stale_uris(Database *db)
 {
-    const char *sql =
-        "SELECT current_group, previous_group "
-        "FROM mark_manager "
-        "WHERE uri = ?;";
+    const char *sql = "SELECT uri FROM mark_manager;";
+    GPtrArray *stale_uris = g_ptr_array_new_with_free_func(g_free);
     sqlite3_stmt *stmt;
+    const char *uri;
+    GFile *file;
+    GFile *parent;
     int rc;
-    int current_group;
-    int previous_group;
-    ViewerMarkGroup **groups = NULL;
-    ViewerMarkManager *manager = NULL;
 
     rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        g_printerr("database_get_mark_manager: %s\n", sqlite3_errmsg(db->handle));
-        return NULL;
+        g_printerr("database_get_stale_uris: %s\n", sqlite3_errmsg(db->handle));
+        return stale_uris;
     }
 
-    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        uri = (const char *)sqlite3_column_text(stmt, 0);
+        file = g_file_new_for_uri(uri);
+        parent = g_file_get_parent(file);
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        current_group = sqlite3_column_int(stmt, 0);
-        previous_group = sqlite3_column_int(stmt, 1);
-        groups = database_get_mark_manager_groups(db, uri);
-        manager = viewer_mark_manager_new(groups, current_group, previous_group);
+        if (g_file_has_uri_scheme(file, "file") && parent != NULL &&
+            g_file_query_exists(parent, NULL) && !g_file_query_exists(file, NULL)) {
+            g_ptr_array_add(stale_uris, g_strdup(uri));
+        }
 
-        free(groups);
-    } else if (rc == SQLITE_DONE) {
-        // No mark manager found
-    } else {
+        g_clear_object(&parent);
+        g_object_unref(file);
+    }
+    if (rc != SQLITE_DONE) {
         database_printerr_stmt(db, stmt);
     }
 
     sqlite3_finalize(stmt);
 
-    return manager;
+    return stale_uris;
 }
 
-ViewerMarkGroup **database_get_mark_manager_groups(Database *db, const char *uri)
+/* Keeps the marks, unlike recreating the database */
+static bool database_migrate_v2(Database *db)
 {
     const char *sql =
-        "SELECT group_id, group_index "
-        "FROM mark_manager_contains_group "
-        "WHERE mark_manager_uri = ?;";
-    sqlite3_stmt *stmt;
-    int rc;
-    int group_id;
-    int group_index;
-    ViewerMarkGroup **groups = NULL;
+        "BEGIN IMMEDIATE;"
+        "ALTER TABLE mark_manager ADD COLUMN last_opened INTEGER NOT NULL DEFAULT 0;"
+        "CREATE INDEX IF NOT EXISTS idx_mark_manager_last_opened ON mark_manager(last_opened);"
+        "PRAGMA user_version = 2;"
+        "COMMIT;";
 
-    rc = sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        g_printerr("database_get_mark_manager_groups: %s\n", sqlite3_errmsg(db->handle));
-        return NULL;
+    g_print("Migrating database from version 1 to 2\n");
+
+    if (!database_exec(db, sql)) {
+        database_exec(db, "ROLLBACK;");
+        return false;
     }
 
-    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    // Changing auto_vacuum of an existing database needs a full VACUUM, once
+    database_exec(db, "PRAGMA auto_vacuum = INCREMENTAL; VACUUM;");
 
-    groups = malloc(NUM_GROUPS * sizeof(ViewerMarkGroup *));
-    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
-        groups[i] = NULL;
+    return true;
+}
+
+static bool database_migrate_v3(Database *db)
+{
+    g_print("Migrating database from version 2 to 3\n");
+
+    // Without FTS5 the marks are kept and only the text index is missing, see database_has_text_index
+    database_create_text_tables(db);
+
+    return database_exec(db, "PRAGMA user_version = 3;");
+}
+
+static bool database_migrate_v4(Database *db)
+{
+    const char *sql =
+        "BEGIN IMMEDIATE;"
+        "CREATE TABLE IF NOT EXISTS document_metadata ("
+        "   fingerprint TEXT NOT NULL,"
+        "   kind INTEGER NOT NULL,"
+        "   uri TEXT NOT NULL,"
+        "   data BLOB NOT NULL,"
+        "   PRIMARY KEY(fingerprint, kind)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_document_metadata_uri ON document_metadata(uri);"
+        "PRAGMA user_version = 4;"
+        "COMMIT;";
+
+    g_print("Migrating database from version 3 to 4\n");
+
+    if (!database_exec(db, sql)) {
+        database_exec(db, "ROLLBACK;");
+        return false;
     }
 
-    while (TRUE) {
-        rc = sqlite3_step(stmt);
-        if (rc == SQLITE_ROW) {
-            group_id = sqlite3_column_int(stmt, 0);
-            group_index = sqlite3_column_int(stmt, 1);
-            groups[group_index] = database_get_group(db, group_id);
-        } else if (rc == SQLITE_DONE) {
-            break;
-        } else {
-            database_printerr_stmt(db, stmt);
+    return true;
+}
+
+/* Text indexed before wasn't normalized like queries are now, so documents are indexed again when opened */
+static bool database_migrate_v5(Database *db)
+{
+    const char *sql =
+        "BEGIN IMMEDIATE;"
+        "DELETE FROM page_text;"
+        "DELETE FROM text_document;"
+        "COMMIT;";
+
+    g_print("Migrating database from version 4 to 5\n");
+
+    if (database_has_text_index(db) && !database_exec(db, sql)) {
+        database_exec(db, "ROLLBACK;");
+        return false;
+    }
+
+    return database_exec(db, "PRAGMA user_version = 5;");
+}
+
+/* Separate from the other tables, as SQLite may be built without FTS5 */
+static bool database_create_text_tables(Database *db)
+{
+    const char *sql =
+        "CREATE TABLE IF NOT EXISTS text_document ("
+        "   id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "   fingerprint TEXT NOT NULL UNIQUE,"
+        "   uri TEXT NOT NULL,"
+        "   n_pages INTEGER NOT NULL,"
+        "   indexed_pages INTEGER NOT NULL DEFAULT 0"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_text_document_uri ON text_document(uri);"
+        // Trigrams match substrings in any case, like poppler_page_find_text
+        "CREATE VIRTUAL TABLE IF NOT EXISTS page_text USING fts5(text, tokenize = 'trigram');";
+
+    return database_exec(db, sql);
+}
+
+static void database_delete_text_document(Database *db, sqlite3_int64 id)
+{
+    sqlite3_stmt *stmt = database_get_stmt(db, DATABASE_STMT_DELETE_PAGE_TEXTS);
+
+    if (stmt == NULL) {
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, id * DATABASE_TEXT_ROWID_STRIDE);
+    sqlite3_bind_int64(stmt, 2, (id + 1) * DATABASE_TEXT_ROWID_STRIDE - 1);
+    database_step_done(db, stmt);
+
+    stmt = database_get_stmt(db, DATABASE_STMT_DELETE_TEXT_DOCUMENT);
+    if (stmt == NULL) {
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, id);
+    database_step_done(db, stmt);
+}
+
+/* FTS5 phrase matching text as a substring, or NULL if it is too short for the index */
+static gchar *database_text_to_match(const char *text)
+{
+    gchar *normalized = database_normalize_text(text);
+    GString *match;
+
+    if (g_utf8_strlen(normalized, -1) < DATABASE_TEXT_MIN_QUERY_LENGTH) {
+        g_free(normalized);
+        return NULL;
+    }
+
+    match = g_string_new(normalized);
+    g_string_replace(match, "\"", "\"\"", 0);
+    g_string_prepend_c(match, '"');
+    g_string_append_c(match, '"');
+    g_free(normalized);
+
+    return g_string_free(match, FALSE);
+}
+
+/*
+* Folds case and compatibility forms such as ligatures, which poppler_page_find_text
+* matches through, and collapses runs of whitespace, so matches can span line breaks.
+* Indexed text and queries must go through the same normalization
+*/
+static gchar *database_normalize_text(const char *text)
+{
+    gchar *decomposed = g_utf8_normalize(text, -1, G_NORMALIZE_ALL);
+    gchar *folded = g_utf8_casefold(decomposed != NULL ? decomposed : text, -1);
+    GString *normalized = g_string_sized_new(strlen(folded));
+    bool in_space = true;
+    gunichar c;
+
+    for (const gchar *p = folded; *p != '\0'; p = g_utf8_next_char(p)) {
+        c = g_utf8_get_char(p);
+        if (g_unichar_isspace(c)) {
+            in_space = true;
+            continue;
         }
+
+        if (in_space && normalized->len > 0) {
+            g_string_append_c(normalized, ' ');
+        }
+        in_space = false;
+        g_string_append_unichar(normalized, c);
     }
 
-    sqlite3_finalize(stmt);
+    g_free(decomposed);
+    g_free(folded);
+
+    return g_string_free(normalized, FALSE);
+}
+
+static bool database_exec(Database *db, const char *sql)
+{
+    char *errmsg = NULL;
+    int rc = sqlite3_exec(db->handle, sql, NULL, NULL, &errmsg);
 
-    return groups;
+    if (rc != SQLITE_OK) {
+        g_printerr("database_exec: %s\n", errmsg);
+        sqlite3_free(errmsg);
+    }
+
+    return rc == SQLITE_OK;
+}
+
+static bool database_cursor_equal(ViewerCursor *a, ViewerCursor *b)
+{
+    return b != NULL &&
+        a->current_page == b->current_page &&
+        a->x_offset == b->x_offset &&
+        a->y_offset == b->y_offset &&
+        a->scale == b->scale &&
+        a->center_mode == b->center_mode &&
+        a->dark_mode == b->dark_mode &&
+        a->input_number == b->input_number;
 }
 
 static void database_printerr_stmt(Database *db, sqlite3_stmt *stmt)
@@ -765,4 +1386,33 @@ static void database_printerr_stmt(Database *db, sqlite3_stmt *stmt)
 static void database_printerr_sql(Database *db, char *sql)
 {
     g_print("\"%s\": %s\n", sql, sqlite3_errmsg(db->handle));
+}
+
+static bool database_group_equal(ViewerMarkGroup *a, ViewerMarkGroup *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->current_mark != b->current_mark || a->previous_mark != b->previous_mark) {
+        return false;
+    }
+    for (unsigned int i = 0; i < NUM_MARKS; i++) {
+        if (a->marks[i] == NULL ? b->marks[i] != NULL : !database_cursor_equal(a->marks[i], b->marks[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool database_mark_manager_equal(ViewerMarkManager *a, ViewerMarkManager *b)
+{
+    if (a->current_group != b->current_group || a->previous_group != b->previous_group) {
+        return false;
+    }
+    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+        if (!database_group_equal(a->groups[i], b->groups[i])) {
+            return false;
+        }
+    }
+    return true;
 }
\ No newline at end of file
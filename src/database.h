@@ -5,8 +5,68 @@
 #include "viewer_mark_group.h"
 #include "viewer_mark_manager.h"
 
+/* Statements prepared once per connection, see database_get_stmt */
+typedef enum DatabaseStmt {
+    DATABASE_STMT_BEGIN,
+    DATABASE_STMT_COMMIT,
+    DATABASE_STMT_ROLLBACK,
+    DATABASE_STMT_INSERT_CURSOR,
+    DATABASE_STMT_UPDATE_CURSOR,
+    DATABASE_STMT_DELETE_CURSOR,
+    DATABASE_STMT_DELETE_CURSOR_FROM_GROUP,
+    DATABASE_STMT_INSERT_GROUP,
+    DATABASE_STMT_UPDATE_GROUP,
+    DATABASE_STMT_INSERT_CURSOR_INTO_GROUP,
+    DATABASE_STMT_UPSERT_MARK_MANAGER,
+    DATABASE_STMT_INSERT_GROUP_INTO_MARK_MANAGER,
+    DATABASE_STMT_GET_MARK_MANAGER_IDS,
+    DATABASE_STMT_GET_MARK_MANAGER,
+    DATABASE_STMT_GET_TEXT_DOCUMENT,
+    DATABASE_STMT_INSERT_TEXT_DOCUMENT,
+    DATABASE_STMT_GET_REPLACED_TEXT_DOCUMENTS,
+    DATABASE_STMT_DELETE_TEXT_DOCUMENT,
+    DATABASE_STMT_DELETE_PAGE_TEXTS,
+    DATABASE_STMT_INSERT_PAGE_TEXT,
+    DATABASE_STMT_SET_INDEXED_PAGES,
+    DATABASE_STMT_FIND_TEXT_PAGES,
+    DATABASE_STMT_SEARCH_TEXT,
+    DATABASE_STMT_GET_METADATA,
+    DATABASE_STMT_DELETE_REPLACED_METADATA,
+    DATABASE_STMT_UPSERT_METADATA,
+    DATABASE_STMT_GET_RECENT_DOCUMENTS,
+    DATABASE_N_STMTS,
+} DatabaseStmt;
+
+/* What is derived from a document when it is opened, cached by fingerprint. Stored as numbers */
+typedef enum DatabaseMetadataKind {
+    // See viewer_info_page_sizes_to_variant
+    DATABASE_METADATA_PAGE_SIZES,
+    // See outline_to_variant
+    DATABASE_METADATA_OUTLINE,
+    // See thumbnail_render_async
+    DATABASE_METADATA_THUMBNAIL,
+} DatabaseMetadataKind;
+
+/* A document with a mark manager */
+typedef struct DatabaseRecentDocument {
+    gchar *uri;
+    // PNG data, NULL if no thumbnail was rendered yet
+    GBytes *thumbnail;
+} DatabaseRecentDocument;
+
+/* A page of a document with a mark manager containing the text searched for */
+typedef struct DatabaseTextMatch {
+    gchar *uri;
+    int page;
+    // Text around the match
+    gchar *snippet;
+} DatabaseTextMatch;
+
 typedef struct Database {
     sqlite3 *handle;
+    gchar *path;
+    // NULL until first used
+    sqlite3_stmt *stmts[DATABASE_N_STMTS];
 } Database;
 
 Database *database_open(const char *path);
@@ -20,24 +80,70 @@ void database_create_tables(Database *db);
 int database_get_version(Database *db);
 void database_check_update(Database *db, const char *path);
 
+// Transactions
+bool database_begin(Database *db);
+bool database_commit(Database *db);
+void database_rollback(Database *db);
+
 // Cursor
 sqlite3_int64 database_insert_cursor(Database *db, ViewerCursor *cursor);
-void database_update_cursor(Database *db, int id, ViewerCursor *cursor);
-void database_delete_cursor(Database *db, int id);
-ViewerCursor *database_get_cursor(Database *db, int id);
+bool database_update_cursor(Database *db, sqlite3_int64 id, ViewerCursor *cursor);
+bool database_delete_cursor(Database *db, sqlite3_int64 id);
 
 // Group
 sqlite3_int64 database_insert_group(Database *db, ViewerMarkGroup *group);
-sqlite3_int64 database_insert_cursor_into_group(Database *db, int group_id, int cursor_id, int cursor_index);
-void database_update_group(Database *db, int id, ViewerMarkGroup *group);
-void database_update_cursor_in_group(Database *db, int group_id, int cursor_index, ViewerCursor *cursor);
-ViewerMarkGroup *database_get_group(Database *db, int id);
-ViewerCursor **database_get_group_cursors(Database *db, int id);
+sqlite3_int64 database_insert_cursor_into_group(Database *db, sqlite3_int64 group_id, sqlite3_int64 cursor_id, int cursor_index);
+bool database_update_group(Database *db, sqlite3_int64 id, ViewerMarkGroup *group);
 
 // Mark manager
+/* Both write the whole mark manager in one transaction, inserting or removing rows as needed */
 void database_insert_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager);
-sqlite3_int64 database_insert_group_into_mark_manager(Database *db, const char *uri, int group_id, int group_index);
 void database_update_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager);
-void database_update_groups_in_mark_manager(Database *db, const char *uri, ViewerMarkGroup **groups);
+sqlite3_int64 database_insert_group_into_mark_manager(Database *db, const char *uri, sqlite3_int64 group_id, int group_index);
+/*
+* Only writes the rows that changed since saved, the state last written for
+* uri, or all of them if saved is NULL. Returns whether it was committed
+*/
+bool database_save_mark_manager(Database *db, const char *uri, ViewerMarkManager *manager, ViewerMarkManager *saved);
+/* Loads all groups and marks with a single query. NULL if uri has no mark manager */
 ViewerMarkManager *database_get_mark_manager(Database *db, const char *uri);
-ViewerMarkGroup **database_get_mark_manager_groups(Database *db, const char *uri);
\ No newline at end of file
+
+// Text index, keyed by the fingerprint of the document. Pages are indexed in order
+/* False if SQLite lacks FTS5, in which case the other text index functions fail */
+bool database_has_text_index(Database *db);
+/*
+* Id of the text of the document, added if not indexed yet, which replaces
+* the text of earlier versions of uri. Sets indexed_pages to the number of
+* pages already indexed
+*/
+sqlite3_int64 database_get_text_document(Database *db, const char *fingerprint, const char *uri, int n_pages, int *indexed_pages);
+bool database_insert_page_text(Database *db, sqlite3_int64 document_id, int page, const char *text);
+bool database_set_indexed_pages(Database *db, sqlite3_int64 document_id, int indexed_pages);
+/*
+* Pages containing text, ignoring case and line breaks, in ascending order.
+* Only covers the first indexed_pages pages. NULL if the document isn't
+* indexed or text is too short to be looked up
+*/
+GArray *database_find_text_pages(Database *db, const char *fingerprint, const char *text, int *indexed_pages);
+/* Best matches of text in all documents with a mark manager, at most limit */
+GPtrArray *database_search_text(Database *db, const char *text, int limit);
+void database_text_match_free(DatabaseTextMatch *match);
+/* Drops the text of documents that no longer have a mark manager */
+void database_collect_text_garbage(Database *db);
+
+// Metadata cache
+/* NULL if nothing of kind is cached for fingerprint */
+GVariant *database_get_metadata(Database *db, const char *fingerprint, DatabaseMetadataKind kind, const GVariantType *type);
+/* Also drops the metadata of earlier versions of uri */
+bool database_put_metadata(Database *db, const char *fingerprint, const char *uri, DatabaseMetadataKind kind, GVariant *data);
+/* The limit most recently opened documents, most recent first */
+GPtrArray *database_get_recent_documents(Database *db, int limit);
+void database_recent_document_free(DatabaseRecentDocument *document);
+
+// Maintenance
+/*
+* Forgets documents whose file was deleted, and all but the max_documents
+* most recently opened ones (0 keeps all), then removes rows no longer
+* reachable from a mark manager and returns the free pages to the file system
+*/
+void database_collect_garbage(Database *db, int max_documents);
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+
+#include "database_writer.h"
+
+typedef enum {
+    DATABASE_WRITE_JOB_SAVE,
+    DATABASE_WRITE_JOB_COLLECT_GARBAGE,
+    DATABASE_WRITE_JOB_PUT_METADATA,
+    DATABASE_WRITE_JOB_STOP,
+} DatabaseWriteJobType;
+
+typedef struct {
+    DatabaseWriteJobType type;
+    gchar *uri;
+    ViewerMarkManager *manager;
+    int max_documents;
+    gchar *fingerprint;
+    DatabaseMetadataKind kind;
+    GVariant *metadata;
+} DatabaseWriteJob;
+
+static gpointer database_writer_thread(gpointer data);
+
+DatabaseWriter *database_writer_new(const char *path)
+{
+    DatabaseWriter *writer = malloc(sizeof(DatabaseWriter));
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    database_writer_init(writer, path);
+
+    return writer;
+}
+
+void database_writer_init(DatabaseWriter *writer, const char *path)
+{
+    database_init(&writer->db, path);
+    writer->jobs = g_async_queue_new();
+    writer->saved = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)viewer_mark_manager_destroy);
+    writer->thread = g_thread_new("database-writer", database_writer_thread, writer);
+}
+
+void database_writer_destroy(DatabaseWriter *writer)
+{
+    DatabaseWriteJob *stop = g_new0(DatabaseWriteJob, 1);
+
+    stop->type = DATABASE_WRITE_JOB_STOP;
+
+    g_async_queue_push(writer->jobs, stop);
+    g_thread_join(writer->thread);
+
+    g_async_queue_unref(writer->jobs);
+    g_hash_table_destroy(writer->saved);
+    database_close(&writer->db);
+}
+
+void database_writer_save(DatabaseWriter *writer, const char *uri, ViewerMarkManager *manager)
+{
+    DatabaseWriteJob *job = g_new0(DatabaseWriteJob, 1);
+
+    job->type = DATABASE_WRITE_JOB_SAVE;
+    job->uri = g_strdup(uri);
+    job->manager = manager;
+    g_async_queue_push(writer->jobs, job);
+}
+
+void database_writer_collect_garbage(DatabaseWriter *writer, int max_documents)
+{
+    DatabaseWriteJob *job = g_new0(DatabaseWriteJob, 1);
+
+    job->type = DATABASE_WRITE_JOB_COLLECT_GARBAGE;
+    job->max_documents = max_documents;
+    g_async_queue_push(writer->jobs, job);
+}
+
+void database_writer_put_metadata(DatabaseWriter *writer, const char *fingerprint, const char *uri, DatabaseMetadataKind kind, GVariant *data)
+{
+    DatabaseWriteJob *job = g_new0(DatabaseWriteJob, 1);
+
+    job->type = DATABASE_WRITE_JOB_PUT_METADATA;
+    job->fingerprint = g_strdup(fingerprint);
+    job->uri = g_strdup(uri);
+    job->kind = kind;
+    job->metadata = g_variant_ref_sink(data);
+    g_async_queue_push(writer->jobs, job);
+}
+
+static gpointer database_writer_thread(gpointer data)
+{
+    DatabaseWriter *writer = data;
+    DatabaseWriteJob *job;
+    ViewerMarkManager *saved;
+
+    while ((job = g_async_queue_pop(writer->jobs))->type != DATABASE_WRITE_JOB_STOP) {
+        if (job->type == DATABASE_WRITE_JOB_COLLECT_GARBAGE) {
+            database_collect_garbage(&writer->db, job->max_documents);
+            // Removed documents must be written in full if saved again
+            g_hash_table_remove_all(writer->saved);
+            g_free(job);
+            continue;
+        }
+        if (job->type == DATABASE_WRITE_JOB_PUT_METADATA) {
+            database_put_metadata(&writer->db, job->fingerprint, job->uri, job->kind, job->metadata);
+            g_free(job->fingerprint);
+            g_free(job->uri);
+            g_variant_unref(job->metadata);
+            g_free(job);
+            continue;
+        }
+
+        saved = g_hash_table_lookup(writer->saved, job->uri);
+
+        if (database_save_mark_manager(&writer->db, job->uri, job->manager, saved)) {
+            g_hash_table_replace(writer->saved, job->uri, job->manager);
+        } else {
+            // Compare the next save against what was last written
+            g_free(job->uri);
+            viewer_mark_manager_destroy(job->manager);
+        }
+        g_free(job);
+    }
+    g_free(job);
+
+    return NULL;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "database.h"
+
+/*
+* Saves mark managers on a background thread with its own connection to the
+* database. Each save only writes the rows that changed since the previous
+* save of the same URI, see database_save_mark_manager.
+*/
+
+typedef struct DatabaseWriter {
+    Database db;
+    GThread *thread;
+    // DatabaseWriteJob *, processed in order
+    GAsyncQueue *jobs;
+    // Key: URI, Value: ViewerMarkManager * last written. Only used by the thread
+    GHashTable *saved;
+} DatabaseWriter;
+
+DatabaseWriter *database_writer_new(const char *path);
+void database_writer_init(DatabaseWriter *writer, const char *path);
+/* Finishes the queued saves before returning */
+void database_writer_destroy(DatabaseWriter *writer);
+
+/* Takes ownership of manager, which must not share groups or marks with others */
+void database_writer_save(DatabaseWriter *writer, const char *uri, ViewerMarkManager *manager);
+/* Runs database_collect_garbage after the saves queued before it */
+void database_writer_collect_garbage(DatabaseWriter *writer, int max_documents);
+/* Runs database_put_metadata, taking ownership of data if it is floating */
+void database_writer_put_metadata(DatabaseWriter *writer, const char *fingerprint, const char *uri, DatabaseMetadataKind kind, GVariant *data);
@@ -0,0 +1,67 @@
+#include <stdbool.h>
+
+#include "fingerprint.h"
+
+static bool fingerprint_update_from_stream(GChecksum *checksum, GInputStream *stream, guchar *buffer, GError **error);
+
+gchar *fingerprint_new_from_gfile(GFile *file)
+{
+    GError *error = NULL;
+    GFileInfo *file_info;
+    GFileInputStream *stream;
+    GChecksum *checksum;
+    guchar *buffer;
+    goffset size;
+    guint64 mtime;
+    gchar *fingerprint = NULL;
+
+    file_info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED,
+        G_FILE_QUERY_INFO_NONE, NULL, &error);
+    if (file_info == NULL) {
+        g_printerr("fingerprint_new_from_gfile: %s\n", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    size = g_file_info_get_size(file_info);
+    mtime = g_file_info_get_attribute_uint64(file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    g_object_unref(file_info);
+
+    stream = g_file_read(file, NULL, &error);
+    if (stream == NULL) {
+        g_printerr("fingerprint_new_from_gfile: %s\n", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    buffer = g_malloc(FINGERPRINT_SAMPLE_SIZE);
+
+    if (fingerprint_update_from_stream(checksum, G_INPUT_STREAM(stream), buffer, &error) &&
+        (size <= FINGERPRINT_SAMPLE_SIZE ||
+            (g_seekable_seek(G_SEEKABLE(stream), MAX(FINGERPRINT_SAMPLE_SIZE, size - FINGERPRINT_SAMPLE_SIZE), G_SEEK_SET, NULL, &error) &&
+                fingerprint_update_from_stream(checksum, G_INPUT_STREAM(stream), buffer, &error)))) {
+        fingerprint = g_strdup_printf("%" G_GOFFSET_FORMAT "-%" G_GUINT64_FORMAT "-%s", size, mtime, g_checksum_get_string(checksum));
+    } else {
+        g_printerr("fingerprint_new_from_gfile: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_free(buffer);
+    g_checksum_free(checksum);
+    g_object_unref(stream);
+
+    return fingerprint;
+}
+
+/* Hashes up to FINGERPRINT_SAMPLE_SIZE bytes from the current position */
+static bool fingerprint_update_from_stream(GChecksum *checksum, GInputStream *stream, guchar *buffer, GError **error)
+{
+    gsize n_read;
+
+    if (!g_input_stream_read_all(stream, buffer, FINGERPRINT_SAMPLE_SIZE, &n_read, NULL, error)) {
+        return false;
+    }
+    g_checksum_update(checksum, buffer, n_read);
+
+    return true;
+}
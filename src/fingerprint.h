@@ -0,0 +1,15 @@
+#pragma once
+
+#include <gio/gio.h>
+
+/*
+* Identifies the contents of a file without reading all of it: its size,
+* modification time and a hash of its first and last FINGERPRINT_SAMPLE_SIZE
+* bytes, where a PDF keeps its header and cross-reference table. Used as the
+* key of everything cached about a document in the database.
+*/
+
+#define FINGERPRINT_SAMPLE_SIZE (64 * 1024)
+
+/* NULL if the file can't be read */
+gchar *fingerprint_new_from_gfile(GFile *file);
@@ -0,0 +1,147 @@
+#include <glib.h>
+#include <math.h>
+
+#include "hint_atlas.h"
+
+/* Same as the hints drawn with cairo_text_path before */
+#define HINT_FONT_SIZE 10.0
+#define HINT_OUTLINE_WIDTH 2.0
+#define SCALE_EPSILON 1e-6
+/* Scales with a cached atlas, about one per window in follow links mode */
+#define HINT_ATLAS_CACHE_SIZE 4
+
+static GMutex atlas_mutex;
+// Most recently used first, NULL past the last one
+static HintAtlas *cached_atlases[HINT_ATLAS_CACHE_SIZE] = { NULL };
+
+static HintAtlas *hint_atlas_new(double scale);
+static void hint_atlas_clear(gpointer data);
+
+HintAtlas *hint_atlas_get(double scale)
+{
+    HintAtlas *atlas = NULL;
+    int i;
+
+    g_mutex_lock(&atlas_mutex);
+    for (i = 0; i < HINT_ATLAS_CACHE_SIZE && cached_atlases[i] != NULL; i++) {
+        if (fabs(cached_atlases[i]->scale - scale) <= SCALE_EPSILON) {
+            atlas = cached_atlases[i];
+            break;
+        }
+    }
+
+    if (atlas == NULL) {
+        i = HINT_ATLAS_CACHE_SIZE - 1;
+        // Threads still drawing with the evicted atlas keep their reference
+        if (cached_atlases[i] != NULL) {
+            hint_atlas_unref(cached_atlases[i]);
+        }
+        atlas = hint_atlas_new(scale);
+    }
+
+    // Move it to the front
+    for (; i > 0; i--) {
+        cached_atlases[i] = cached_atlases[i - 1];
+    }
+    cached_atlases[0] = atlas;
+
+    atlas = g_atomic_rc_box_acquire(atlas);
+    g_mutex_unlock(&atlas_mutex);
+
+    return atlas;
+}
+
+void hint_atlas_unref(HintAtlas *atlas)
+{
+    g_atomic_rc_box_release_full(atlas, hint_atlas_clear);
+}
+
+void hint_atlas_draw_number(HintAtlas *atlas, cairo_t *cr, unsigned int number)
+{
+    char digits[16];
+    int n_digits = 0;
+    double x, y, cell_x, cell_y;
+
+    do {
+        digits[n_digits++] = number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    // Blit in device space, so cells map 1:1 to pixels
+    cairo_get_current_point(cr, &x, &y);
+    cairo_user_to_device(cr, &x, &y);
+    x -= atlas->origin_x;
+    cell_y = round(y - atlas->baseline);
+
+    cairo_save(cr);
+    cairo_identity_matrix(cr);
+    cairo_new_path(cr);
+    for (int i = n_digits - 1; i >= 0; i--) {
+        const int digit = digits[i];
+
+        cell_x = round(x);
+        cairo_set_source_surface(cr, atlas->surface, cell_x - digit * atlas->cell_width, cell_y);
+        cairo_rectangle(cr, cell_x, cell_y, atlas->cell_width, atlas->cell_height);
+        cairo_fill(cr);
+        x += atlas->advances[digit];
+    }
+    cairo_restore(cr);
+}
+
+static HintAtlas *hint_atlas_new(double scale)
+{
+    HintAtlas *atlas = g_atomic_rc_box_new0(HintAtlas);
+    cairo_surface_t *measure_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = cairo_create(measure_surface);
+    cairo_font_extents_t font_extents;
+    cairo_text_extents_t extents;
+    const double line_width = HINT_OUTLINE_WIDTH * scale;
+    const double pad = ceil(line_width / 2.0) + 1.0;
+    double max_advance = 0;
+    char digit[2] = { 0 };
+
+    cairo_set_font_size(cr, HINT_FONT_SIZE * scale);
+    cairo_font_extents(cr, &font_extents);
+    for (int i = 0; i < 10; i++) {
+        digit[0] = '0' + i;
+        cairo_text_extents(cr, digit, &extents);
+        atlas->advances[i] = extents.x_advance;
+        max_advance = MAX(max_advance, extents.x_advance);
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(measure_surface);
+
+    atlas->scale = scale;
+    atlas->origin_x = pad;
+    atlas->baseline = pad + ceil(font_extents.ascent);
+    atlas->cell_width = (int)ceil(max_advance + 2 * pad);
+    atlas->cell_height = (int)ceil(font_extents.ascent + font_extents.descent + 2 * pad);
+    atlas->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 10 * atlas->cell_width, atlas->cell_height);
+
+    cr = cairo_create(atlas->surface);
+    cairo_set_font_size(cr, HINT_FONT_SIZE * scale);
+    cairo_set_line_width(cr, line_width);
+    for (int i = 0; i < 10; i++) {
+        digit[0] = '0' + i;
+        cairo_move_to(cr, i * atlas->cell_width + atlas->origin_x, atlas->baseline);
+        cairo_text_path(cr, digit);
+
+        // Outline
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_stroke_preserve(cr);
+
+        // Actual text
+        cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
+        cairo_fill(cr);
+    }
+    cairo_destroy(cr);
+
+    return atlas;
+}
+
+static void hint_atlas_clear(gpointer data)
+{
+    HintAtlas *atlas = data;
+
+    cairo_surface_destroy(atlas->surface);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cairo.h>
+
+/*
+* Pre-rendered, outlined digits for the hints of follow links mode. Drawing
+* a hint blits one atlas cell per digit instead of rasterizing text, so the
+* cost per link doesn't depend on the font. The atlases of the last few
+* device scales are cached and shared by all render threads, so windows at
+* different zoom levels don't rebuild them for each other.
+*/
+
+typedef struct {
+    cairo_surface_t *surface;
+    double scale;
+    // Every digit has a cell of this size in the single row of the atlas
+    int cell_width, cell_height;
+    // Pen position of the digits within their cell
+    double origin_x, baseline;
+    double advances[10];
+} HintAtlas;
+
+/* Returns a reference to the atlas for scale, release it with hint_atlas_unref */
+HintAtlas *hint_atlas_get(double scale);
+void hint_atlas_unref(HintAtlas *atlas);
+
+/* Draws number with its baseline starting at the current point of cr */
+void hint_atlas_draw_number(HintAtlas *atlas, cairo_t *cr, unsigned int number);
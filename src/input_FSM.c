@@ -6,10 +6,12 @@
 #include "viewer_cursor.h"
 #include "viewer_search.h"
 #include "viewer_links.h"
+#include "latency.h"
 
 typedef InputState (*input_state_func)(Window *, guint);
 
 static InputState execute_command(Window *window, guint keyval, unsigned int repeat_count);
+static CommandKind execute_command_get_kind(guint keyval);
 
 input_state_func input_state_funcs[] = {
     on_state_normal,
@@ -77,15 +79,27 @@ InputState on_state_normal(Window *window, guint keyval)
         case GDK_KEY_slash:
             window_show_search_dialog(window);
             break;
+        case GDK_KEY_S:
+            window_show_text_search_dialog(window);
+            break;
         case GDK_KEY_question:
             window_show_help_dialog(window);
             break;
         case GDK_KEY_o:
             app_open_file_chooser(JUMPDF_APP(gtk_window_get_application(GTK_WINDOW(window))));
             break;
+        case GDK_KEY_O:
+            window_show_quick_open_dialog(window);
+            break;
+        case GDK_KEY_F10:
+            app_dump_metrics(JUMPDF_APP(gtk_window_get_application(GTK_WINDOW(window))));
+            break;
         case GDK_KEY_F11:
             window_toggle_fullscreen(window);
             break;
+        case GDK_KEY_F12:
+            latency_print_histograms();
+            break;
         case GDK_KEY_period:
             command_execute(&viewer->last_command, viewer);
             break;
@@ -156,14 +170,14 @@ InputState on_state_follow_links(Window *window, guint keyval)
 {
     InputState next_state;
     Viewer *viewer = window_get_viewer(window);
-    PopplerLinkMapping *link_mapping;
+    const PageLink *link;
 
     if (keyval >= GDK_KEY_0 && keyval <= GDK_KEY_9) {
         viewer->cursor->input_number = viewer->cursor->input_number * 10 + (keyval - GDK_KEY_0);
         next_state = STATE_FOLLOW_LINKS;
     } else if (keyval == GDK_KEY_Return && viewer->cursor->input_number - 1 < viewer->links->visible_links->len) {
-        link_mapping = g_ptr_array_index(viewer->links->visible_links, viewer->cursor->input_number - 1);
-        viewer_cursor_execute_action(viewer->cursor, link_mapping->action);
+        link = g_ptr_array_index(viewer->links->visible_links, viewer->cursor->input_number - 1);
+        viewer_cursor_execute_action(viewer->cursor, link->action);
         viewer->links->follow_links_mode = false;
         next_state = STATE_NORMAL;
     } else {
@@ -178,14 +192,6 @@ InputState on_state_follow_links(Window *window, guint keyval)
 InputState on_state_toc_focus(Window *window, guint keyval)
 {
     InputState next_state;
-    GtkListBox *toc_list_box = window_get_toc_listbox(window);
-    GtkListBoxRow *current_row = gtk_list_box_get_selected_row(toc_list_box);
-    int current_index;
-    GtkListBoxRow *new_row = NULL;
-
-    if (current_row != NULL) {
-        current_index = gtk_list_box_row_get_index(current_row);
-    }
 
     switch (keyval) {
     case GDK_KEY_Tab:
@@ -193,25 +199,23 @@ InputState on_state_toc_focus(Window *window, guint keyval)
         next_state = STATE_NORMAL;
         break;
     case GDK_KEY_j:
-        if (current_row != NULL) {
-            new_row = gtk_list_box_get_row_at_index(toc_list_box, current_index + 1);
-            while (new_row != NULL && !gtk_widget_get_visible(GTK_WIDGET(new_row))) {
-                new_row = gtk_list_box_get_row_at_index(toc_list_box, gtk_list_box_row_get_index(new_row) + 1);
-            }
-        }
+        window_move_toc_selection(window, 1);
         next_state = STATE_TOC_FOCUS;
         break;
     case GDK_KEY_k:
-        if (current_row != NULL) {
-            new_row = gtk_list_box_get_row_at_index(toc_list_box, current_index - 1);
-            while (new_row != NULL && !gtk_widget_get_visible(GTK_WIDGET(new_row))) {
-                new_row = gtk_list_box_get_row_at_index(toc_list_box, gtk_list_box_row_get_index(new_row) - 1);
-            }
-        }
+        window_move_toc_selection(window, -1);
+        next_state = STATE_TOC_FOCUS;
+        break;
+    case GDK_KEY_h:
+        window_set_toc_selection_expanded(window, false);
+        next_state = STATE_TOC_FOCUS;
+        break;
+    case GDK_KEY_l:
+        window_set_toc_selection_expanded(window, true);
         next_state = STATE_TOC_FOCUS;
         break;
     case GDK_KEY_Return:
-        window_execute_toc_row(window, current_row);
+        window_execute_toc_selection(window);
         next_state = STATE_TOC_FOCUS;
         break;
     case GDK_KEY_slash:
@@ -223,10 +227,6 @@ InputState on_state_toc_focus(Window *window, guint keyval)
         break;
     }
 
-    if (new_row != NULL) {
-        gtk_list_box_select_row(toc_list_box, new_row);
-    }
-
     return next_state;
 }
 
@@ -326,6 +326,89 @@ InputState execute_state(InputState current_state, Window *window, guint keyval)
     return input_state_funcs[current_state](window, keyval);
 }
 
+CommandKind input_state_get_command_kind(InputState current_state, Window *window, guint keyval)
+{
+    Viewer *viewer = window_get_viewer(window);
+    const bool is_digit = keyval >= GDK_KEY_1 && keyval <= GDK_KEY_9;
+
+    switch (current_state) {
+    case STATE_NORMAL:
+        switch (keyval) {
+        case GDK_KEY_0:
+        case GDK_KEY_s:
+        case GDK_KEY_a:
+            return COMMAND_KIND_ZOOM;
+        case GDK_KEY_G:
+        case GDK_KEY_Home:
+        case GDK_KEY_End:
+            return COMMAND_KIND_GOTO;
+        case GDK_KEY_period:
+            return command_get_kind(&viewer->last_command);
+        case GDK_KEY_comma:
+            return command_get_kind(&viewer->last_jump_command);
+        default:
+            return is_digit ? COMMAND_KIND_NONE : execute_command_get_kind(keyval);
+        }
+    case STATE_NUMBER:
+        if (keyval == GDK_KEY_G) {
+            return COMMAND_KIND_GOTO;
+        } else if (keyval >= GDK_KEY_0 && keyval <= GDK_KEY_9) {
+            return COMMAND_KIND_NONE;
+        } else {
+            return execute_command_get_kind(keyval);
+        }
+    case STATE_g:
+        if (is_digit || keyval == GDK_KEY_n) {
+            return COMMAND_KIND_GROUP_SWITCH;
+        } else if (keyval == GDK_KEY_g) {
+            return COMMAND_KIND_GOTO;
+        } else {
+            return COMMAND_KIND_NONE;
+        }
+    case STATE_GROUP_SWAP:
+    case STATE_GROUP_OVERWRITE:
+        return is_digit ? COMMAND_KIND_GROUP_SWITCH : COMMAND_KIND_NONE;
+    case STATE_MARK:
+        return is_digit || keyval == GDK_KEY_n ? COMMAND_KIND_MARK_SWITCH : COMMAND_KIND_NONE;
+    case STATE_MARK_SWAP:
+    case STATE_MARK_OVERWRITE:
+        return is_digit ? COMMAND_KIND_MARK_SWITCH : COMMAND_KIND_NONE;
+    case STATE_FOLLOW_LINKS:
+        return keyval == GDK_KEY_Return ? COMMAND_KIND_LINK_FOLLOW : COMMAND_KIND_NONE;
+    case STATE_TOC_FOCUS:
+        return keyval == GDK_KEY_Return ? COMMAND_KIND_GOTO : COMMAND_KIND_NONE;
+    default:
+        return COMMAND_KIND_NONE;
+    }
+}
+
+static CommandKind execute_command_get_kind(guint keyval)
+{
+    switch (keyval) {
+    case GDK_KEY_plus:
+    case GDK_KEY_minus:
+        return COMMAND_KIND_ZOOM;
+    case GDK_KEY_u:
+    case GDK_KEY_Page_Up:
+    case GDK_KEY_d:
+    case GDK_KEY_Page_Down:
+    case GDK_KEY_h:
+    case GDK_KEY_Left:
+    case GDK_KEY_j:
+    case GDK_KEY_Down:
+    case GDK_KEY_k:
+    case GDK_KEY_Up:
+    case GDK_KEY_l:
+    case GDK_KEY_Right:
+        return COMMAND_KIND_SCROLL;
+    case GDK_KEY_n:
+    case GDK_KEY_N:
+        return COMMAND_KIND_SEARCH;
+    default:
+        return COMMAND_KIND_NONE;
+    }
+}
+
 static InputState execute_command(Window *window, guint keyval, unsigned int repeat_count)
 {
     InputState next_state = STATE_NORMAL;
@@ -29,4 +29,6 @@ InputState on_state_mark_clear(Window *window, guint keyval);
 InputState on_state_mark_swap(Window *window, guint keyval);
 InputState on_state_mark_overwrite(Window *window, guint keyval);
 
-InputState execute_state(InputState current_state, Window *window, guint keyval);
\ No newline at end of file
+InputState execute_state(InputState current_state, Window *window, guint keyval);
+/* What kind of command execute_state will run for keyval, without running it */
+CommandKind input_state_get_command_kind(InputState current_state, Window *window, guint keyval);
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "viewer.h"
 #include "viewer_mark_manager.h"
 #include "utils.h"
+#include "watchdog.h"
 
 Command command_copy(Command *command)
 {
@@ -25,6 +26,49 @@ void command_execute(Command *command, Viewer *viewer)
     }
 }
 
+CommandKind command_get_kind(Command *command)
+{
+    CommandExecute execute = command != NULL ? command->execute : NULL;
+
+    if (execute == zoom_in || execute == zoom_out) {
+        return COMMAND_KIND_ZOOM;
+    } else if (execute == scroll_half_page_up || execute == scroll_half_page_down ||
+        execute == scroll_left || execute == scroll_down ||
+        execute == scroll_up || execute == scroll_right) {
+        return COMMAND_KIND_SCROLL;
+    } else if (execute == forward_search || execute == backward_search) {
+        return COMMAND_KIND_SEARCH;
+    } else if (execute == switch_to_previous_mark) {
+        return COMMAND_KIND_MARK_SWITCH;
+    } else if (execute == switch_to_previous_group) {
+        return COMMAND_KIND_GROUP_SWITCH;
+    } else {
+        return COMMAND_KIND_NONE;
+    }
+}
+
+const char *command_kind_to_str(CommandKind kind)
+{
+    switch (kind) {
+    case COMMAND_KIND_SCROLL:
+        return "Scroll";
+    case COMMAND_KIND_ZOOM:
+        return "Zoom";
+    case COMMAND_KIND_GOTO:
+        return "Goto";
+    case COMMAND_KIND_SEARCH:
+        return "Search";
+    case COMMAND_KIND_MARK_SWITCH:
+        return "Mark switch";
+    case COMMAND_KIND_GROUP_SWITCH:
+        return "Group switch";
+    case COMMAND_KIND_LINK_FOLLOW:
+        return "Link follow";
+    default:
+        return NULL;
+    }
+}
+
 void zoom_in(struct Viewer *viewer, unsigned int repeat_count, void *data)
 {
     double scale_step = *(double *)data;
@@ -105,6 +149,7 @@ void forward_search(struct Viewer *viewer, unsigned int repeat_count, void *data
     ViewerCursor *search_new_cursor = current_cursor;
     ViewerCursor *last_search_cursor = NULL;
     ViewerCursor *resulting_cursor = NULL;
+    const char *previous_operation = watchdog_enter("forward_search");
 
     for (unsigned int i = 0; i < repeat_count; i++) {
         last_search_cursor = search_new_cursor;
@@ -119,6 +164,8 @@ void forward_search(struct Viewer *viewer, unsigned int repeat_count, void *data
         resulting_cursor = search_new_cursor;
     }
 
+    watchdog_leave(previous_operation);
+
     viewer_mark_manager_set_current_cursor(mark_manager, resulting_cursor);
 }
 
@@ -130,6 +177,7 @@ void backward_search(struct Viewer *viewer, unsigned int repeat_count, void *dat
     ViewerCursor *search_new_cursor = current_cursor;
     ViewerCursor *last_search_cursor = NULL;
     ViewerCursor *resulting_cursor = NULL;
+    const char *previous_operation = watchdog_enter("backward_search");
 
     for (unsigned int i = 0; i < repeat_count; i++) {
         last_search_cursor = search_new_cursor;
@@ -144,6 +192,8 @@ void backward_search(struct Viewer *viewer, unsigned int repeat_count, void *dat
         resulting_cursor = search_new_cursor;
     }
 
+    watchdog_leave(previous_operation);
+
     viewer_mark_manager_set_current_cursor(mark_manager, resulting_cursor);
 }
 
@@ -2,6 +2,19 @@
 
 struct Viewer;
 
+/* Coarse classification of commands, e.g. for latency measurements */
+typedef enum {
+    COMMAND_KIND_NONE = 0,
+    COMMAND_KIND_SCROLL,
+    COMMAND_KIND_ZOOM,
+    COMMAND_KIND_GOTO,
+    COMMAND_KIND_SEARCH,
+    COMMAND_KIND_MARK_SWITCH,
+    COMMAND_KIND_GROUP_SWITCH,
+    COMMAND_KIND_LINK_FOLLOW,
+    COMMAND_KIND_COUNT,
+} CommandKind;
+
 typedef void (*CommandExecute)(struct Viewer *viewer, unsigned int repeat_count, void *data);
 
 typedef struct {
@@ -12,6 +25,8 @@ typedef struct {
 
 Command command_copy(Command *command);
 void command_execute(Command *command, struct Viewer *viewer);
+CommandKind command_get_kind(Command *command);
+const char *command_kind_to_str(CommandKind kind);
 
 void zoom_in(struct Viewer *viewer, unsigned int repeat_count, void *data);
 void zoom_out(struct Viewer *viewer, unsigned int repeat_count, void *data);
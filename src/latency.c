@@ -0,0 +1,173 @@
+#include <math.h>
+
+#include "latency.h"
+
+/* Buckets are 1/8th of a power of two wide, up to 2^27 µs (~134 s) */
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_BUCKETS (27 * LATENCY_SUB_BUCKETS)
+/* GdkEvent times further in the past than this are assumed to be on another clock */
+#define LATENCY_MAX_EVENT_AGE_MS 10000
+/* How long to wait for the compositor to report the presentation time */
+#define LATENCY_PRESENTATION_TIMEOUT_US 100000
+
+typedef struct {
+    guint64 counts[LATENCY_BUCKETS];
+    guint64 total;
+    gint64 max;
+} LatencyHistogram;
+
+static LatencyHistogram histograms[COMMAND_KIND_COUNT];
+
+static int latency_bucket(gint64 latency_us);
+static gint64 latency_bucket_upper_bound(int bucket);
+
+void latency_probe_init(LatencyProbe *probe)
+{
+    probe->kind = COMMAND_KIND_NONE;
+    probe->start = 0;
+    probe->painted_at = 0;
+    probe->frame = -1;
+}
+
+void latency_probe_start(LatencyProbe *probe, CommandKind kind, guint32 event_time)
+{
+    const gint64 now = g_get_monotonic_time();
+    // Event times are 32-bit ms, so compare with wraparound
+    const guint32 event_age_ms = (guint32)(now / 1000) - event_time;
+    gint64 start;
+
+    /*
+    * On Wayland and X11 on Linux, event times are usually CLOCK_MONOTONIC ms,
+    * same as g_get_monotonic_time. Otherwise, fall back to the time of dispatch
+    */
+    if (event_time != GDK_CURRENT_TIME && event_age_ms < LATENCY_MAX_EVENT_AGE_MS) {
+        start = now - (gint64)event_age_ms * 1000;
+    } else {
+        start = now;
+    }
+
+    /*
+    * A command still waiting for its frame took at least until this event.
+    * Dropping it would leave out exactly the slow samples under key repeat
+    */
+    if (probe->kind != COMMAND_KIND_NONE) {
+        latency_record(probe->kind, MAX(start - probe->start, 0));
+    }
+
+    latency_probe_init(probe);
+    probe->kind = kind;
+    probe->start = start;
+}
+
+void latency_probe_frame_drawn(LatencyProbe *probe, GdkFrameClock *frame_clock)
+{
+    if (probe->kind == COMMAND_KIND_NONE || probe->frame >= 0 || frame_clock == NULL) {
+        return;
+    }
+
+    probe->frame = gdk_frame_clock_get_frame_counter(frame_clock);
+}
+
+void latency_probe_after_paint(LatencyProbe *probe, GdkFrameClock *frame_clock)
+{
+    GdkFrameTimings *timings;
+    gint64 presented_at = 0;
+    const gint64 now = g_get_monotonic_time();
+
+    if (probe->kind == COMMAND_KIND_NONE || probe->frame < 0) {
+        return;
+    }
+
+    if (probe->painted_at == 0) {
+        probe->painted_at = now;
+    }
+
+    timings = gdk_frame_clock_get_timings(frame_clock, probe->frame);
+    if (timings != NULL && gdk_frame_timings_get_complete(timings)) {
+        presented_at = gdk_frame_timings_get_presentation_time(timings);
+        if (presented_at == 0) {
+            // Backend does not report presentation times
+            presented_at = probe->painted_at;
+        }
+    } else if (timings == NULL || now - probe->painted_at > LATENCY_PRESENTATION_TIMEOUT_US) {
+        presented_at = probe->painted_at;
+    } else {
+        // Keep frames coming until the timings are complete
+        gdk_frame_clock_request_phase(frame_clock, GDK_FRAME_CLOCK_PHASE_AFTER_PAINT);
+        return;
+    }
+
+    latency_record(probe->kind, MAX(0, presented_at - probe->start));
+    latency_probe_init(probe);
+}
+
+void latency_record(CommandKind kind, gint64 latency_us)
+{
+    LatencyHistogram *histogram;
+
+    if (kind <= COMMAND_KIND_NONE || kind >= COMMAND_KIND_COUNT) {
+        return;
+    }
+
+    histogram = &histograms[kind];
+    histogram->counts[latency_bucket(latency_us)]++;
+    histogram->total++;
+    histogram->max = MAX(histogram->max, latency_us);
+}
+
+void latency_print_histograms(void)
+{
+    const char *name;
+
+    g_print("%-14s %8s %10s %10s %10s %10s\n", "Command", "Count", "p50 (ms)", "p95 (ms)", "p99 (ms)", "Max (ms)");
+    for (int kind = COMMAND_KIND_NONE + 1; kind < COMMAND_KIND_COUNT; kind++) {
+        name = command_kind_to_str(kind);
+        g_print("%-14s %8" G_GUINT64_FORMAT " %10.1f %10.1f %10.1f %10.1f\n",
+            name,
+            histograms[kind].total,
+            latency_get_percentile(kind, 0.50) / 1000.0,
+            latency_get_percentile(kind, 0.95) / 1000.0,
+            latency_get_percentile(kind, 0.99) / 1000.0,
+            histograms[kind].max / 1000.0);
+    }
+}
+
+gint64 latency_get_percentile(CommandKind kind, double p)
+{
+    LatencyHistogram *histogram = &histograms[kind];
+    guint64 rank;
+    guint64 seen = 0;
+
+    if (histogram->total == 0) {
+        return 0;
+    }
+
+    rank = MAX(1, (guint64)ceil(p * histogram->total));
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            return MIN(latency_bucket_upper_bound(i), histogram->max);
+        }
+    }
+
+    return histogram->max;
+}
+
+guint64 latency_get_count(CommandKind kind)
+{
+    return histograms[kind].total;
+}
+
+static int latency_bucket(gint64 latency_us)
+{
+    if (latency_us < 1) {
+        return 0;
+    }
+
+    return MIN(LATENCY_BUCKETS - 1, (int)(LATENCY_SUB_BUCKETS * log2((double)latency_us)));
+}
+
+static gint64 latency_bucket_upper_bound(int bucket)
+{
+    return (gint64)ceil(exp2((double)(bucket + 1) / LATENCY_SUB_BUCKETS));
+}
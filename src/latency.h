@@ -0,0 +1,33 @@
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "input_cmd.h"
+
+/*
+* Measures the time from a key event until the first presented frame
+* that shows the fully rendered result of the command it triggered.
+* Latencies are kept in one histogram per CommandKind for the whole process.
+*/
+
+typedef struct LatencyProbe {
+    CommandKind kind;
+    // Monotonic times in µs, 0 if unset
+    gint64 start;
+    gint64 painted_at;
+    // Frame counter of the frame that showed the result, -1 if not drawn yet
+    gint64 frame;
+} LatencyProbe;
+
+void latency_probe_init(LatencyProbe *probe);
+/* event_time is the GdkEvent time in ms */
+void latency_probe_start(LatencyProbe *probe, CommandKind kind, guint32 event_time);
+/* To be called when a frame has been drawn with all visible pages rendered */
+void latency_probe_frame_drawn(LatencyProbe *probe, GdkFrameClock *frame_clock);
+void latency_probe_after_paint(LatencyProbe *probe, GdkFrameClock *frame_clock);
+
+void latency_record(CommandKind kind, gint64 latency_us);
+void latency_print_histograms(void);
+/* p in [0, 1]. Returns the upper bound of the bucket, or 0 if there is no data */
+gint64 latency_get_percentile(CommandKind kind, double p);
+guint64 latency_get_count(CommandKind kind);
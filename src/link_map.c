@@ -0,0 +1,146 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "link_map.h"
+
+/* Cells per side are about the square root of the number of links, up to this */
+#define LINK_MAP_MAX_GRID 32
+
+static void link_map_build_grid(LinkMap *map);
+static void link_map_get_cells(const LinkMap *map, const PopplerRectangle *area, int *from_column, int *to_column, int *from_row, int *to_row);
+static int link_map_clamp_cell(double offset, double cell_size, int n_cells);
+
+LinkMap *link_map_new(PopplerPage *page)
+{
+    LinkMap *map = malloc(sizeof(LinkMap));
+    if (map == NULL) {
+        return NULL;
+    }
+
+    link_map_init(map, page);
+
+    return map;
+}
+
+void link_map_init(LinkMap *map, PopplerPage *page)
+{
+    GList *link_mappings = poppler_page_get_link_mapping(page);
+    PopplerLinkMapping *link_mapping;
+    int i = 0;
+
+    map->n_links = g_list_length(link_mappings);
+    map->links = g_new(PageLink, map->n_links);
+
+    for (GList *l = link_mappings; l; l = l->next) {
+        link_mapping = l->data;
+        map->links[i].area = link_mapping->area;
+        map->links[i].action = poppler_action_copy(link_mapping->action);
+        i++;
+    }
+    poppler_page_free_link_mapping(link_mappings);
+
+    link_map_build_grid(map);
+}
+
+void link_map_destroy(LinkMap *map)
+{
+    for (int i = 0; i < map->n_links; i++) {
+        poppler_action_free(map->links[i].action);
+    }
+
+    g_free(map->links);
+    g_free(map->cell_start);
+    g_free(map->cell_links);
+    map->links = NULL;
+    map->cell_start = NULL;
+    map->cell_links = NULL;
+    map->n_links = 0;
+}
+
+const PageLink *link_map_hit_test(const LinkMap *map, double x, double y)
+{
+    const int column = link_map_clamp_cell(x - map->x0, map->cell_width, map->columns);
+    const int row = link_map_clamp_cell(y - map->y0, map->cell_height, map->rows);
+    const int cell = row * map->columns + column;
+
+    // Points outside the grid are clamped to its edge, the area test rules them out
+    for (int i = map->cell_start[cell]; i < map->cell_start[cell + 1]; i++) {
+        const PageLink *link = &map->links[map->cell_links[i]];
+        const PopplerRectangle *area = &link->area;
+        if (x >= MIN(area->x1, area->x2) && x <= MAX(area->x1, area->x2) &&
+            y >= MIN(area->y1, area->y2) && y <= MAX(area->y1, area->y2)) {
+            return link;
+        }
+    }
+
+    return NULL;
+}
+
+static void link_map_build_grid(LinkMap *map)
+{
+    const PopplerRectangle *area;
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    int from_column, to_column, from_row, to_row;
+    int n_cells;
+    int *next;
+
+    // Corners are kept as poppler gives them for the hints, the grid orders them itself
+    for (int i = 0; i < map->n_links; i++) {
+        area = &map->links[i].area;
+        x1 = i == 0 ? MIN(area->x1, area->x2) : MIN(x1, MIN(area->x1, area->x2));
+        y1 = i == 0 ? MIN(area->y1, area->y2) : MIN(y1, MIN(area->y1, area->y2));
+        x2 = i == 0 ? MAX(area->x1, area->x2) : MAX(x2, MAX(area->x1, area->x2));
+        y2 = i == 0 ? MAX(area->y1, area->y2) : MAX(y2, MAX(area->y1, area->y2));
+    }
+
+    map->columns = map->rows = CLAMP((int)ceil(sqrt(map->n_links)), 1, LINK_MAP_MAX_GRID);
+    map->x0 = x1;
+    map->y0 = y1;
+    map->cell_width = (x2 - x1) / map->columns;
+    map->cell_height = (y2 - y1) / map->rows;
+
+    // Counted first, so each cell's links are contiguous
+    n_cells = map->columns * map->rows;
+    map->cell_start = g_new0(int, n_cells + 1);
+    for (int i = 0; i < map->n_links; i++) {
+        link_map_get_cells(map, &map->links[i].area, &from_column, &to_column, &from_row, &to_row);
+        for (int row = from_row; row <= to_row; row++) {
+            for (int column = from_column; column <= to_column; column++) {
+                map->cell_start[row * map->columns + column + 1]++;
+            }
+        }
+    }
+    for (int c = 0; c < n_cells; c++) {
+        map->cell_start[c + 1] += map->cell_start[c];
+    }
+
+    map->cell_links = g_new(int, map->cell_start[n_cells]);
+    next = g_memdup2(map->cell_start, sizeof(int) * n_cells);
+    for (int i = 0; i < map->n_links; i++) {
+        link_map_get_cells(map, &map->links[i].area, &from_column, &to_column, &from_row, &to_row);
+        for (int row = from_row; row <= to_row; row++) {
+            for (int column = from_column; column <= to_column; column++) {
+                map->cell_links[next[row * map->columns + column]++] = i;
+            }
+        }
+    }
+    g_free(next);
+}
+
+static void link_map_get_cells(const LinkMap *map, const PopplerRectangle *area, int *from_column, int *to_column, int *from_row, int *to_row)
+{
+    *from_column = link_map_clamp_cell(MIN(area->x1, area->x2) - map->x0, map->cell_width, map->columns);
+    *to_column = link_map_clamp_cell(MAX(area->x1, area->x2) - map->x0, map->cell_width, map->columns);
+    *from_row = link_map_clamp_cell(MIN(area->y1, area->y2) - map->y0, map->cell_height, map->rows);
+    *to_row = link_map_clamp_cell(MAX(area->y1, area->y2) - map->y0, map->cell_height, map->rows);
+}
+
+/* Cell containing offset from the start of the grid. Links and points on a cell edge are in the cell above */
+static int link_map_clamp_cell(double offset, double cell_size, int n_cells)
+{
+    if (cell_size <= 0 || !(offset > 0)) {
+        return 0;
+    }
+
+    return (int)MIN(offset / cell_size, n_cells - 1);
+}
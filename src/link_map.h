@@ -0,0 +1,36 @@
+#pragma once
+
+#include <poppler.h>
+
+/*
+* Links of one page, extracted from poppler once and kept for the life of
+* the page. A uniform grid over the links lists the links overlapping each
+* cell, so a hit test only looks at the links of the cell under the point,
+* however tall or wide other links are.
+*/
+
+typedef struct {
+    // PDF points, origin at the bottom left of the page
+    PopplerRectangle area;
+    PopplerAction *action;
+} PageLink;
+
+typedef struct LinkMap {
+    // In the order of poppler, which is the order of the hints
+    PageLink *links;
+    int n_links;
+    // Grid over the bounds of all links, cells are in rows from the bottom
+    double x0, y0;
+    double cell_width, cell_height;
+    int columns, rows;
+    // Links of cell c are cell_links[cell_start[c]..cell_start[c + 1]), in the order of links
+    int *cell_start;
+    int *cell_links;
+} LinkMap;
+
+LinkMap *link_map_new(PopplerPage *page);
+void link_map_init(LinkMap *map, PopplerPage *page);
+void link_map_destroy(LinkMap *map);
+
+/* x and y in PDF points, origin at the bottom left. NULL if no link is there */
+const PageLink *link_map_hit_test(const LinkMap *map, double x, double y);
@@ -1,6 +1,14 @@
+#include <string.h>
+
 #include "app.h"
+#include "render_process.h"
 
 int main(int argc, char *argv[])
 {
+    // Started by a RenderProcessPool of the viewer
+    if (argc == 2 && strcmp(argv[1], RENDER_PROCESS_ARG) == 0) {
+        return render_process_main();
+    }
+
     return app_run(argc, argv);
 }
@@ -0,0 +1,196 @@
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "project_config.h"
+#include "utils.h"
+#include "renderer.h"
+#include "latency.h"
+#include "surface_pool.h"
+
+typedef struct {
+    int count;
+    gsize bytes;
+} SurfaceAccount;
+
+static void metrics_append_surface_account(GString *json, const char *name, SurfaceAccount *account);
+
+void metrics_append_window(GString *json, Window *win)
+{
+    Viewer *viewer = window_get_viewer(win);
+    RendererStats stats;
+    Page *page;
+    SurfaceAccount rendered = { 0 }, rendering = { 0 }, not_rendered = { 0 };
+    SurfaceAccount *account;
+    int materialized_pages = 0;
+    int busy_pages = 0;
+    int recorded_pages = 0;
+
+    renderer_get_stats(window_get_renderer(win), &stats);
+
+    for (int i = 0; i < viewer->info->n_pages; i++) {
+        page = viewer->info->pages[i];
+        if (page == NULL) {
+            continue;
+        }
+
+        if (page->poppler_page != NULL) {
+            materialized_pages++;
+        }
+
+        // The page mutex is held for the whole render, don't block the main loop on it
+        if (!g_mutex_trylock(&page->render_mutex)) {
+            busy_pages++;
+            continue;
+        }
+
+        switch (page->render_status) {
+        case PAGE_RENDERED:
+            account = &rendered;
+            break;
+        case PAGE_RENDERING:
+            account = &rendering;
+            break;
+        default:
+            account = &not_rendered;
+        }
+
+        if (page->surface != NULL) {
+            account->count++;
+            account->bytes += cairo_image_surface_get_stride(page->surface) * cairo_image_surface_get_height(page->surface);
+        }
+        if (page->recording != NULL) {
+            recorded_pages++;
+        }
+        g_mutex_unlock(&page->render_mutex);
+    }
+
+    g_string_append(json, "{\"uri\": ");
+    json_append_string(json, window_get_uri(win));
+    g_string_append(json, ", \"title\": ");
+    json_append_string(json, gtk_window_get_title(GTK_WINDOW(win)));
+    g_string_append_printf(json, ", \"pages\": %d, \"materialized_pages\": %d, \"recorded_pages\": %d", viewer->info->n_pages, materialized_pages, recorded_pages);
+    g_string_append_printf(json, ", \"visible_links\": %u", viewer->links->visible_links->len);
+
+    g_string_append(json, ", \"surfaces\": {");
+    metrics_append_surface_account(json, "rendered", &rendered);
+    g_string_append(json, ", ");
+    metrics_append_surface_account(json, "rendering", &rendering);
+    g_string_append(json, ", ");
+    metrics_append_surface_account(json, "not_rendered", &not_rendered);
+    g_string_append_printf(json, ", \"busy_pages\": %d}", busy_pages);
+
+    g_string_append_printf(json, ", \"render_queue\": {\"queued\": %d, \"in_flight\": %d}",
+        stats.jobs_queued, stats.jobs_in_flight);
+    g_string_append_printf(json, ", \"cache\": {\"hits\": %d, \"misses\": %d, \"resident_bytes\": %" G_GSSIZE_FORMAT ", \"suspended\": %s}",
+        stats.cache_hits, stats.cache_misses, stats.resident_bytes, window_get_renderer(win)->suspended ? "true" : "false");
+    g_string_append_printf(json, ", \"last_draw_us\": %d}", stats.last_draw_us);
+}
+
+void metrics_append_mark_manager(GString *json, const char *uri, ViewerMarkManager *manager)
+{
+    int marks = 0;
+
+    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+        for (unsigned int j = 0; j < NUM_MARKS; j++) {
+            if (manager->groups[i]->marks[j] != NULL) {
+                marks++;
+            }
+        }
+    }
+
+    g_string_append(json, "{\"uri\": ");
+    json_append_string(json, uri);
+    g_string_append_printf(json, ", \"groups\": %d, \"marks\": %d, \"bytes\": %zu}",
+        NUM_GROUPS, marks,
+        sizeof(ViewerMarkManager) + NUM_GROUPS * sizeof(ViewerMarkGroup) + marks * sizeof(ViewerCursor));
+}
+
+void metrics_append_latency(GString *json)
+{
+    bool first = true;
+
+    g_string_append_c(json, '{');
+    for (CommandKind kind = COMMAND_KIND_NONE + 1; kind < COMMAND_KIND_COUNT; kind++) {
+        if (!first) {
+            g_string_append(json, ", ");
+        }
+        first = false;
+
+        json_append_string(json, command_kind_to_str(kind));
+        g_string_append_printf(json,
+            ": {\"count\": %" G_GUINT64_FORMAT ", \"p50_us\": %" G_GINT64_FORMAT ", \"p95_us\": %" G_GINT64_FORMAT ", \"p99_us\": %" G_GINT64_FORMAT "}",
+            latency_get_count(kind),
+            latency_get_percentile(kind, 0.5),
+            latency_get_percentile(kind, 0.95),
+            latency_get_percentile(kind, 0.99));
+    }
+    g_string_append_c(json, '}');
+}
+
+void metrics_append_surface_pool(GString *json)
+{
+    SurfacePoolStats stats;
+
+    surface_pool_get_stats(&stats);
+    g_string_append_printf(json,
+        "{\"reuses\": %" G_GUINT64_FORMAT ", \"allocations\": %" G_GUINT64_FORMAT ", \"in_use_bytes\": %" G_GSIZE_FORMAT ", \"idle_bytes\": %" G_GSIZE_FORMAT ", \"idle_buffers\": %u}",
+        stats.reuses, stats.allocations, stats.in_use_bytes, stats.idle_bytes, stats.idle_buffers);
+}
+
+void metrics_append_file_size(GString *json, const char *path)
+{
+    GStatBuf buf;
+
+    g_string_append(json, "{\"path\": ");
+    json_append_string(json, path);
+    if (path != NULL && g_stat(path, &buf) == 0) {
+        g_string_append_printf(json, ", \"bytes\": %" G_GINT64_FORMAT "}", (gint64)buf.st_size);
+    } else {
+        g_string_append(json, ", \"bytes\": null}");
+    }
+}
+
+int metrics_get_thread_count(void)
+{
+    gchar *status = NULL;
+    gchar *threads = NULL;
+    int thread_count = -1;
+
+    // Linux only, other platforms report unknown
+    if (g_file_get_contents("/proc/self/status", &status, NULL, NULL)) {
+        threads = strstr(status, "\nThreads:");
+        if (threads != NULL) {
+            thread_count = (int)g_ascii_strtoll(threads + strlen("\nThreads:"), NULL, 10);
+        }
+        g_free(status);
+    }
+
+    return thread_count;
+}
+
+gchar *metrics_write(const char *json)
+{
+    GError *error = NULL;
+    gchar *filename = g_strdup_printf("metrics-%d-%" G_GINT64_FORMAT ".json", getpid(), g_get_real_time() / G_USEC_PER_SEC);
+    gchar *path = g_build_filename(g_get_user_cache_dir(), APP_NAME_STR, filename, NULL);
+
+    g_free(filename);
+    ensure_path_exists(path);
+
+    if (!g_file_set_contents(path, json, -1, &error)) {
+        g_printerr("metrics_write: %s\n", error->message);
+        g_error_free(error);
+        g_free(path);
+        return NULL;
+    }
+
+    return path;
+}
+
+static void metrics_append_surface_account(GString *json, const char *name, SurfaceAccount *account)
+{
+    json_append_string(json, name);
+    g_string_append_printf(json, ": {\"count\": %d, \"bytes\": %zu}", account->count, account->bytes);
+}
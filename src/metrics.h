@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+
+#include "window.h"
+#include "viewer_mark_manager.h"
+
+/*
+* Helpers to build the JSON resource snapshot written by app_dump_metrics.
+* Each append function writes a single JSON value.
+*/
+
+void metrics_append_window(GString *json, Window *win);
+void metrics_append_mark_manager(GString *json, const char *uri, ViewerMarkManager *manager);
+void metrics_append_latency(GString *json);
+void metrics_append_surface_pool(GString *json);
+void metrics_append_file_size(GString *json, const char *path);
+
+/* Number of threads in the process, or -1 if unknown */
+int metrics_get_thread_count(void);
+
+/* Writes json to a new file in the user cache directory and returns its path */
+gchar *metrics_write(const char *json);
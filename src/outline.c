@@ -0,0 +1,258 @@
+#include <stdlib.h>
+#include "outline.h"
+#include "utils.h"
+
+/* Jumping to a destination puts it at the cursor up to rounding, see viewer_cursor_get_dest_top */
+#define OUTLINE_TOP_TOLERANCE 0.5
+
+static void outline_add_entries(GArray *entries, PopplerDocument *doc, PopplerIndexIter *iter, int level, int parent);
+static void outline_load_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable);
+static void outline_clear(gpointer data);
+static void outline_index_positions(Outline *outline);
+static int outline_compare_positions(const void *a, const void *b);
+
+Outline *outline_new(PopplerDocument *doc)
+{
+    Outline *outline = g_atomic_rc_box_new0(Outline);
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(OutlineEntry));
+    PopplerIndexIter *iter = poppler_index_iter_new(doc);
+
+    if (iter) {
+        outline_add_entries(entries, doc, iter, 0, -1);
+        poppler_index_iter_free(iter);
+    }
+
+    outline->n_entries = entries->len;
+    outline->entries = (OutlineEntry *)g_array_free(entries, FALSE);
+    outline_index_positions(outline);
+
+    return outline;
+}
+
+Outline *outline_new_from_variant(GVariant *variant)
+{
+    Outline *outline;
+    OutlineEntry *entry;
+    PopplerDest dest = {0};
+    gint32 type;
+    gboolean change_left, change_top, change_zoom;
+    int n_entries;
+
+    if (!g_variant_is_of_type(variant, G_VARIANT_TYPE(OUTLINE_VARIANT_TYPE))) {
+        return NULL;
+    }
+
+    n_entries = g_variant_n_children(variant);
+    outline = g_atomic_rc_box_new0(Outline);
+    outline->entries = g_new0(OutlineEntry, n_entries);
+
+    for (int i = 0; i < n_entries; i++) {
+        entry = &outline->entries[i];
+        g_variant_get_child(variant, i, "(siii(iidddddbbb))", &entry->title, &entry->level, &entry->parent, &entry->subtree_end,
+            &type, &dest.page_num, &dest.left, &dest.bottom, &dest.right, &dest.top, &dest.zoom,
+            &change_left, &change_top, &change_zoom);
+        dest.type = type;
+        dest.change_left = change_left;
+        dest.change_top = change_top;
+        dest.change_zoom = change_zoom;
+        // Copied, so it is freed like the ones poppler allocates
+        entry->dest = poppler_dest_copy(&dest);
+        outline->n_entries = i + 1;
+
+        // outline_get_children relies on the tree being well formed
+        if (entry->level < 0 || entry->parent < -1 || entry->parent >= i ||
+            entry->subtree_end <= i || entry->subtree_end > n_entries || dest.type == POPPLER_DEST_NAMED) {
+            outline_unref(outline);
+            return NULL;
+        }
+    }
+    outline_index_positions(outline);
+
+    return outline;
+}
+
+GVariant *outline_to_variant(const Outline *outline)
+{
+    GVariantBuilder builder;
+    const OutlineEntry *entry;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE(OUTLINE_VARIANT_TYPE));
+    for (int i = 0; i < outline->n_entries; i++) {
+        entry = &outline->entries[i];
+        g_variant_builder_add(&builder, "(siii(iidddddbbb))", entry->title, entry->level, entry->parent, entry->subtree_end,
+            (gint32)entry->dest->type, entry->dest->page_num,
+            entry->dest->left, entry->dest->bottom, entry->dest->right, entry->dest->top, entry->dest->zoom,
+            (gboolean)entry->dest->change_left, (gboolean)entry->dest->change_top, (gboolean)entry->dest->change_zoom);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+void outline_load_async(const char *uri, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+
+    g_task_set_task_data(task, g_strdup(uri), g_free);
+    g_task_run_in_thread(task, outline_load_thread);
+    g_object_unref(task);
+}
+
+Outline *outline_load_finish(GAsyncResult *result, GError **error)
+{
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+Outline *outline_ref(Outline *outline)
+{
+    return g_atomic_rc_box_acquire(outline);
+}
+
+void outline_unref(Outline *outline)
+{
+    g_atomic_rc_box_release_full(outline, outline_clear);
+}
+
+GArray *outline_get_children(Outline *outline, int parent)
+{
+    GArray *children = g_array_new(FALSE, FALSE, sizeof(int));
+    int end = parent < 0 ? outline->n_entries : outline->entries[parent].subtree_end;
+
+    for (int i = parent + 1; i < end; i = outline->entries[i].subtree_end) {
+        g_array_append_val(children, i);
+    }
+
+    return children;
+}
+
+int outline_find_section(const Outline *outline, int page_idx, double top)
+{
+    int low = 0;
+    int high = outline->n_entries;
+    int mid;
+    const OutlinePosition *position;
+
+    // Find the first position after the given one
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        position = &outline->positions[mid];
+        if (position->page > page_idx || (position->page == page_idx && position->top < top - OUTLINE_TOP_TOLERANCE)) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return low > 0 ? outline->positions[low - 1].entry : -1;
+}
+
+static void outline_add_entries(GArray *entries, PopplerDocument *doc, PopplerIndexIter *iter, int level, int parent)
+{
+    PopplerAction *action;
+    PopplerDest *dest;
+    PopplerIndexIter *child;
+    OutlineEntry entry;
+    int index;
+
+    do {
+        action = poppler_index_iter_get_action(iter);
+        if (action == NULL || action->type != POPPLER_ACTION_GOTO_DEST) {
+            poppler_action_free(action);
+            continue;
+        }
+
+        if (action->goto_dest.dest->type == POPPLER_DEST_NAMED) {
+            dest = poppler_document_find_dest(doc, action->goto_dest.dest->named_dest);
+        } else {
+            dest = poppler_dest_copy(action->goto_dest.dest);
+        }
+
+        if (dest == NULL) {
+            poppler_action_free(action);
+            continue;
+        }
+
+        entry.title = g_strdup(action->any.title != NULL ? action->any.title : "");
+        entry.level = level;
+        entry.parent = parent;
+        entry.dest = dest;
+        index = entries->len;
+        g_array_append_val(entries, entry);
+        poppler_action_free(action);
+
+        child = poppler_index_iter_get_child(iter);
+        if (child) {
+            outline_add_entries(entries, doc, child, level + 1, index);
+            poppler_index_iter_free(child);
+        }
+        g_array_index(entries, OutlineEntry, index).subtree_end = entries->len;
+    } while (poppler_index_iter_next(iter));
+}
+
+static void outline_load_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+    const char *uri = task_data;
+    GError *error = NULL;
+    PopplerDocument *doc;
+    Outline *outline;
+
+    UNUSED(source_object);
+
+    if (g_cancellable_is_cancelled(cancellable)) {
+        g_task_return_error_if_cancelled(task);
+        return;
+    }
+
+    // The document of the window is used by render threads, so open another one
+    doc = poppler_document_new_from_file(uri, NULL, &error);
+    if (doc == NULL) {
+        g_task_return_error(task, error);
+        return;
+    }
+
+    outline = outline_new(doc);
+    g_object_unref(doc);
+
+    g_task_return_pointer(task, outline, (GDestroyNotify)outline_unref);
+}
+
+static void outline_index_positions(Outline *outline)
+{
+    outline->positions = g_new(OutlinePosition, outline->n_entries);
+    for (int i = 0; i < outline->n_entries; i++) {
+        outline->positions[i].page = outline->entries[i].dest->page_num - 1;
+        outline->positions[i].top = outline->entries[i].dest->change_top ? outline->entries[i].dest->top : G_MAXDOUBLE;
+        outline->positions[i].entry = i;
+    }
+    qsort(outline->positions, outline->n_entries, sizeof(OutlinePosition), outline_compare_positions);
+}
+
+static void outline_clear(gpointer data)
+{
+    Outline *outline = data;
+
+    for (int i = 0; i < outline->n_entries; i++) {
+        g_free(outline->entries[i].title);
+        poppler_dest_free(outline->entries[i].dest);
+    }
+    g_free(outline->entries);
+    g_free(outline->positions);
+}
+
+/*
+* By page, then from the top of the page down. Entries at the same position
+* stay in outline order, so the innermost one comes last
+*/
+static int outline_compare_positions(const void *a, const void *b)
+{
+    const OutlinePosition *position_a = a;
+    const OutlinePosition *position_b = b;
+
+    if (position_a->page != position_b->page) {
+        return position_a->page - position_b->page;
+    }
+    if (position_a->top != position_b->top) {
+        return position_a->top > position_b->top ? -1 : 1;
+    }
+
+    return position_a->entry - position_b->entry;
+}
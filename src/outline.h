@@ -0,0 +1,59 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <poppler.h>
+
+/*
+* Document outline flattened in depth-first order. Entries that don't go to
+* a destination in the document are skipped together with their children.
+* Immutable once loaded and reference counted, so it can be built on a
+* worker thread and shared with the list models of the TOC.
+*/
+
+typedef struct {
+    gchar *title;
+    int level;
+    // Index of the parent entry, -1 at the top level
+    int parent;
+    // Index after the last descendant
+    int subtree_end;
+    // Resolved, never a named destination
+    PopplerDest *dest;
+} OutlineEntry;
+
+typedef struct {
+    // 0-based
+    int page;
+    // In PDF points from the bottom of the page, G_MAXDOUBLE for the top of the page
+    double top;
+    int entry;
+} OutlinePosition;
+
+typedef struct Outline {
+    OutlineEntry *entries;
+    int n_entries;
+    // Destinations of all entries in document order
+    OutlinePosition *positions;
+} Outline;
+
+/* Title, level, parent, subtree_end and resolved destination of each entry */
+#define OUTLINE_VARIANT_TYPE "a(siii(iidddddbbb))"
+
+Outline *outline_new(PopplerDocument *doc);
+/* From outline_to_variant, e.g. cached in the database. NULL if variant isn't a valid outline */
+Outline *outline_new_from_variant(GVariant *variant);
+GVariant *outline_to_variant(const Outline *outline);
+/* Loads the outline from a separate instance of the document at uri on a worker thread */
+void outline_load_async(const char *uri, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+Outline *outline_load_finish(GAsyncResult *result, GError **error);
+Outline *outline_ref(Outline *outline);
+void outline_unref(Outline *outline);
+
+/* Indices of the children of parent, or of the top level entries if parent is -1 */
+GArray *outline_get_children(Outline *outline, int parent);
+/*
+* Index of the innermost entry whose destination is at or above top (in PDF
+* points from the bottom) of page_idx, or -1 if the position comes before
+* every entry.
+*/
+int outline_find_section(const Outline *outline, int page_idx, double top);
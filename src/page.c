@@ -1,5 +1,9 @@
 #include "page.h"
 
+static gssize total_recording_bytes = 0;
+
+static gssize page_get_recording_bytes(Page *page);
+
 Page *page_new(PopplerPage *poppler_page)
 {
     Page *page = malloc(sizeof(Page));
@@ -8,8 +12,32 @@ Page *page_new(PopplerPage *poppler_page)
     }
 
     page->poppler_page = poppler_page;
+    poppler_page_get_size(poppler_page, &page->width, &page->height);
     page->render_status = PAGE_NOT_RENDERED;
+    page->render_generation = 0;
     page->surface = NULL;
+    page->recording = NULL;
+    page->link_map = NULL;
+    g_mutex_init(&page->render_mutex);
+
+    return page;
+}
+
+Page *page_new_from_size(double width, double height)
+{
+    Page *page = malloc(sizeof(Page));
+    if (page == NULL) {
+        return NULL;
+    }
+
+    page->poppler_page = NULL;
+    page->width = width;
+    page->height = height;
+    page->render_status = PAGE_NOT_RENDERED;
+    page->render_generation = 0;
+    page->surface = NULL;
+    page->recording = NULL;
+    page->link_map = NULL;
     g_mutex_init(&page->render_mutex);
 
     return page;
@@ -29,5 +57,70 @@ void page_destroy(Page *page)
         page->surface = NULL;
     }
 
+    page_set_recording(page, NULL);
+
+    if (page->link_map) {
+        link_map_destroy(page->link_map);
+        free(page->link_map);
+        page->link_map = NULL;
+    }
+
     g_mutex_clear(&page->render_mutex);
-}
\ No newline at end of file
+}
+
+bool page_release_poppler_page(Page *page)
+{
+    bool released = false;
+
+    g_mutex_lock(&page->render_mutex);
+    if (page->poppler_page != NULL && page->render_status == PAGE_NOT_RENDERED) {
+        g_object_unref(page->poppler_page);
+        page->poppler_page = NULL;
+        page_set_recording(page, NULL);
+        released = true;
+    }
+    g_mutex_unlock(&page->render_mutex);
+
+    return released;
+}
+
+void page_set_recording(Page *page, cairo_surface_t *recording)
+{
+    g_atomic_pointer_add(&total_recording_bytes, -page_get_recording_bytes(page));
+    if (page->recording != NULL) {
+        cairo_surface_destroy(page->recording);
+    }
+
+    page->recording = recording;
+    g_atomic_pointer_add(&total_recording_bytes, page_get_recording_bytes(page));
+}
+
+bool page_release_recording(Page *page)
+{
+    bool released;
+
+    // A page being rendered may be replaying it, and isn't worth waiting for
+    if (!g_mutex_trylock(&page->render_mutex)) {
+        return false;
+    }
+    released = page->recording != NULL;
+    page_set_recording(page, NULL);
+    g_mutex_unlock(&page->render_mutex);
+
+    return released;
+}
+
+gssize page_get_total_recording_bytes(void)
+{
+    return (gssize)g_atomic_pointer_get(&total_recording_bytes);
+}
+
+/* cairo doesn't report the size of a recording, so it is charged like an image of the page at 1:1 */
+static gssize page_get_recording_bytes(Page *page)
+{
+    if (page->recording == NULL) {
+        return 0;
+    }
+
+    return (gssize)(page->width * page->height) * 4;
+}
@@ -4,6 +4,8 @@
 #include <cairo.h>
 #include <stdbool.h>
 
+#include "link_map.h"
+
 typedef enum {
     PAGE_RENDERED,
     PAGE_RENDERING,
@@ -11,11 +13,30 @@ typedef enum {
 } PageRenderStatus;
 
 typedef struct {
+    // NULL while released, see viewer_info_get_poppler_page
     PopplerPage *poppler_page;
+    // Size in points, kept when poppler_page is released
+    double width, height;
     PageRenderStatus render_status;
+    // Bumped whenever a render is queued, so a job can tell it was superseded while the mutex was released
+    guint render_generation;
     cairo_surface_t *surface;
+    // Recording of poppler_page in points if record_pages is set, replayed at any scale
+    cairo_surface_t *recording;
+    // NULL until needed, see viewer_info_get_link_map. Kept when poppler_page is released
+    LinkMap *link_map;
     GMutex render_mutex;
 } Page;
 
 Page *page_new(PopplerPage *poppler_page);
-void page_destroy(Page *page);
\ No newline at end of file
+/* Released until first used, for a page whose size is known without loading it */
+Page *page_new_from_size(double width, double height);
+void page_destroy(Page *page);
+/* Drops poppler_page and its recording unless the page is rendered or being rendered. Returns whether it did */
+bool page_release_poppler_page(Page *page);
+/* Replaces the recording and accounts for its size. Must be called with the page mutex held */
+void page_set_recording(Page *page, cairo_surface_t *recording);
+/* Drops the recording unless the page is being rendered, it is made again from poppler_page when needed. Returns whether it did */
+bool page_release_recording(Page *page);
+/* Estimated bytes held by the recordings of all pages */
+gssize page_get_total_recording_bytes(void);
\ No newline at end of file
@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <poppler.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "render_process.h"
+
+/* Descriptor of the socket in render processes */
+#define RENDER_PROCESS_FD 3
+/* Bounds the URI of a request */
+#define RENDER_PROCESS_MAX_MESSAGE (64 * 1024)
+/* Documents each render process keeps open, so windows on different documents don't reopen them for every page */
+#define RENDER_PROCESS_MAX_DOCUMENTS 4
+
+typedef struct {
+    gint32 page_idx;
+    gint32 width;
+    gint32 height;
+    gint32 stride;
+    double scale;
+    // Followed by the URI, without a terminating NUL
+} RenderProcessRequest;
+
+typedef struct {
+    gint32 status;
+} RenderProcessReply;
+
+typedef struct {
+    void *pixels;
+    gsize size;
+} SharedPixels;
+
+typedef struct {
+    gchar *uri;
+    // NULL if it could not be opened, so it isn't tried again for every page
+    PopplerDocument *doc;
+} CachedDocument;
+
+static const cairo_user_data_key_t shared_pixels_key;
+
+static bool render_process_start(RenderProcessPool *pool, RenderProcess *process);
+static void render_process_stop(RenderProcess *process);
+static bool render_process_request(RenderProcessPool *pool, RenderProcess *process, const char *uri, int page_idx, double scale, int width, int height, int stride, int memfd);
+static void shared_pixels_free(void *data);
+static bool render_process_render(PopplerDocument *doc, const RenderProcessRequest *request, int memfd);
+static PopplerDocument *render_process_get_document(GQueue *documents, gchar *uri);
+static void cached_document_free(CachedDocument *cached);
+
+RenderProcessPool *render_process_pool_new(int n_processes, int timeout_ms)
+{
+    RenderProcessPool *pool = malloc(sizeof(RenderProcessPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    render_process_pool_init(pool, n_processes, timeout_ms);
+
+    return pool;
+}
+
+void render_process_pool_init(RenderProcessPool *pool, int n_processes, int timeout_ms)
+{
+    pool->executable = g_file_read_link("/proc/self/exe", NULL);
+    pool->timeout_ms = timeout_ms;
+
+    g_mutex_init(&pool->mutex);
+    g_cond_init(&pool->process_idle);
+    pool->n_processes = n_processes;
+    pool->processes = g_new0(RenderProcess, n_processes);
+    g_queue_init(&pool->idle);
+
+    // Processes are started on their first render
+    for (int i = 0; i < n_processes; i++) {
+        pool->processes[i].subprocess = NULL;
+        pool->processes[i].fd = -1;
+        g_queue_push_tail(&pool->idle, GINT_TO_POINTER(i));
+    }
+
+    pool->renders = 0;
+    pool->failures = 0;
+}
+
+void render_process_pool_destroy(RenderProcessPool *pool)
+{
+    // Renderers wait for their jobs when destroyed, so no process is rendering
+    for (int i = 0; i < pool->n_processes; i++) {
+        render_process_stop(&pool->processes[i]);
+    }
+
+    g_free(pool->processes);
+    g_queue_clear(&pool->idle);
+    g_cond_clear(&pool->process_idle);
+    g_mutex_clear(&pool->mutex);
+    g_free(pool->executable);
+}
+
+cairo_surface_t *render_process_pool_render(RenderProcessPool *pool, const char *uri, int page_idx, double scale, int width, int height)
+{
+    const int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+    const gsize size = (gsize)stride * (gsize)height;
+    RenderProcess *process;
+    SharedPixels *shared = NULL;
+    cairo_surface_t *surface = NULL;
+    void *pixels = MAP_FAILED;
+    int memfd = -1;
+    int idx;
+    bool ok = false;
+
+    if (width <= 0 || height <= 0 || stride < 0) {
+        return NULL;
+    }
+
+    g_mutex_lock(&pool->mutex);
+    while (g_queue_is_empty(&pool->idle)) {
+        g_cond_wait(&pool->process_idle, &pool->mutex);
+    }
+    idx = GPOINTER_TO_INT(g_queue_pop_head(&pool->idle));
+    g_mutex_unlock(&pool->mutex);
+    process = &pool->processes[idx];
+
+    memfd = memfd_create("jumpdf-page", MFD_CLOEXEC);
+    if (memfd < 0 || ftruncate(memfd, size) != 0) {
+        g_printerr("render_process_pool_render: could not create shared memory: %s\n", g_strerror(errno));
+    } else if ((pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) == MAP_FAILED) {
+        g_printerr("render_process_pool_render: could not map shared memory: %s\n", g_strerror(errno));
+    } else if (process->subprocess != NULL || render_process_start(pool, process)) {
+        ok = render_process_request(pool, process, uri, page_idx, scale, width, height, stride, memfd);
+    }
+
+    if (memfd >= 0) {
+        close(memfd);
+    }
+
+    g_mutex_lock(&pool->mutex);
+    pool->renders++;
+    if (!ok) {
+        pool->failures++;
+    }
+    g_queue_push_tail(&pool->idle, GINT_TO_POINTER(idx));
+    g_cond_signal(&pool->process_idle);
+    g_mutex_unlock(&pool->mutex);
+
+    if (!ok) {
+        if (pixels != MAP_FAILED) {
+            munmap(pixels, size);
+        }
+        return NULL;
+    }
+
+    // The mapping is the backing store of the surface, and unmapped with it
+    shared = g_new(SharedPixels, 1);
+    shared->pixels = pixels;
+    shared->size = size;
+    surface = cairo_image_surface_create_for_data(pixels, CAIRO_FORMAT_ARGB32, width, height, stride);
+    if (cairo_surface_set_user_data(surface, &shared_pixels_key, shared, shared_pixels_free) != CAIRO_STATUS_SUCCESS) {
+        // The surface still points into the mapping
+        cairo_surface_destroy(surface);
+        shared_pixels_free(shared);
+        return NULL;
+    }
+
+    return surface;
+}
+
+int render_process_main(void)
+{
+    const int fd = RENDER_PROCESS_FD;
+    guchar *message = g_malloc(RENDER_PROCESS_MAX_MESSAGE);
+    char control[CMSG_SPACE(sizeof(int))];
+    // CachedDocument *, most recently used first
+    GQueue documents = G_QUEUE_INIT;
+    PopplerDocument *doc;
+
+    for (;;) {
+        RenderProcessRequest request;
+        RenderProcessReply reply = { .status = 1 };
+        struct iovec iov = { .iov_base = message, .iov_len = RENDER_PROCESS_MAX_MESSAGE };
+        struct msghdr msg = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
+        };
+        struct cmsghdr *cmsg;
+        ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        int memfd = -1;
+
+        // The viewer closed the socket or exited
+        if (n <= 0) {
+            break;
+        }
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        if (memfd >= 0 && (size_t)n > sizeof(request)) {
+            memcpy(&request, message, sizeof(request));
+            doc = render_process_get_document(&documents, g_strndup((const char *)message + sizeof(request), n - sizeof(request)));
+
+            if (doc != NULL && render_process_render(doc, &request, memfd)) {
+                reply.status = 0;
+            }
+        }
+
+        if (memfd >= 0) {
+            close(memfd);
+        }
+
+        if (send(fd, &reply, sizeof(reply), MSG_NOSIGNAL) < 0) {
+            break;
+        }
+    }
+
+    g_queue_clear_full(&documents, (GDestroyNotify)cached_document_free);
+    g_free(message);
+
+    return 0;
+}
+
+/* Takes uri. Opens the document unless it is cached, and evicts the least recently used one */
+static PopplerDocument *render_process_get_document(GQueue *documents, gchar *uri)
+{
+    CachedDocument *cached;
+    GError *error = NULL;
+
+    for (GList *l = documents->head; l != NULL; l = l->next) {
+        cached = l->data;
+        if (g_strcmp0(cached->uri, uri) == 0) {
+            g_queue_unlink(documents, l);
+            g_queue_push_head_link(documents, l);
+            g_free(uri);
+            return cached->doc;
+        }
+    }
+
+    cached = g_new(CachedDocument, 1);
+    cached->uri = uri;
+    cached->doc = poppler_document_new_from_file(uri, NULL, &error);
+    if (error != NULL) {
+        g_printerr("render_process_get_document: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_queue_push_head(documents, cached);
+    if (g_queue_get_length(documents) > RENDER_PROCESS_MAX_DOCUMENTS) {
+        cached_document_free(g_queue_pop_tail(documents));
+    }
+
+    return cached->doc;
+}
+
+static void cached_document_free(CachedDocument *cached)
+{
+    g_clear_object(&cached->doc);
+    g_free(cached->uri);
+    g_free(cached);
+}
+
+static bool render_process_start(RenderProcessPool *pool, RenderProcess *process)
+{
+    GSubprocessLauncher *launcher;
+    GError *error = NULL;
+    int fds[2];
+
+    if (pool->executable == NULL) {
+        return false;
+    }
+
+    // Keeps message boundaries, so a request is read as a whole
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+        g_printerr("render_process_start: could not create socket: %s\n", g_strerror(errno));
+        return false;
+    }
+
+    launcher = g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_NONE);
+    g_subprocess_launcher_take_fd(launcher, fds[1], RENDER_PROCESS_FD);
+    process->subprocess = g_subprocess_launcher_spawn(launcher, &error, pool->executable, RENDER_PROCESS_ARG, NULL);
+    // Closes the end of the socket that was given to the process
+    g_object_unref(launcher);
+
+    if (process->subprocess == NULL) {
+        g_printerr("render_process_start: %s\n", error->message);
+        g_error_free(error);
+        close(fds[0]);
+        return false;
+    }
+
+    process->fd = fds[0];
+
+    return true;
+}
+
+static void render_process_stop(RenderProcess *process)
+{
+    if (process->subprocess == NULL) {
+        return;
+    }
+
+    close(process->fd);
+    process->fd = -1;
+    g_subprocess_force_exit(process->subprocess);
+    g_subprocess_wait(process->subprocess, NULL, NULL);
+    g_clear_object(&process->subprocess);
+}
+
+static bool render_process_request(RenderProcessPool *pool, RenderProcess *process, const char *uri, int page_idx, double scale, int width, int height, int stride, int memfd)
+{
+    RenderProcessRequest request = {
+        .page_idx = page_idx,
+        .width = width,
+        .height = height,
+        .stride = stride,
+        .scale = scale,
+    };
+    RenderProcessReply reply;
+    const size_t uri_len = strlen(uri);
+    char control[CMSG_SPACE(sizeof(int))] = { 0 };
+    struct iovec iov[2] = {
+        { .iov_base = &request, .iov_len = sizeof(request) },
+        { .iov_base = (void *)uri, .iov_len = uri_len },
+    };
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = 2,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    struct pollfd pfd = { .fd = process->fd, .events = POLLIN };
+    int ready;
+
+    if (sizeof(request) + uri_len > RENDER_PROCESS_MAX_MESSAGE) {
+        g_printerr("render_process_request: URI too long: %s\n", uri);
+        return false;
+    }
+
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    if (sendmsg(process->fd, &msg, MSG_NOSIGNAL) < 0) {
+        g_warning("render_process_request: render process is gone, restarting it");
+        render_process_stop(process);
+        return false;
+    }
+
+    do {
+        ready = poll(&pfd, 1, pool->timeout_ms > 0 ? pool->timeout_ms : -1);
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready == 0) {
+        g_warning("render_process_request: page %d of %s took longer than %d ms, restarting the render process", page_idx + 1, uri, pool->timeout_ms);
+        render_process_stop(process);
+        return false;
+    }
+
+    if (ready < 0 || recv(process->fd, &reply, sizeof(reply), 0) != sizeof(reply)) {
+        g_warning("render_process_request: page %d of %s crashed the render process, restarting it", page_idx + 1, uri);
+        render_process_stop(process);
+        return false;
+    }
+
+    return reply.status == 0;
+}
+
+static void shared_pixels_free(void *data)
+{
+    SharedPixels *shared = (SharedPixels *)data;
+
+    munmap(shared->pixels, shared->size);
+    g_free(shared);
+}
+
+static bool render_process_render(PopplerDocument *doc, const RenderProcessRequest *request, int memfd)
+{
+    const gsize size = (gsize)request->stride * (gsize)request->height;
+    PopplerPage *page = poppler_document_get_page(doc, request->page_idx);
+    cairo_surface_t *surface;
+    void *pixels;
+    cairo_t *cr;
+    double width, height;
+
+    if (page == NULL) {
+        return false;
+    }
+
+    pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (pixels == MAP_FAILED) {
+        g_object_unref(page);
+        return false;
+    }
+
+    surface = cairo_image_surface_create_for_data(pixels, CAIRO_FORMAT_ARGB32, request->width, request->height, request->stride);
+    cr = cairo_create(surface);
+    cairo_scale(cr, request->scale, request->scale);
+
+    // Clear to white background (for PDFs with missing background)
+    poppler_page_get_size(page, &width, &height);
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_fill(cr);
+
+    poppler_page_render(page, cr);
+
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    cairo_surface_destroy(surface);
+    munmap(pixels, size);
+    g_object_unref(page);
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <cairo.h>
+
+/*
+* Pool of helper processes that render pages with their own copy of the
+* document. Pixels are written to a memfd that becomes the backing store of
+* the returned surface, so they are never copied. A process that crashes or
+* misses the deadline is killed and started again for the next page.
+*/
+
+/* Argument that makes the executable run as a render process */
+#define RENDER_PROCESS_ARG "--render-process"
+
+typedef struct {
+    // NULL until started, and after it was killed
+    GSubprocess *subprocess;
+    // Socket to the process
+    int fd;
+} RenderProcess;
+
+typedef struct RenderProcessPool {
+    gchar *executable;
+    int timeout_ms;
+
+    GMutex mutex;
+    GCond process_idle;
+    RenderProcess *processes;
+    int n_processes;
+    // Indices of processes that aren't rendering
+    GQueue idle;
+
+    guint renders;
+    guint failures;
+} RenderProcessPool;
+
+RenderProcessPool *render_process_pool_new(int n_processes, int timeout_ms);
+void render_process_pool_init(RenderProcessPool *pool, int n_processes, int timeout_ms);
+void render_process_pool_destroy(RenderProcessPool *pool);
+
+/*
+* Renders the page of the document at uri onto a white background, blocking
+* until a process is free. Returns NULL if the page could not be rendered.
+*/
+cairo_surface_t *render_process_pool_render(RenderProcessPool *pool, const char *uri, int page_idx, double scale, int width, int height);
+
+/* Entry point of a render process, serves requests until the viewer closes the socket */
+int render_process_main(void);
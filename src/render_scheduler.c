@@ -0,0 +1,180 @@
+#include <stdlib.h>
+
+#include "render_scheduler.h"
+#include "utils.h"
+
+static void render_scheduler_run_next(gpointer token, gpointer user_data);
+static gint render_job_compare(gconstpointer a, gconstpointer b, gpointer user_data);
+
+RenderScheduler *render_scheduler_new(int n_workers)
+{
+    RenderScheduler *scheduler = malloc(sizeof(RenderScheduler));
+    if (scheduler == NULL) {
+        return NULL;
+    }
+
+    render_scheduler_init(scheduler, n_workers);
+
+    return scheduler;
+}
+
+void render_scheduler_init(RenderScheduler *scheduler, int n_workers)
+{
+    GError *error = NULL;
+
+    scheduler->n_workers = n_workers > 0 ? n_workers : (int)g_get_num_processors();
+
+    g_mutex_init(&scheduler->mutex);
+    g_cond_init(&scheduler->job_done);
+    scheduler->jobs = g_sequence_new(NULL);
+    scheduler->running_owners = g_ptr_array_new();
+    scheduler->next_sequence = 0;
+    scheduler->current_round = 0;
+
+    /*
+    * The pool only receives tokens. Each token runs whichever queued job is
+    * first at that time, so priorities apply to all jobs that are waiting.
+    */
+    scheduler->workers = g_thread_pool_new(render_scheduler_run_next, scheduler, scheduler->n_workers, TRUE, &error);
+    if (error != NULL) {
+        g_warning("Failed to create render thread pool, rendering synchronously: %s", error->message);
+        g_error_free(error);
+        scheduler->workers = NULL;
+    }
+}
+
+void render_scheduler_destroy(RenderScheduler *scheduler)
+{
+    // Renderers cancel their jobs when destroyed, so only empty tokens are left
+    if (scheduler->workers != NULL) {
+        g_thread_pool_free(scheduler->workers, FALSE, TRUE);
+    }
+
+    g_sequence_foreach(scheduler->jobs, (GFunc)g_free, NULL);
+    g_sequence_free(scheduler->jobs);
+    g_ptr_array_free(scheduler->running_owners, TRUE);
+    g_cond_clear(&scheduler->job_done);
+    g_mutex_clear(&scheduler->mutex);
+}
+
+void render_scheduler_push(RenderScheduler *scheduler, gpointer owner, RenderPriority priority, guint order, GFunc func, gpointer data)
+{
+    RenderJob *job = g_new(RenderJob, 1);
+    GError *error = NULL;
+
+    job->owner = owner;
+    job->priority = priority;
+    job->func = func;
+    job->data = data;
+
+    g_mutex_lock(&scheduler->mutex);
+    job->round = scheduler->current_round + order;
+    job->sequence = scheduler->next_sequence++;
+    g_sequence_insert_sorted(scheduler->jobs, job, render_job_compare, NULL);
+    g_mutex_unlock(&scheduler->mutex);
+
+    // Without workers, render on this thread rather than leave the job queued forever
+    if (scheduler->workers == NULL) {
+        render_scheduler_run_next(scheduler, scheduler);
+        return;
+    }
+
+    // Any non-NULL token will do
+    g_thread_pool_push(scheduler->workers, scheduler, &error);
+    if (error != NULL) {
+        g_warning("Failed to push render task to thread pool: %s", error->message);
+        g_error_free(error);
+        render_scheduler_run_next(scheduler, scheduler);
+    }
+}
+
+guint render_scheduler_cancel(RenderScheduler *scheduler, gpointer owner, RenderJobMatchFunc match, gpointer user_data, GDestroyNotify free_data)
+{
+    GSequenceIter *iter, *next;
+    RenderJob *job;
+    guint n_cancelled = 0;
+
+    g_mutex_lock(&scheduler->mutex);
+    iter = g_sequence_get_begin_iter(scheduler->jobs);
+    while (!g_sequence_iter_is_end(iter)) {
+        next = g_sequence_iter_next(iter);
+        job = g_sequence_get(iter);
+
+        if (job->owner == owner && (match == NULL || match(job->data, user_data))) {
+            if (free_data != NULL) {
+                free_data(job->data);
+            }
+            g_sequence_remove(iter);
+            g_free(job);
+            n_cancelled++;
+        }
+
+        iter = next;
+    }
+    g_mutex_unlock(&scheduler->mutex);
+
+    return n_cancelled;
+}
+
+void render_scheduler_wait(RenderScheduler *scheduler, gpointer owner)
+{
+    guint index;
+
+    g_mutex_lock(&scheduler->mutex);
+    while (g_ptr_array_find(scheduler->running_owners, owner, &index)) {
+        g_cond_wait(&scheduler->job_done, &scheduler->mutex);
+    }
+    g_mutex_unlock(&scheduler->mutex);
+}
+
+static void render_scheduler_run_next(gpointer token, gpointer user_data)
+{
+    UNUSED(token);
+
+    RenderScheduler *scheduler = (RenderScheduler *)user_data;
+    GSequenceIter *first;
+    RenderJob *job = NULL;
+
+    g_mutex_lock(&scheduler->mutex);
+    first = g_sequence_get_begin_iter(scheduler->jobs);
+    if (!g_sequence_iter_is_end(first)) {
+        job = g_sequence_get(first);
+        g_sequence_remove(first);
+
+        scheduler->current_round = MAX(scheduler->current_round, job->round);
+        g_ptr_array_add(scheduler->running_owners, job->owner);
+    }
+    g_mutex_unlock(&scheduler->mutex);
+
+    // The job was cancelled
+    if (job == NULL) {
+        return;
+    }
+
+    job->func(job->data, job->owner);
+
+    g_mutex_lock(&scheduler->mutex);
+    g_ptr_array_remove_fast(scheduler->running_owners, job->owner);
+    g_cond_broadcast(&scheduler->job_done);
+    g_mutex_unlock(&scheduler->mutex);
+
+    g_free(job);
+}
+
+static gint render_job_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    UNUSED(user_data);
+
+    const RenderJob *job_a = a;
+    const RenderJob *job_b = b;
+
+    if (job_a->priority != job_b->priority) {
+        return job_a->priority < job_b->priority ? -1 : 1;
+    } else if (job_a->round != job_b->round) {
+        return job_a->round < job_b->round ? -1 : 1;
+    } else if (job_a->sequence != job_b->sequence) {
+        return job_a->sequence < job_b->sequence ? -1 : 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+* Process-wide pool of render workers shared by all renderers. Jobs run in
+* order of priority, then round-robin across owners, then submission order.
+*/
+
+typedef enum {
+    RENDER_PRIORITY_FOCUSED = 0, // Visible pages of the focused window
+    RENDER_PRIORITY_BACKGROUND,  // Visible pages of other windows
+    RENDER_PRIORITY_PREFETCH,    // Pages next to the visible ones
+} RenderPriority;
+
+typedef struct {
+    gpointer owner;
+    RenderPriority priority;
+    guint64 round;
+    guint64 sequence;
+    GFunc func;
+    gpointer data;
+} RenderJob;
+
+typedef struct RenderScheduler {
+    GThreadPool *workers;
+    int n_workers;
+
+    GMutex mutex;
+    GCond job_done;
+    GSequence *jobs;
+    // Owners of running jobs, one entry per job
+    GPtrArray *running_owners;
+    guint64 next_sequence;
+    // Round of the last job started, new jobs are queued relative to it
+    guint64 current_round;
+} RenderScheduler;
+
+/* Returns TRUE for jobs to cancel */
+typedef gboolean (*RenderJobMatchFunc)(gpointer data, gpointer user_data);
+
+/* n_workers <= 0 uses one worker per processor */
+RenderScheduler *render_scheduler_new(int n_workers);
+void render_scheduler_init(RenderScheduler *scheduler, int n_workers);
+void render_scheduler_destroy(RenderScheduler *scheduler);
+
+/*
+* Queues func(data, owner). order is the position of the job in the batch
+* the owner is submitting, so that batches of different owners interleave.
+* Runs a job on the calling thread if the worker threads couldn't be created.
+*/
+void render_scheduler_push(RenderScheduler *scheduler, gpointer owner, RenderPriority priority, guint order, GFunc func, gpointer data);
+/*
+* Removes the queued jobs of owner for which match returns TRUE (all of them
+* if match is NULL) and passes their data to free_data. Returns how many.
+*/
+guint render_scheduler_cancel(RenderScheduler *scheduler, gpointer owner, RenderJobMatchFunc match, gpointer user_data, GDestroyNotify free_data);
+/* Blocks until no job of owner is running */
+void render_scheduler_wait(RenderScheduler *scheduler, gpointer owner);
@@ -1,72 +1,140 @@
 #include "renderer.h"
 #include "config.h"
 #include "utils.h"
+#include "trace.h"
+#include "surface_pool.h"
+#include "hint_atlas.h"
 
 #define SCALE_EPSILON 1e-6
-
-typedef struct {
-    int reset_from;
-    int reset_to;
-    int render_from;
-    int render_to;
-} RenderRequest;
+// Weight of the latest page draw in the cache hit rate, roughly averages the last 50
+#define CACHE_HIT_RATE_WEIGHT 0.02
 
 typedef struct {
     Viewer *viewer;
     Page *page;
+    int page_idx;
     unsigned int draw_links_from;
     unsigned int draw_links_to;
+    guint generation;
+    gint64 queued_at;
 } RenderPageData;
 
-static void renderer_draw_page(cairo_t *cr, Viewer *viewer, int page_idx, double *base);
-static RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewer);
-static void renderer_reset_pages(Viewer *viewer, int from, int to);
-static void renderer_queue_page_render(Renderer *renderer, Viewer *viewer, Page* page, unsigned int* const draw_links_from, unsigned int* const draw_links_to);
+static gssize total_resident_bytes = 0;
+static gint prefetch_throttled = FALSE;
+
+static void renderer_draw_page(Renderer *renderer, cairo_t *cr, Viewer *viewer, int page_idx, double *base);
+static void renderer_reset_pages(Renderer *renderer, Viewer *viewer, int from, int to);
+static void renderer_set_page_surface(Renderer *renderer, Page *page, cairo_surface_t *surface);
+static void renderer_queue_page_render(Renderer *renderer, Viewer *viewer, int page_idx, RenderPriority priority, guint order, unsigned int* const draw_links_from, unsigned int* const draw_links_to);
+static bool renderer_is_focused(Renderer *renderer);
+static gboolean render_page_data_in_range(gpointer data, gpointer user_data);
 static void render_page_async(gpointer data, gpointer user_data);
-static void renderer_render_page(Renderer *renderer, Viewer *viewer, cairo_t *cr, PopplerPage *page, unsigned int draw_links_from, unsigned int draw_links_to);
+static gboolean queue_draw_view(gpointer view);
+static cairo_surface_t *renderer_finish_process_surface(Viewer *viewer, Page *page, cairo_surface_t *page_surface, double scale, unsigned int draw_links_from, unsigned int draw_links_to);
+static void renderer_render_page(Renderer *renderer, Viewer *viewer, cairo_t *cr, Page *page, unsigned int draw_links_from, unsigned int draw_links_to);
+static void renderer_render_poppler_page(Renderer *renderer, cairo_t *cr, Page *page, int page_idx);
+static void renderer_render_overlays(Viewer *viewer, cairo_t *cr, Page *page, int page_idx, unsigned int draw_links_from, unsigned int draw_links_to);
 static cairo_surface_t* create_loading_surface(int width, int height);
+static cairo_surface_t* create_message_surface(int width, int height, const char *message);
 static void viewer_translate(Viewer *viewer, cairo_t *cr);
+static void viewer_get_translation(Viewer *viewer, double *x_translate, double *y_translate);
 static void viewer_highlight_search(Viewer *viewer, cairo_t *cr, PopplerPage *page);
 static void viewer_draw_links(Viewer *viewer, cairo_t *cr, unsigned int from, unsigned int to);
 
-Renderer *renderer_new(GtkWidget *view)
+Renderer *renderer_new(GtkWidget *view, RenderScheduler *scheduler)
 {
     Renderer *renderer = g_new0(Renderer, 1);
-    renderer_init(renderer, view);
+    renderer_init(renderer, view, scheduler);
 
     return renderer;
 }
 
-void renderer_init(Renderer *renderer, GtkWidget *view)
+void renderer_init(Renderer *renderer, GtkWidget *view, RenderScheduler *scheduler)
 {
-    renderer->view = view;
-
-    GError *error = NULL;
-    renderer->render_tp = g_thread_pool_new((GFunc)render_page_async, renderer, g_get_num_processors(), TRUE, &error);
-    if (error != NULL) {
-        g_warning("Failed to create render thread pool: %s", error->message);
-        g_error_free(error);
-    } else {
-        g_mutex_init(&renderer->render_mutex);
-    }
+    // Workers queue redraws of the view, so keep it alive until they are done
+    renderer->view = view != NULL ? g_object_ref(view) : NULL;
+    renderer->scheduler = scheduler;
+    renderer->processes = NULL;
+    g_mutex_init(&renderer->render_mutex);
 
     renderer->last_visible_pages_before = -1;
     renderer->last_visible_pages_after = -1;
     renderer->last_scale = NAN;
     renderer->last_follow_links_mode = FALSE;
     renderer->last_search_text = NULL;
+    renderer->suspended = false;
+
+    renderer->stats = (RendererStats){ 0 };
+    renderer->stats.cache_hit_rate = 1.0;
 }
 
 void renderer_destroy(Renderer *renderer)
 {
-    g_thread_pool_free(renderer->render_tp, FALSE, TRUE);
+    guint n_cancelled;
+
+    // Jobs refer to the renderer, so none may be left in the shared scheduler
+    if (renderer->scheduler != NULL) {
+        n_cancelled = render_scheduler_cancel(renderer->scheduler, renderer, NULL, NULL, g_free);
+        g_atomic_int_add(&renderer->stats.jobs_queued, -(gint)n_cancelled);
+        render_scheduler_wait(renderer->scheduler, renderer);
+    }
+
+    g_clear_object(&renderer->view);
     g_mutex_clear(&renderer->render_mutex);
 
     g_free(renderer->last_search_text);
 }
 
-void renderer_draw(cairo_t *cr, Viewer *viewer)
+bool renderer_view_to_page(Viewer *viewer, double view_x, double view_y, int *page_idx, double *page_x, double *page_y)
 {
+    const double scale = viewer->cursor->scale;
+    double x_translate, y_translate;
+    double base = 0;
+    int from, to;
+
+    viewer_get_translation(viewer, &x_translate, &y_translate);
+    view_x -= x_translate;
+    view_y -= y_translate;
+
+    // Pages are stacked the same way as in renderer_draw_page
+    viewer_cursor_get_visible_pages(viewer->cursor, &from, &to);
+    for (int i = from; i <= to; i++) {
+        Page *page = viewer->info->pages[i];
+        const double page_width = page->width * scale;
+        const double page_height = page->height * scale;
+        const double center_offset = round((viewer->info->max_page_width * scale - page_width) / 2.0);
+
+        if (page->render_status == PAGE_NOT_RENDERED) {
+            continue;
+        }
+
+        if (view_y >= base && view_y < base + page_height) {
+            if (view_x < center_offset || view_x >= center_offset + page_width) {
+                return false;
+            }
+
+            *page_idx = i;
+            *page_x = (view_x - center_offset) / scale;
+            *page_y = (view_y - base) / scale;
+            return true;
+        }
+
+        base += page_height;
+    }
+
+    return false;
+}
+
+void renderer_set_process_pool(Renderer *renderer, RenderProcessPool *pool)
+{
+    renderer->processes = pool;
+}
+
+void renderer_draw(Renderer *renderer, cairo_t *cr, Viewer *viewer)
+{
+    gint64 draw_start = g_get_monotonic_time();
+    gint64 trace_start = trace_begin();
+
     if (viewer->cursor->dark_mode) {
         cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
         cairo_paint(cr);
@@ -78,7 +146,7 @@ void renderer_draw(cairo_t *cr, Viewer *viewer)
     int from, to;
     viewer_cursor_get_visible_pages(viewer->cursor, &from, &to);
     for (int i = from; i <= to; i++) {
-        renderer_draw_page(cr, viewer, i, &base);
+        renderer_draw_page(renderer, cr, viewer, i, &base);
     }
 
     if (viewer->cursor->dark_mode) {
@@ -86,20 +154,43 @@ void renderer_draw(cairo_t *cr, Viewer *viewer)
         cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
         cairo_paint(cr);
     }
+
+    trace_end("draw", "renderer_draw", trace_start, -1);
+    g_atomic_int_set(&renderer->stats.last_draw_us, (gint)(g_get_monotonic_time() - draw_start));
 }
 
 void renderer_render_visible_pages(Renderer *renderer, Viewer *viewer)
 {
+    if (renderer->suspended) {
+        if (!renderer_is_focused(renderer)) {
+            return;
+        }
+        renderer->suspended = false;
+    }
+
     RenderRequest request = renderer_generate_request(renderer, viewer);
 
-    renderer_reset_pages(viewer, request.reset_from, request.reset_to);
+    renderer_reset_pages(renderer, viewer, request.reset_from, request.reset_to);
     renderer_render_pages(renderer, viewer, request.render_from, request.render_to);
 }
 
+void renderer_resume(Renderer *renderer, Viewer *viewer)
+{
+    if (!renderer->suspended) {
+        return;
+    }
+
+    renderer->suspended = false;
+    renderer_render_visible_pages(renderer, viewer);
+}
+
 void renderer_render_pages(Renderer *renderer, Viewer *viewer, int from, int to)
 {
     unsigned int draw_links_from = 0;
     unsigned int draw_links_to = 0;
+    int visible_from, visible_to;
+    const RenderPriority visible_priority = renderer_is_focused(renderer) ? RENDER_PRIORITY_FOCUSED : RENDER_PRIORITY_BACKGROUND;
+    guint order = 0;
 
     if (from < 0 || to < 0) {
         return;
@@ -109,26 +200,117 @@ void renderer_render_pages(Renderer *renderer, Viewer *viewer, int from, int to)
         viewer_links_clear_links(viewer->links);
     }
 
+    viewer_cursor_get_visible_pages(viewer->cursor, &visible_from, &visible_to);
     for (int i = from; i <= to; i++) {
-        renderer_queue_page_render(renderer, viewer, viewer->info->pages[i], &draw_links_from, &draw_links_to);
+        renderer_queue_page_render(renderer, viewer, i,
+            i >= visible_from && i <= visible_to ? visible_priority : RENDER_PRIORITY_PREFETCH,
+            order++, &draw_links_from, &draw_links_to);
     }
 }
 
-static void renderer_draw_page(cairo_t *cr, Viewer *viewer, int page_idx, double *base)
+bool renderer_visible_pages_rendered(Viewer *viewer)
+{
+    int from, to;
+    Page *page;
+    bool rendered = true;
+
+    viewer_cursor_get_visible_pages(viewer->cursor, &from, &to);
+    for (int i = from; i <= to && rendered; i++) {
+        page = viewer->info->pages[i];
+
+        // The page mutex is held for the whole render, so don't wait for it
+        if (g_mutex_trylock(&page->render_mutex)) {
+            rendered = page->render_status == PAGE_RENDERED;
+            g_mutex_unlock(&page->render_mutex);
+        } else {
+            rendered = false;
+        }
+    }
+
+    return rendered;
+}
+
+bool renderer_is_idle(Renderer *renderer, Viewer *viewer)
+{
+    return g_atomic_int_get(&renderer->stats.jobs_queued) == 0 &&
+        g_atomic_int_get(&renderer->stats.jobs_in_flight) == 0 &&
+        renderer_visible_pages_rendered(viewer);
+}
+
+void renderer_get_stats(Renderer *renderer, RendererStats *stats)
+{
+    stats->jobs_queued = g_atomic_int_get(&renderer->stats.jobs_queued);
+    stats->jobs_in_flight = g_atomic_int_get(&renderer->stats.jobs_in_flight);
+    stats->cache_hits = g_atomic_int_get(&renderer->stats.cache_hits);
+    stats->cache_misses = g_atomic_int_get(&renderer->stats.cache_misses);
+    stats->cache_hit_rate = renderer->stats.cache_hit_rate;
+    stats->resident_bytes = (gssize)g_atomic_pointer_get(&renderer->stats.resident_bytes);
+    stats->last_draw_us = g_atomic_int_get(&renderer->stats.last_draw_us);
+}
+
+gssize renderer_get_total_resident_bytes(void)
+{
+    return (gssize)g_atomic_pointer_get(&total_resident_bytes);
+}
+
+void renderer_set_prefetch_throttled(bool throttled)
+{
+    g_atomic_int_set(&prefetch_throttled, throttled);
+}
+
+void renderer_evict_prefetched(Renderer *renderer, Viewer *viewer)
+{
+    int from, to;
+
+    viewer_cursor_get_visible_pages(viewer->cursor, &from, &to);
+
+    // Nothing rendered, or the view moved without a new request
+    if (renderer->last_visible_pages_before < 0 || from < renderer->last_visible_pages_before || to > renderer->last_visible_pages_after) {
+        return;
+    }
+
+    renderer_reset_pages(renderer, viewer, renderer->last_visible_pages_before, from - 1);
+    renderer_reset_pages(renderer, viewer, to + 1, renderer->last_visible_pages_after);
+
+    // Scrolling assumes pages in the last range are rendered
+    renderer->last_visible_pages_before = from;
+    renderer->last_visible_pages_after = to;
+}
+
+void renderer_suspend(Renderer *renderer, Viewer *viewer)
+{
+    if (renderer->suspended || renderer->last_visible_pages_before < 0) {
+        return;
+    }
+
+    renderer_reset_pages(renderer, viewer, renderer->last_visible_pages_before, renderer->last_visible_pages_after);
+    renderer->last_visible_pages_before = -1;
+    renderer->last_visible_pages_after = -1;
+    renderer->suspended = true;
+}
+
+static void renderer_draw_page(Renderer *renderer, cairo_t *cr, Viewer *viewer, int page_idx, double *base)
 {
     Page *page = viewer->info->pages[page_idx];
+    // A hit is a page drawn from its final surface instead of a placeholder
+    const bool hit = page->render_status == PAGE_RENDERED;
+
+    if (hit) {
+        g_atomic_int_inc(&renderer->stats.cache_hits);
+    } else {
+        g_atomic_int_inc(&renderer->stats.cache_misses);
+    }
+    renderer->stats.cache_hit_rate += CACHE_HIT_RATE_WEIGHT * ((hit ? 1.0 : 0.0) - renderer->stats.cache_hit_rate);
 
     if (page->render_status == PAGE_NOT_RENDERED) {
         return;
     }
 
-    double page_width, page_height;
-    poppler_page_get_size(page->poppler_page, &page_width, &page_height);
-    page_width *= viewer->cursor->scale;
-    page_height *= viewer->cursor->scale;
+    const double page_width = page->width * viewer->cursor->scale;
+    const double page_height = page->height * viewer->cursor->scale;
     double center_offset = round((viewer->info->max_page_width * viewer->cursor->scale - page_width) / 2.0);
 
-    g_mutex_lock(&page->render_mutex);
+    trace_mutex_lock(&page->render_mutex, "page->render_mutex", page_idx);
     g_assert(page->surface != NULL);
     cairo_set_source_surface(cr, page->surface, center_offset, *base);
     g_mutex_unlock(&page->render_mutex);
@@ -149,7 +331,7 @@ static void renderer_draw_page(cairo_t *cr, Viewer *viewer, int page_idx, double
     *base += page_height;
 }
 
-static RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewer)
+RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewer)
 {
     RenderRequest request = {
         .reset_from = -1,
@@ -161,6 +343,12 @@ static RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewe
     int visible_pages_before, visible_pages_after;
     viewer_cursor_get_visible_pages(viewer->cursor, &visible_pages_before, &visible_pages_after);
 
+    // Links are numbered across the rendered pages, so only prefetch when they aren't shown
+    if (!viewer->links->follow_links_mode && !g_atomic_int_get(&prefetch_throttled)) {
+        visible_pages_before = MAX(0, visible_pages_before - g_config->prefetch_pages);
+        visible_pages_after = MIN(viewer->info->n_pages - 1, visible_pages_after + g_config->prefetch_pages);
+    }
+
     const bool visible_pages_invariant = visible_pages_before == renderer->last_visible_pages_before && visible_pages_after == renderer->last_visible_pages_after;
     const bool scale_invariant = fabs(viewer->cursor->scale - renderer->last_scale) < SCALE_EPSILON;
     const bool follow_links_mode_invariant = viewer->links->follow_links_mode == renderer->last_follow_links_mode;
@@ -213,35 +401,45 @@ static RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewe
     return request;
 }
 
-static void renderer_reset_pages(Viewer *viewer, int from, int to)
+static void renderer_reset_pages(Renderer *renderer, Viewer *viewer, int from, int to)
 {
+    int range[2] = { from, to };
+    guint n_cancelled;
+
     if (from < 0 || to < 0) {
         return;
     }
 
+    // Don't render pages that have scrolled out of view before their turn
+    if (renderer->scheduler != NULL) {
+        n_cancelled = render_scheduler_cancel(renderer->scheduler, renderer, render_page_data_in_range, range, g_free);
+        g_atomic_int_add(&renderer->stats.jobs_queued, -(gint)n_cancelled);
+    }
+
     for (int i = from; i <= to; i++) {
         Page *page = viewer->info->pages[i];
 
         g_mutex_lock(&page->render_mutex);
-        if (page->surface != NULL) {
-            cairo_surface_destroy(page->surface);
-            page->surface = NULL;
-        }
+        renderer_set_page_surface(renderer, page, NULL);
         page->render_status = PAGE_NOT_RENDERED;
         g_mutex_unlock(&page->render_mutex);
     }
 }
 
-static void renderer_queue_page_render(Renderer *renderer, Viewer *viewer, Page* page, unsigned int* const draw_links_from, unsigned int* const draw_links_to)
+static void renderer_queue_page_render(Renderer *renderer, Viewer *viewer, int page_idx, RenderPriority priority, guint order, unsigned int* const draw_links_from, unsigned int* const draw_links_to)
 {
+    Page *page = viewer->info->pages[page_idx];
+
     g_mutex_lock(&page->render_mutex);
     if (page->render_status == PAGE_NOT_RENDERED) {
         g_mutex_unlock(&page->render_mutex);
 
+        // Reload a released page here, workers only use it
+        viewer_info_get_poppler_page(viewer->info, page_idx);
+
         if (viewer->links->follow_links_mode) {
-            PopplerPage* poppler_page = page->poppler_page;
             *draw_links_from = *draw_links_to;
-            *draw_links_to = *draw_links_from + viewer_links_get_links(viewer->links, poppler_page);
+            *draw_links_to = *draw_links_from + viewer_links_get_links(viewer->links, viewer_info_get_link_map(viewer->info, page_idx));
             g_assert(*draw_links_from <= *draw_links_to);
             g_assert(*draw_links_to == viewer->links->visible_links->len);
         }
@@ -249,34 +447,55 @@ static void renderer_queue_page_render(Renderer *renderer, Viewer *viewer, Page*
         RenderPageData* data = g_new0(RenderPageData, 1);
         data->viewer = viewer;
         data->page = page;
+        data->page_idx = page_idx;
         data->draw_links_from = *draw_links_from;
         data->draw_links_to = *draw_links_to;
+        data->queued_at = trace_begin();
 
-        GError *error = NULL;
-        g_thread_pool_push(renderer->render_tp, data, &error);
-        if (error != NULL) {
-            g_warning("Failed to push render task to thread pool: %s", error->message);
-            g_error_free(error);
-            g_free(data);
-        } else {
-            g_mutex_lock(&page->render_mutex);
-            if (page->surface == NULL) {
-                double width, height;
-                poppler_page_get_size(page->poppler_page, &width, &height);
-                double scaled_width = (int)(width * viewer->cursor->scale);
-                double scaled_height = (int)(height * viewer->cursor->scale);
-
-                page->surface = create_loading_surface(scaled_width, scaled_height);
-            }
+        /*
+        * Mark the page before queueing, as a worker may pick it up right away.
+        * The worker waits for the page mutex, so it still finishes last
+        */
+        g_mutex_lock(&page->render_mutex);
+        if (page->surface == NULL) {
+            double scaled_width = (int)(page->width * viewer->cursor->scale);
+            double scaled_height = (int)(page->height * viewer->cursor->scale);
 
-            page->render_status = PAGE_RENDERING;
-            g_mutex_unlock(&page->render_mutex);
+            renderer_set_page_surface(renderer, page, create_loading_surface(scaled_width, scaled_height));
         }
+
+        page->render_status = PAGE_RENDERING;
+        data->generation = ++page->render_generation;
+        g_mutex_unlock(&page->render_mutex);
+
+        g_atomic_int_inc(&renderer->stats.jobs_queued);
+        render_scheduler_push(renderer->scheduler, renderer, priority, order, render_page_async, data);
     } else {
         g_mutex_unlock(&page->render_mutex);
     }
 }
 
+static bool renderer_is_focused(Renderer *renderer)
+{
+    GtkRoot *root;
+
+    if (renderer->view == NULL) {
+        return false;
+    }
+
+    root = gtk_widget_get_root(renderer->view);
+
+    return root != NULL && GTK_IS_WINDOW(root) && gtk_window_is_active(GTK_WINDOW(root));
+}
+
+static gboolean render_page_data_in_range(gpointer data, gpointer user_data)
+{
+    RenderPageData *render_page_data = (RenderPageData *)data;
+    int *range = (int *)user_data;
+
+    return render_page_data->page_idx >= range[0] && render_page_data->page_idx <= range[1];
+}
+
 static void render_page_async(gpointer data, gpointer user_data)
 {
     RenderPageData *render_page_data = (RenderPageData *)data;
@@ -286,62 +505,192 @@ static void render_page_async(gpointer data, gpointer user_data)
     unsigned int draw_links_to = render_page_data->draw_links_to;
     Renderer *renderer = (Renderer *)user_data;
     GtkWidget *view = renderer->view;
-
-    double width, height;
-    poppler_page_get_size(page->poppler_page, &width, &height);
-
+    cairo_surface_t *page_surface;
+    const int page_idx = render_page_data->page_idx;
     const double scale = viewer->cursor->scale;
-    const int scaled_width = (int)(scale * width);
-    const int scaled_height = (int)(scale * height);
+    bool rendering;
+    gint64 trace_start;
 
-    cairo_surface_t *page_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, scaled_width, scaled_height);
-    cairo_t *cr = cairo_create(page_surface);
+    trace_end("render", "queued", render_page_data->queued_at, page_idx);
+    trace_start = trace_begin();
 
-    cairo_scale(cr, scale, scale);
+    g_atomic_int_add(&renderer->stats.jobs_queued, -1);
+    g_atomic_int_inc(&renderer->stats.jobs_in_flight);
 
-    g_mutex_lock(&page->render_mutex);
+    trace_mutex_lock(&page->render_mutex, "page->render_mutex", page_idx);
 
-    renderer_render_page(renderer, viewer, cr, page->poppler_page, draw_links_from, draw_links_to);
+    // The page was reset while this job was waiting, and may have been released since
+    rendering = page->render_status == PAGE_RENDERING && page->render_generation == render_page_data->generation;
 
-    if (page->surface != NULL) {
-        cairo_surface_destroy(page->surface);
+    if (rendering && renderer->processes != NULL && viewer->info->uri != NULL) {
+        // A helper may take until render_timeout_ms, drawing mustn't wait on the page that long
+        g_mutex_unlock(&page->render_mutex);
+        page_surface = render_process_pool_render(renderer->processes, viewer->info->uri, page_idx, scale, (int)(scale * page->width), (int)(scale * page->height));
+        trace_mutex_lock(&page->render_mutex, "page->render_mutex", page_idx);
+
+        rendering = page->render_status == PAGE_RENDERING && page->render_generation == render_page_data->generation;
+        if (rendering) {
+            page_surface = renderer_finish_process_surface(viewer, page, page_surface, scale, draw_links_from, draw_links_to);
+        } else if (page_surface != NULL) {
+            cairo_surface_destroy(page_surface);
+        }
+    } else if (rendering) {
+        page_surface = renderer_render_page_surface(renderer, viewer, page, scale, draw_links_from, draw_links_to);
+    }
+
+    if (rendering) {
+        renderer_set_page_surface(renderer, page, page_surface);
+        page->render_status = PAGE_RENDERED;
     }
-    page->surface = page_surface;
-    page->render_status = PAGE_RENDERED;
 
     g_mutex_unlock(&page->render_mutex);
 
-    g_idle_add_once((GSourceOnceFunc)gtk_widget_queue_draw, view);
+    g_atomic_int_add(&renderer->stats.jobs_in_flight, -1);
 
-    cairo_destroy(cr);
+    // The window may be closed before the main loop gets to it
+    g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, queue_draw_view, g_object_ref(view), g_object_unref);
+
+    trace_end("render", "render_page_async", trace_start, page_idx);
     g_free(render_page_data);
 }
 
-static void renderer_render_page(Renderer *renderer, Viewer *viewer, cairo_t *cr, PopplerPage *page, unsigned int draw_links_from, unsigned int draw_links_to)
+static gboolean queue_draw_view(gpointer view)
 {
-    double width, height;
-    poppler_page_get_size(page, &width, &height);
+    gtk_widget_queue_draw(GTK_WIDGET(view));
+
+    return G_SOURCE_REMOVE;
+}
+
+cairo_surface_t *renderer_render_page_surface(Renderer *renderer, Viewer *viewer, Page *page, double scale, unsigned int draw_links_from, unsigned int draw_links_to)
+{
+    const int scaled_width = (int)(scale * page->width);
+    const int scaled_height = (int)(scale * page->height);
+
+    cairo_surface_t *page_surface;
+    cairo_t *cr;
+
+    if (renderer->processes != NULL && viewer->info->uri != NULL) {
+        page_surface = render_process_pool_render(renderer->processes, viewer->info->uri, poppler_page_get_index(page->poppler_page), scale, scaled_width, scaled_height);
+
+        return renderer_finish_process_surface(viewer, page, page_surface, scale, draw_links_from, draw_links_to);
+    }
+
+    page_surface = surface_pool_create_surface(scaled_width, scaled_height);
+    cr = cairo_create(page_surface);
+    cairo_scale(cr, scale, scale);
+    renderer_render_page(renderer, viewer, cr, page, draw_links_from, draw_links_to);
+    cairo_destroy(cr);
+
+    return page_surface;
+}
+
+/* Draws the overlays onto a surface rendered by a helper, or a message in place of one that failed */
+static cairo_surface_t *renderer_finish_process_surface(Viewer *viewer, Page *page, cairo_surface_t *page_surface, double scale, unsigned int draw_links_from, unsigned int draw_links_to)
+{
+    cairo_t *cr;
+
+    // Rendering it here could take the viewer down with it
+    if (page_surface == NULL) {
+        return create_message_surface((int)(scale * page->width), (int)(scale * page->height), "Render failed");
+    }
+
+    cr = cairo_create(page_surface);
+    cairo_scale(cr, scale, scale);
+    renderer_render_overlays(viewer, cr, page, poppler_page_get_index(page->poppler_page), draw_links_from, draw_links_to);
+    cairo_destroy(cr);
+
+    return page_surface;
+}
+
+static void renderer_render_page(Renderer *renderer, Viewer *viewer, cairo_t *cr, Page *page, unsigned int draw_links_from, unsigned int draw_links_to)
+{
+    const int page_idx = poppler_page_get_index(page->poppler_page);
+    gint64 trace_start;
 
     // Clear to white background (for PDFs with missing background)
     cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_rectangle(cr, 0, 0, page->width, page->height);
     cairo_fill(cr);
 
+    if (g_config->record_pages) {
+        if (page->recording == NULL) {
+            cairo_rectangle_t extents = { 0, 0, page->width, page->height };
+            cairo_surface_t *recording = cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents);
+            cairo_t *recording_cr = cairo_create(recording);
+
+            renderer_render_poppler_page(renderer, recording_cr, page, page_idx);
+            cairo_destroy(recording_cr);
+            page_set_recording(page, recording);
+        }
+
+        // Replaying doesn't touch poppler, so it needs no lock
+        trace_start = trace_begin();
+        cairo_set_source_surface(cr, page->recording, 0, 0);
+        cairo_paint(cr);
+        trace_end("render", "replay_recording", trace_start, page_idx);
+    } else {
+        renderer_render_poppler_page(renderer, cr, page, page_idx);
+    }
+
+    renderer_render_overlays(viewer, cr, page, page_idx, draw_links_from, draw_links_to);
+}
+
+/* Search highlights and link hints, drawn on top of the page content */
+static void renderer_render_overlays(Viewer *viewer, cairo_t *cr, Page *page, int page_idx, unsigned int draw_links_from, unsigned int draw_links_to)
+{
+    gint64 trace_start;
+
+    trace_start = trace_begin();
+    viewer_highlight_search(viewer, cr, page->poppler_page);
+    trace_end("render", "viewer_highlight_search", trace_start, page_idx);
+
+    trace_start = trace_begin();
+    viewer_draw_links(viewer, cr, draw_links_from, draw_links_to);
+    trace_end("render", "viewer_draw_links", trace_start, page_idx);
+}
+
+static void renderer_render_poppler_page(Renderer *renderer, cairo_t *cr, Page *page, int page_idx)
+{
+    gint64 trace_start;
+
     /* poppler_page_render is not thread-safe
     * https://gitlab.freedesktop.org/poppler/poppler/-/issues/1503
     */
-    g_mutex_lock(&renderer->render_mutex);
-    poppler_page_render(page, cr);
+    trace_mutex_lock(&renderer->render_mutex, "render_mutex", page_idx);
+    trace_start = trace_begin();
+    poppler_page_render(page->poppler_page, cr);
+    trace_end("render", "poppler_page_render", trace_start, page_idx);
     g_mutex_unlock(&renderer->render_mutex);
+}
 
-    viewer_highlight_search(viewer, cr, page);
-    viewer_draw_links(viewer, cr, draw_links_from, draw_links_to);
+/* Must be called with the page mutex held */
+static void renderer_set_page_surface(Renderer *renderer, Page *page, cairo_surface_t *surface)
+{
+    gssize delta = 0;
+
+    if (page->surface != NULL) {
+        delta -= cairo_image_surface_get_stride(page->surface) * cairo_image_surface_get_height(page->surface);
+        cairo_surface_destroy(page->surface);
+    }
+
+    if (surface != NULL) {
+        delta += cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+    }
+
+    page->surface = surface;
+    g_atomic_pointer_add(&renderer->stats.resident_bytes, delta);
+    g_atomic_pointer_add(&total_resident_bytes, delta);
 }
 
 static cairo_surface_t* create_loading_surface(int width, int height)
 {
-    cairo_surface_t *loading_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
-    cairo_t *cr = cairo_create(loading_surface);
+    return create_message_surface(width, height, "Loading...");
+}
+
+static cairo_surface_t* create_message_surface(int width, int height, const char *message)
+{
+    cairo_surface_t *message_surface = surface_pool_create_surface(width, height);
+    cairo_t *cr = cairo_create(message_surface);
 
     cairo_set_source_rgb(cr, 1, 1, 1);
     cairo_paint(cr);
@@ -350,19 +699,28 @@ static cairo_surface_t* create_loading_surface(int width, int height)
     cairo_set_font_size(cr, 32);
 
     cairo_text_extents_t extents;
-    cairo_text_extents(cr, "Loading...", &extents);
+    cairo_text_extents(cr, message, &extents);
     double x = (width - extents.width) / 2 - extents.x_bearing;
     double y = (height - extents.height) / 2 - extents.y_bearing;
 
     cairo_move_to(cr, x, y);
-    cairo_show_text(cr, "Loading...");
+    cairo_show_text(cr, message);
 
     cairo_destroy(cr);
 
-    return loading_surface;
+    return message_surface;
 }
 
 static void viewer_translate(Viewer *viewer, cairo_t *cr)
+{
+    double x_translate, y_translate;
+
+    viewer_get_translation(viewer, &x_translate, &y_translate);
+    cairo_translate(cr, x_translate, y_translate);
+}
+
+/* Offset of the first visible page in the view */
+static void viewer_get_translation(Viewer *viewer, double *x_translate, double *y_translate)
 {
     if (viewer->cursor->center_mode) {
         viewer_cursor_center(viewer->cursor);
@@ -388,14 +746,12 @@ static void viewer_translate(Viewer *viewer, cairo_t *cr)
 
     const double x_center_translate = view_center_x - page_center_x;
     const double x_offset_translate = (x_offset / g_config->steps) * page_width;
-    const double x_translate = round(x_center_translate + x_offset_translate);
+    *x_translate = round(x_center_translate + x_offset_translate);
 
     const double y_page_translate = -page_offset_idx * page_height * scale;
     const double y_center_translate = view_center_y - page_center_y;
     const double y_offset_translate = -(y_offset / g_config->steps) * page_height * scale;
-    const double y_translate = round(y_page_translate + y_center_translate + y_offset_translate);
-
-    cairo_translate(cr, x_translate, y_translate);
+    *y_translate = round(y_page_translate + y_center_translate + y_offset_translate);
 }
 
 static void viewer_highlight_search(Viewer *viewer, cairo_t *cr, PopplerPage *page)
@@ -428,29 +784,23 @@ static void viewer_highlight_search(Viewer *viewer, cairo_t *cr, PopplerPage *pa
 
 static void viewer_draw_links(Viewer *viewer, cairo_t *cr, unsigned int from, unsigned int to)
 {
-    PopplerLinkMapping *link_mapping = NULL;
-    char *link_text = NULL;
+    const PageLink *link = NULL;
+    HintAtlas *atlas;
+    cairo_matrix_t matrix;
 
     g_assert(to <= viewer->links->visible_links->len);
-    if (!viewer->links->follow_links_mode) {
+    if (!viewer->links->follow_links_mode || from == to) {
         return;
     }
 
-    for (unsigned int i = from; i < to; i++) {
-        link_mapping = g_ptr_array_index(viewer->links->visible_links, i);
-        link_text = g_strdup_printf("%d", i + 1);
-
-        // Outline
-        cairo_move_to(cr, link_mapping->area.x1, viewer->info->max_page_height - link_mapping->area.y1);
-        cairo_text_path(cr, link_text);
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_set_line_width(cr, 2.0);
-        cairo_stroke_preserve(cr);
-
-        // Actual text
-        cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
-        cairo_fill(cr);
+    cairo_get_matrix(cr, &matrix);
+    atlas = hint_atlas_get(matrix.xx);
 
-        g_free(link_text);
+    for (unsigned int i = from; i < to; i++) {
+        link = g_ptr_array_index(viewer->links->visible_links, i);
+        cairo_move_to(cr, link->area.x1, viewer->info->max_page_height - link->area.y1);
+        hint_atlas_draw_number(atlas, cr, i + 1);
     }
+
+    hint_atlas_unref(atlas);
 }
\ No newline at end of file
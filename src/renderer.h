@@ -1,23 +1,72 @@
 #pragma once
 
 #include "viewer.h"
+#include "render_scheduler.h"
+#include "render_process.h"
+
+typedef struct {
+    int reset_from;
+    int reset_to;
+    int render_from;
+    int render_to;
+} RenderRequest;
+
+/* Counters updated by the renderer and its workers, read with renderer_get_stats */
+typedef struct {
+    gint jobs_queued;
+    gint jobs_in_flight;
+    gint cache_hits;
+    gint cache_misses;
+    // Decaying average of hits over recent page draws, only touched on the main thread
+    double cache_hit_rate;
+    gssize resident_bytes;
+    gint last_draw_us;
+} RendererStats;
 
 typedef struct Renderer {
     GtkWidget *view;
 
-    GThreadPool *render_tp;
+    RenderScheduler *scheduler;
+    // NULL renders with poppler in this process, guarded by render_mutex
+    RenderProcessPool *processes;
     GMutex render_mutex;
 
+    // Includes prefetched pages
     int last_visible_pages_before, last_visible_pages_after;
     double last_scale;
     bool last_follow_links_mode;
     char *last_search_text;
+    // Surfaces were dropped to save memory, only render again once focused
+    bool suspended;
+
+    RendererStats stats;
 } Renderer;
 
-Renderer *renderer_new(GtkWidget *view);
-void renderer_init(Renderer *renderer, GtkWidget *view);
+/* scheduler may be NULL if pages are only rendered with renderer_render_page_surface */
+Renderer *renderer_new(GtkWidget *view, RenderScheduler *scheduler);
+void renderer_init(Renderer *renderer, GtkWidget *view, RenderScheduler *scheduler);
 void renderer_destroy(Renderer *renderer);
+/* Renders pages of documents opened from a file in the processes of pool */
+void renderer_set_process_pool(Renderer *renderer, RenderProcessPool *pool);
 
-void renderer_draw(cairo_t *cr, Viewer *viewer);
+void renderer_draw(Renderer *renderer, cairo_t *cr, Viewer *viewer);
 void renderer_render_visible_pages(Renderer *renderer, Viewer *viewer);
-void renderer_render_pages(Renderer *renderer, Viewer *viewer, int from, int to);
\ No newline at end of file
+/* Renders the visible pages of a suspended renderer again, even if its window isn't focused */
+void renderer_resume(Renderer *renderer, Viewer *viewer);
+void renderer_render_pages(Renderer *renderer, Viewer *viewer, int from, int to);
+bool renderer_visible_pages_rendered(Viewer *viewer);
+/* No render jobs are queued or running and all visible pages are rendered */
+bool renderer_is_idle(Renderer *renderer, Viewer *viewer);
+void renderer_get_stats(Renderer *renderer, RendererStats *stats);
+/* Finds the page under a point of the view. page_x and page_y are in points from the top left of the page */
+bool renderer_view_to_page(Viewer *viewer, double view_x, double view_y, int *page_idx, double *page_x, double *page_y);
+
+/* Bytes held by page surfaces of all renderers */
+gssize renderer_get_total_resident_bytes(void);
+/* Stops prefetching in all renderers while memory is short */
+void renderer_set_prefetch_throttled(bool throttled);
+void renderer_evict_prefetched(Renderer *renderer, Viewer *viewer);
+/* Drops all surfaces until the window of the renderer is focused again */
+void renderer_suspend(Renderer *renderer, Viewer *viewer);
+RenderRequest renderer_generate_request(Renderer *renderer, Viewer *viewer);
+cairo_surface_t *renderer_render_page_surface(Renderer *renderer, Viewer *viewer, Page *page, double scale, unsigned int draw_links_from, unsigned int draw_links_to);
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include <errno.h>
+#include <stdlib.h>
+
+#include "replay.h"
+#include "renderer.h"
+#include "latency.h"
+#include "utils.h"
+
+static void key_recorder_write(KeyRecorder *recorder, const char *type, const char *value);
+static bool key_replayer_parse_line(KeyReplayer *replayer, const char *line);
+static gboolean key_replayer_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data);
+static void key_replayer_dispatch(KeyReplayer *replayer, KeyEvent *event);
+static void key_replayer_report(KeyReplayer *replayer, gint64 end);
+static void key_event_clear(KeyEvent *event);
+
+KeyRecorder *key_recorder_new(const char *path)
+{
+    KeyRecorder *recorder = malloc(sizeof(KeyRecorder));
+    if (recorder == NULL) {
+        return NULL;
+    }
+
+    key_recorder_init(recorder, path);
+    if (recorder->fp == NULL) {
+        free(recorder);
+        return NULL;
+    }
+
+    return recorder;
+}
+
+void key_recorder_init(KeyRecorder *recorder, const char *path)
+{
+    recorder->start = 0;
+    recorder->fp = fopen(path, "w");
+    if (recorder->fp == NULL) {
+        g_printerr("key_recorder_init: %s: %s\n", path, g_strerror(errno));
+        return;
+    }
+
+    fprintf(recorder->fp, "# jumpdf key recording\n");
+}
+
+void key_recorder_destroy(KeyRecorder *recorder)
+{
+    if (recorder->fp != NULL) {
+        fclose(recorder->fp);
+        recorder->fp = NULL;
+    }
+}
+
+void key_recorder_add_key(KeyRecorder *recorder, guint keyval)
+{
+    const char *name = gdk_keyval_name(keyval);
+
+    if (name == NULL) {
+        return;
+    }
+
+    key_recorder_write(recorder, "key", name);
+}
+
+void key_recorder_add_search(KeyRecorder *recorder, const char *search_text)
+{
+    key_recorder_write(recorder, "search", search_text);
+}
+
+static void key_recorder_write(KeyRecorder *recorder, const char *type, const char *value)
+{
+    const gint64 now = g_get_monotonic_time();
+
+    if (recorder == NULL || recorder->fp == NULL) {
+        return;
+    }
+
+    if (recorder->start == 0) {
+        recorder->start = now;
+    }
+
+    fprintf(recorder->fp, "%" G_GINT64_FORMAT " %s %s\n", (now - recorder->start) / 1000, type, value);
+    // Keep the recording usable if the session crashes
+    fflush(recorder->fp);
+}
+
+KeyReplayer *key_replayer_new(const char *path, double speed)
+{
+    KeyReplayer *replayer = malloc(sizeof(KeyReplayer));
+    if (replayer == NULL) {
+        return NULL;
+    }
+
+    if (!key_replayer_init(replayer, path, speed)) {
+        key_replayer_destroy(replayer);
+        free(replayer);
+        return NULL;
+    }
+
+    return replayer;
+}
+
+bool key_replayer_init(KeyReplayer *replayer, const char *path, double speed)
+{
+    GError *error = NULL;
+    gchar *contents = NULL;
+    gchar **lines = NULL;
+    bool ok = true;
+
+    replayer->events = g_array_new(FALSE, TRUE, sizeof(KeyEvent));
+    g_array_set_clear_func(replayer->events, (GDestroyNotify)key_event_clear);
+    replayer->speed = speed;
+    replayer->win = NULL;
+    replayer->tick_id = 0;
+    replayer->next_event = 0;
+    replayer->start = 0;
+    replayer->dispatched_at = 0;
+    replayer->dispatched_frame = -1;
+
+    if (!g_file_get_contents(path, &contents, NULL, &error)) {
+        g_printerr("key_replayer_init: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    lines = g_strsplit(contents, "\n", -1);
+    for (int i = 0; lines[i] != NULL && ok; i++) {
+        if (lines[i][0] == '\0' || lines[i][0] == '#') {
+            continue;
+        }
+
+        ok = key_replayer_parse_line(replayer, lines[i]);
+        if (!ok) {
+            g_printerr("key_replayer_init: %s:%d: Invalid event \"%s\"\n", path, i + 1, lines[i]);
+        }
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+
+    return ok;
+}
+
+void key_replayer_destroy(KeyReplayer *replayer)
+{
+    if (replayer->win != NULL) {
+        if (replayer->tick_id != 0) {
+            gtk_widget_remove_tick_callback(GTK_WIDGET(replayer->win), replayer->tick_id);
+            replayer->tick_id = 0;
+        }
+        g_object_remove_weak_pointer(G_OBJECT(replayer->win), (gpointer *)&replayer->win);
+    }
+
+    g_array_free(replayer->events, TRUE);
+}
+
+void key_replayer_start(KeyReplayer *replayer, Window *win)
+{
+    // The window may be closed before the replay is done
+    replayer->win = win;
+    g_object_add_weak_pointer(G_OBJECT(win), (gpointer *)&replayer->win);
+    replayer->tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(win), key_replayer_tick, replayer, NULL);
+}
+
+static bool key_replayer_parse_line(KeyReplayer *replayer, const char *line)
+{
+    gchar **fields = g_strsplit(line, " ", 3);
+    KeyEvent event = { 0 };
+    gchar *end = NULL;
+    bool ok = false;
+
+    if (g_strv_length(fields) == 3) {
+        event.time_us = g_ascii_strtoll(fields[0], &end, 10) * 1000;
+        ok = end != fields[0] && *end == '\0' && event.time_us >= 0;
+
+        if (ok && g_strcmp0(fields[1], "key") == 0) {
+            event.type = KEY_EVENT_KEY;
+            event.keyval = gdk_keyval_from_name(fields[2]);
+            ok = event.keyval != GDK_KEY_VoidSymbol;
+        } else if (ok && g_strcmp0(fields[1], "search") == 0) {
+            event.type = KEY_EVENT_SEARCH;
+            event.search_text = g_strdup(fields[2]);
+        } else {
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        g_array_append_val(replayer->events, event);
+    }
+
+    g_strfreev(fields);
+
+    return ok;
+}
+
+/*
+* Runs once per frame. An event counts as settled on the first frame after
+* its dispatch where no render jobs are left and all visible pages are
+* rendered, so latencies have frame granularity.
+*/
+static gboolean key_replayer_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+    UNUSED(widget);
+
+    KeyReplayer *replayer = (KeyReplayer *)user_data;
+    Window *win = replayer->win;
+    const gint64 now = g_get_monotonic_time();
+    const gint64 frame = gdk_frame_clock_get_frame_counter(frame_clock);
+    KeyEvent *event;
+
+    if (frame <= replayer->dispatched_frame) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    if (!renderer_is_idle(window_get_renderer(win), window_get_viewer(win))) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    if (replayer->dispatched_at != 0) {
+        event = &g_array_index(replayer->events, KeyEvent, replayer->next_event - 1);
+        event->latency_us = now - replayer->dispatched_at;
+        replayer->dispatched_at = 0;
+    }
+
+    // The document has settled after opening, start the clock
+    if (replayer->start == 0) {
+        replayer->start = now;
+    }
+
+    if (replayer->next_event == replayer->events->len) {
+        replayer->tick_id = 0;
+        key_replayer_report(replayer, now);
+        g_application_quit(G_APPLICATION(gtk_window_get_application(GTK_WINDOW(win))));
+        return G_SOURCE_REMOVE;
+    }
+
+    event = &g_array_index(replayer->events, KeyEvent, replayer->next_event);
+    if (replayer->speed > 0 && now < replayer->start + (gint64)(event->time_us / replayer->speed)) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    replayer->dispatched_at = now;
+    replayer->dispatched_frame = frame;
+    replayer->next_event++;
+    key_replayer_dispatch(replayer, event);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void key_replayer_dispatch(KeyReplayer *replayer, KeyEvent *event)
+{
+    switch (event->type) {
+    case KEY_EVENT_KEY:
+        window_handle_key(replayer->win, event->keyval, GDK_CURRENT_TIME);
+        break;
+    case KEY_EVENT_SEARCH:
+        window_set_search_text(replayer->win, event->search_text);
+        break;
+    }
+}
+
+static void key_replayer_report(KeyReplayer *replayer, gint64 end)
+{
+    KeyEvent *event;
+    gint64 total_latency = 0;
+    gint64 max_latency = 0;
+    const guint n_events = replayer->events->len;
+
+    g_print("%6s %-16s %12s\n", "step", "event", "latency_ms");
+    for (guint i = 0; i < n_events; i++) {
+        event = &g_array_index(replayer->events, KeyEvent, i);
+        g_print("%6u %-16s %12.2f\n", i + 1,
+            event->type == KEY_EVENT_KEY ? gdk_keyval_name(event->keyval) : "search",
+            event->latency_us / 1000.0);
+
+        total_latency += event->latency_us;
+        max_latency = MAX(max_latency, event->latency_us);
+    }
+
+    g_print("Replayed %u events in %.2f ms, mean latency %.2f ms, max latency %.2f ms\n",
+        n_events,
+        (end - replayer->start) / 1000.0,
+        n_events > 0 ? total_latency / 1000.0 / n_events : 0.0,
+        max_latency / 1000.0);
+
+    latency_print_histograms();
+}
+
+static void key_event_clear(KeyEvent *event)
+{
+    g_free(event->search_text);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+#include <gtk/gtk.h>
+
+#include "window.h"
+
+/*
+* Key recordings are text files with one event per line:
+*   <ms since the first event> key <GDK keyval name>
+*   <ms since the first event> search <search text>
+* Lines starting with '#' are ignored.
+*/
+
+typedef struct KeyRecorder {
+    FILE *fp;
+    // Monotonic time of the first event in µs, 0 if none yet
+    gint64 start;
+} KeyRecorder;
+
+KeyRecorder *key_recorder_new(const char *path);
+void key_recorder_init(KeyRecorder *recorder, const char *path);
+void key_recorder_destroy(KeyRecorder *recorder);
+
+void key_recorder_add_key(KeyRecorder *recorder, guint keyval);
+void key_recorder_add_search(KeyRecorder *recorder, const char *search_text);
+
+typedef enum {
+    KEY_EVENT_KEY,
+    KEY_EVENT_SEARCH,
+} KeyEventType;
+
+typedef struct {
+    KeyEventType type;
+    gint64 time_us;
+    guint keyval;
+    gchar *search_text;
+    // Time from dispatch until rendering settled
+    gint64 latency_us;
+} KeyEvent;
+
+typedef struct KeyReplayer {
+    GArray *events;
+    // Factor applied to the recorded pace, 0 replays as fast as possible
+    double speed;
+
+    Window *win;
+    guint tick_id;
+    guint next_event;
+    gint64 start;
+    gint64 dispatched_at;
+    gint64 dispatched_frame;
+} KeyReplayer;
+
+/* Returns NULL if the recording can't be read */
+KeyReplayer *key_replayer_new(const char *path, double speed);
+bool key_replayer_init(KeyReplayer *replayer, const char *path, double speed);
+void key_replayer_destroy(KeyReplayer *replayer);
+
+/*
+* Feeds the events to win once it has settled, then prints a report and
+* quits the application.
+*/
+void key_replayer_start(KeyReplayer *replayer, Window *win);
@@ -1,7 +1,9 @@
 #include "statusline.h"
 #include "config.h"
+#include "app.h"
 
 static gchar *statusline_component_to_str(StatuslineComponent component, Window *win);
+static bool statusline_section_is_live(GArray *section);
 
 StatuslineComponent statusline_component_from_str(gchar *str)
 {
@@ -13,6 +15,16 @@ StatuslineComponent statusline_component_from_str(gchar *str)
         return STATUSLINE_COMPONENT_SCALE;
     } else if (g_strcmp0(str, "Mark selection") == 0) {
         return STATUSLINE_COMPONENT_MARK_SELECTION;
+    } else if (g_strcmp0(str, "Render queue") == 0) {
+        return STATUSLINE_COMPONENT_RENDER_QUEUE;
+    } else if (g_strcmp0(str, "Cache") == 0) {
+        return STATUSLINE_COMPONENT_CACHE;
+    } else if (g_strcmp0(str, "Frame time") == 0) {
+        return STATUSLINE_COMPONENT_FRAME_TIME;
+    } else if (g_strcmp0(str, "Section") == 0) {
+        return STATUSLINE_COMPONENT_SECTION;
+    } else if (g_strcmp0(str, "Indexing") == 0) {
+        return STATUSLINE_COMPONENT_INDEXING;
     } else {
         return 0;
     }
@@ -45,10 +57,37 @@ gchar *statusline_section_to_str(GArray *section, Window *win)
     return final_str;
 }
 
+bool statusline_is_live(void)
+{
+    return statusline_section_is_live(g_config->statusline_left) ||
+        statusline_section_is_live(g_config->statusline_middle) ||
+        statusline_section_is_live(g_config->statusline_right);
+}
+
+static bool statusline_section_is_live(GArray *section)
+{
+    StatuslineComponent component = 0;
+
+    for (guint i = 0; i < section->len; i++) {
+        component = g_array_index(section, StatuslineComponent, i);
+        if (component == STATUSLINE_COMPONENT_RENDER_QUEUE ||
+            component == STATUSLINE_COMPONENT_CACHE ||
+            component == STATUSLINE_COMPONENT_FRAME_TIME) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static gchar *statusline_component_to_str(StatuslineComponent component, Window *win)
 {
     Viewer *viewer = window_get_viewer(win);
     ViewerMarkManager *mark_manager = window_get_mark_manager(win);
+    RendererStats stats;
+    const OutlineEntry *section;
+    TextIndexer *text_indexer;
+    int indexed_pages, n_pages;
 
     switch (component) {
     case STATUSLINE_COMPONENT_PAGE:
@@ -64,6 +103,28 @@ static gchar *statusline_component_to_str(StatuslineComponent component, Window
         return g_strdup_printf("%u:%u",
             viewer_mark_manager_get_current_group_index(mark_manager) + 1,
             viewer_mark_manager_get_current_mark_index(mark_manager) + 1);
+    case STATUSLINE_COMPONENT_RENDER_QUEUE:
+        renderer_get_stats(window_get_renderer(win), &stats);
+        return g_strdup_printf("Q%d R%d", stats.jobs_queued, stats.jobs_in_flight);
+    case STATUSLINE_COMPONENT_CACHE:
+        renderer_get_stats(window_get_renderer(win), &stats);
+        // Recent draws, the session totals stop moving after a while
+        return g_strdup_printf("%d%% %.0fMB",
+            (int)round(100.0 * stats.cache_hit_rate),
+            stats.resident_bytes / (1024.0 * 1024.0));
+    case STATUSLINE_COMPONENT_FRAME_TIME:
+        renderer_get_stats(window_get_renderer(win), &stats);
+        return g_strdup_printf("%.1fms", stats.last_draw_us / 1000.0);
+    case STATUSLINE_COMPONENT_SECTION:
+        section = window_get_current_section(win);
+        return section != NULL ? g_strdup(section->title) : NULL;
+    case STATUSLINE_COMPONENT_INDEXING:
+        // Updated by the indexer, as it progresses without drawing
+        text_indexer = app_get_text_indexer(JUMPDF_APP(gtk_window_get_application(GTK_WINDOW(win))));
+        if (text_indexer == NULL || !text_indexer_get_progress(text_indexer, &indexed_pages, &n_pages)) {
+            return NULL;
+        }
+        return g_strdup_printf("Indexing %d%%", 100 * indexed_pages / n_pages);
     default:
         return NULL;
     }
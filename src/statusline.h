@@ -8,7 +8,14 @@ typedef enum StatuslineComponent {
     STATUSLINE_COMPONENT_CENTER_MODE,
     STATUSLINE_COMPONENT_SCALE,
     STATUSLINE_COMPONENT_MARK_SELECTION,
+    STATUSLINE_COMPONENT_RENDER_QUEUE,
+    STATUSLINE_COMPONENT_CACHE,
+    STATUSLINE_COMPONENT_FRAME_TIME,
+    STATUSLINE_COMPONENT_SECTION,
+    STATUSLINE_COMPONENT_INDEXING,
 } StatuslineComponent;
 
 StatuslineComponent statusline_component_from_str(gchar *str);
-gchar *statusline_section_to_str(GArray *section, Window *win);
\ No newline at end of file
+gchar *statusline_section_to_str(GArray *section, Window *win);
+/* Whether any configured component changes without user input */
+bool statusline_is_live(void);
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "surface_pool.h"
+
+/* Buffer sizes are rounded up to this, so pages of nearly the same size share buffers */
+#define SURFACE_POOL_SIZE_CLASS (64 * 1024)
+/* Idle buffers beyond this are freed, least recently used first */
+#define SURFACE_POOL_MAX_IDLE_BYTES (64 * 1024 * 1024)
+
+typedef struct {
+    gsize size;
+    guchar *data;
+} PooledBuffer;
+
+static GMutex pool_mutex;
+// Most recently released first
+static GQueue idle_buffers = G_QUEUE_INIT;
+static SurfacePoolStats pool_stats = { 0 };
+static const cairo_user_data_key_t buffer_key;
+
+static void surface_pool_release(void *data);
+static void pooled_buffer_free(PooledBuffer *buffer);
+
+cairo_surface_t *surface_pool_create_surface(int width, int height)
+{
+    const int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+    PooledBuffer *buffer = NULL;
+    cairo_surface_t *surface;
+    gsize size;
+
+    // Let cairo report invalid sizes the usual way
+    if (width <= 0 || height <= 0 || stride < 0) {
+        return cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    }
+
+    size = (gsize)stride * (gsize)height;
+    size = (size + SURFACE_POOL_SIZE_CLASS - 1) / SURFACE_POOL_SIZE_CLASS * SURFACE_POOL_SIZE_CLASS;
+
+    g_mutex_lock(&pool_mutex);
+    for (GList *elem = idle_buffers.head; elem != NULL; elem = elem->next) {
+        if (((PooledBuffer *)elem->data)->size == size) {
+            buffer = elem->data;
+            g_queue_delete_link(&idle_buffers, elem);
+            pool_stats.idle_bytes -= size;
+            pool_stats.idle_buffers--;
+            pool_stats.reuses++;
+            break;
+        }
+    }
+    if (buffer == NULL) {
+        pool_stats.allocations++;
+    }
+    pool_stats.in_use_bytes += size;
+    g_mutex_unlock(&pool_mutex);
+
+    if (buffer == NULL) {
+        buffer = g_new(PooledBuffer, 1);
+        buffer->size = size;
+        buffer->data = g_malloc(size);
+    }
+
+    surface = cairo_image_surface_create_for_data(buffer->data, CAIRO_FORMAT_ARGB32, width, height, stride);
+    if (cairo_surface_set_user_data(surface, &buffer_key, buffer, surface_pool_release) != CAIRO_STATUS_SUCCESS) {
+        // The surface points into the buffer, so it must be gone before another surface gets the buffer
+        cairo_surface_destroy(surface);
+        surface_pool_release(buffer);
+        return cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    }
+
+    return surface;
+}
+
+void surface_pool_trim(void)
+{
+    PooledBuffer *buffer;
+
+    g_mutex_lock(&pool_mutex);
+    while ((buffer = g_queue_pop_tail(&idle_buffers)) != NULL) {
+        pooled_buffer_free(buffer);
+    }
+    pool_stats.idle_bytes = 0;
+    pool_stats.idle_buffers = 0;
+    g_mutex_unlock(&pool_mutex);
+}
+
+void surface_pool_get_stats(SurfacePoolStats *stats)
+{
+    g_mutex_lock(&pool_mutex);
+    *stats = pool_stats;
+    g_mutex_unlock(&pool_mutex);
+}
+
+/* Called by cairo when the surface using the buffer is destroyed */
+static void surface_pool_release(void *data)
+{
+    PooledBuffer *buffer = (PooledBuffer *)data;
+
+    g_mutex_lock(&pool_mutex);
+    pool_stats.in_use_bytes -= buffer->size;
+    g_queue_push_head(&idle_buffers, buffer);
+    pool_stats.idle_bytes += buffer->size;
+    pool_stats.idle_buffers++;
+
+    while (pool_stats.idle_bytes > SURFACE_POOL_MAX_IDLE_BYTES) {
+        buffer = g_queue_pop_tail(&idle_buffers);
+        pool_stats.idle_bytes -= buffer->size;
+        pool_stats.idle_buffers--;
+        pooled_buffer_free(buffer);
+    }
+    g_mutex_unlock(&pool_mutex);
+}
+
+static void pooled_buffer_free(PooledBuffer *buffer)
+{
+    g_free(buffer->data);
+    g_free(buffer);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cairo.h>
+#include <glib.h>
+
+/*
+* Process-wide pool of pixel buffers backing ARGB32 image surfaces. A buffer
+* returns to the pool when its surface is destroyed, so pages of the same
+* size reuse buffers instead of allocating new ones while scrolling.
+* Buffers are grouped by size class and idle buffers are bounded in bytes,
+* dropping the least recently used ones first. Safe to use from any thread.
+*/
+
+typedef struct {
+    guint64 reuses;
+    guint64 allocations;
+    // Bytes of buffers backing live surfaces
+    gsize in_use_bytes;
+    // Bytes of buffers waiting in the pool
+    gsize idle_bytes;
+    guint idle_buffers;
+} SurfacePoolStats;
+
+/* Behaves like cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height). The buffer is not cleared */
+cairo_surface_t *surface_pool_create_surface(int width, int height);
+/* Frees all idle buffers */
+void surface_pool_trim(void);
+void surface_pool_get_stats(SurfacePoolStats *stats);
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <poppler.h>
+
+#include "text_indexer.h"
+
+typedef struct {
+    // NULL stops the thread
+    gchar *uri;
+    gchar *fingerprint;
+} TextIndexJob;
+
+static gpointer text_indexer_thread(gpointer data);
+static void text_indexer_index(TextIndexer *indexer, TextIndexJob *job);
+static GPtrArray *text_indexer_extract_batch(TextIndexer *indexer, PopplerDocument *doc, int from, int n_pages);
+static bool text_indexer_commit_batch(TextIndexer *indexer, sqlite3_int64 document_id, int from, GPtrArray *texts);
+static void text_index_job_free(TextIndexJob *job);
+
+TextIndexer *text_indexer_new(const char *path, GSourceFunc on_progress, gpointer on_progress_data)
+{
+    TextIndexer *indexer = malloc(sizeof(TextIndexer));
+    if (indexer == NULL) {
+        return NULL;
+    }
+
+    text_indexer_init(indexer, path, on_progress, on_progress_data);
+
+    return indexer;
+}
+
+void text_indexer_init(TextIndexer *indexer, const char *path, GSourceFunc on_progress, gpointer on_progress_data)
+{
+    database_init(&indexer->db, path);
+    indexer->jobs = g_async_queue_new();
+    indexer->stopping = FALSE;
+    indexer->progress_pages = 0;
+    indexer->progress_n_pages = 0;
+    indexer->on_progress = on_progress;
+    indexer->on_progress_data = on_progress_data;
+    indexer->thread = g_thread_new("text-indexer", text_indexer_thread, indexer);
+}
+
+void text_indexer_destroy(TextIndexer *indexer)
+{
+    TextIndexJob *stop = g_new0(TextIndexJob, 1);
+
+    g_atomic_int_set(&indexer->stopping, TRUE);
+    // Jumps ahead of the queued documents
+    g_async_queue_push_front(indexer->jobs, stop);
+    g_thread_join(indexer->thread);
+
+    g_async_queue_unref(indexer->jobs);
+    database_close(&indexer->db);
+}
+
+void text_indexer_add(TextIndexer *indexer, const char *uri, const char *fingerprint)
+{
+    TextIndexJob *job = g_new(TextIndexJob, 1);
+
+    job->uri = g_strdup(uri);
+    job->fingerprint = g_strdup(fingerprint);
+    g_async_queue_push(indexer->jobs, job);
+}
+
+bool text_indexer_get_progress(TextIndexer *indexer, int *indexed_pages, int *n_pages)
+{
+    *n_pages = g_atomic_int_get(&indexer->progress_n_pages);
+    *indexed_pages = g_atomic_int_get(&indexer->progress_pages);
+
+    return *n_pages > 0;
+}
+
+static gpointer text_indexer_thread(gpointer data)
+{
+    TextIndexer *indexer = data;
+    TextIndexJob *job;
+
+    // Before any document is added to the index in this session
+    database_collect_text_garbage(&indexer->db);
+
+    while ((job = g_async_queue_pop(indexer->jobs))->uri != NULL) {
+        if (!g_atomic_int_get(&indexer->stopping)) {
+            text_indexer_index(indexer, job);
+        }
+        text_index_job_free(job);
+    }
+    text_index_job_free(job);
+
+    return NULL;
+}
+
+static void text_indexer_index(TextIndexer *indexer, TextIndexJob *job)
+{
+    GError *error = NULL;
+    PopplerDocument *doc;
+    sqlite3_int64 document_id;
+    int n_pages;
+    int indexed_pages;
+    GPtrArray *texts;
+    bool committed = true;
+
+    doc = poppler_document_new_from_file(job->uri, NULL, &error);
+    if (doc == NULL) {
+        g_printerr("text_indexer_index: %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    n_pages = poppler_document_get_n_pages(doc);
+    document_id = database_get_text_document(&indexer->db, job->fingerprint, job->uri, n_pages, &indexed_pages);
+    if (document_id < 0 || indexed_pages >= n_pages) {
+        g_object_unref(doc);
+        return;
+    }
+
+    g_atomic_int_set(&indexer->progress_pages, indexed_pages);
+    g_atomic_int_set(&indexer->progress_n_pages, n_pages);
+
+    while (indexed_pages < n_pages && committed && !g_atomic_int_get(&indexer->stopping)) {
+        texts = text_indexer_extract_batch(indexer, doc, indexed_pages, n_pages);
+        committed = text_indexer_commit_batch(indexer, document_id, indexed_pages, texts);
+        if (committed) {
+            indexed_pages += (int)texts->len;
+            g_atomic_int_set(&indexer->progress_pages, indexed_pages);
+            if (indexer->on_progress != NULL) {
+                g_idle_add(indexer->on_progress, indexer->on_progress_data);
+            }
+        }
+        g_ptr_array_unref(texts);
+    }
+
+    g_atomic_int_set(&indexer->progress_n_pages, 0);
+    if (indexer->on_progress != NULL) {
+        g_idle_add(indexer->on_progress, indexer->on_progress_data);
+    }
+
+    g_object_unref(doc);
+}
+
+/* Text of up to TEXT_INDEXER_BATCH_PAGES pages from from on. Runs before the transaction, so the write lock isn't held while poppler works */
+static GPtrArray *text_indexer_extract_batch(TextIndexer *indexer, PopplerDocument *doc, int from, int n_pages)
+{
+    GPtrArray *texts = g_ptr_array_new_with_free_func(g_free);
+    PopplerPage *page;
+    gchar *text;
+
+    for (int i = from; i < n_pages && i < from + TEXT_INDEXER_BATCH_PAGES; i++) {
+        if (i > from && g_atomic_int_get(&indexer->stopping)) {
+            break;
+        }
+
+        page = poppler_document_get_page(doc, i);
+        text = page != NULL ? poppler_page_get_text(page) : NULL;
+        // An unreadable page is indexed as empty, so it is never retried
+        g_ptr_array_add(texts, text != NULL ? text : g_strdup(""));
+        g_clear_object(&page);
+    }
+
+    return texts;
+}
+
+/* Inserts the text of the pages from from on and advances indexed_pages past them, all or nothing */
+static bool text_indexer_commit_batch(TextIndexer *indexer, sqlite3_int64 document_id, int from, GPtrArray *texts)
+{
+    bool ok;
+
+    if (!database_begin(&indexer->db)) {
+        return false;
+    }
+
+    ok = true;
+    for (guint i = 0; i < texts->len && ok; i++) {
+        ok = database_insert_page_text(&indexer->db, document_id, from + (int)i, g_ptr_array_index(texts, i));
+    }
+
+    // A page recorded as indexed without its text would never match a search
+    if (!ok || !database_set_indexed_pages(&indexer->db, document_id, from + (int)texts->len) || !database_commit(&indexer->db)) {
+        database_rollback(&indexer->db);
+        return false;
+    }
+
+    return true;
+}
+
+static void text_index_job_free(TextIndexJob *job)
+{
+    g_free(job->uri);
+    g_free(job->fingerprint);
+    g_free(job);
+}
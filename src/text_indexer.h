@@ -0,0 +1,40 @@
+#pragma once
+
+#include "database.h"
+
+/*
+* Extracts the text of opened documents into the text index of the database
+* on a background thread, with its own connection and its own instance of
+* each document. Pages are committed in batches, so indexing resumes where it
+* stopped when the document is opened again.
+*/
+
+/* Pages committed at once */
+#define TEXT_INDEXER_BATCH_PAGES 32
+
+typedef struct TextIndexer {
+    Database db;
+    GThread *thread;
+    // TextIndexJob *, processed in order
+    GAsyncQueue *jobs;
+    // Set when destroyed, to stop between pages
+    gint stopping;
+
+    // Progress of the document being indexed, n_pages is 0 when idle
+    gint progress_pages;
+    gint progress_n_pages;
+
+    // Called on the main thread after each batch
+    GSourceFunc on_progress;
+    gpointer on_progress_data;
+} TextIndexer;
+
+TextIndexer *text_indexer_new(const char *path, GSourceFunc on_progress, gpointer on_progress_data);
+void text_indexer_init(TextIndexer *indexer, const char *path, GSourceFunc on_progress, gpointer on_progress_data);
+/* Stops after the current page. The rest is indexed in a later session */
+void text_indexer_destroy(TextIndexer *indexer);
+
+/* Does nothing for pages that are already indexed */
+void text_indexer_add(TextIndexer *indexer, const char *uri, const char *fingerprint);
+/* Whether a document is being indexed, and how far along */
+bool text_indexer_get_progress(TextIndexer *indexer, int *indexed_pages, int *n_pages);
@@ -0,0 +1,132 @@
+#include <poppler.h>
+
+#include "thumbnail.h"
+#include "utils.h"
+
+typedef struct {
+    gchar *uri;
+    int page_idx;
+    double width;
+    double height;
+    RenderProcessPool *pool;
+} ThumbnailTask;
+
+static void thumbnail_render_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable);
+static cairo_surface_t *thumbnail_render_surface(const ThumbnailTask *data, double scale, int width, int height, GError **error);
+static cairo_status_t thumbnail_write_png(void *closure, const unsigned char *data, unsigned int length);
+static void thumbnail_task_free(gpointer data);
+
+void thumbnail_render_async(const char *uri, int page_idx, double width, double height, RenderProcessPool *pool,
+    GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+    ThumbnailTask *data = g_new(ThumbnailTask, 1);
+
+    data->uri = g_strdup(uri);
+    data->page_idx = page_idx;
+    data->width = width;
+    data->height = height;
+    data->pool = pool;
+
+    g_task_set_task_data(task, data, thumbnail_task_free);
+    g_task_run_in_thread(task, thumbnail_render_thread);
+    g_object_unref(task);
+}
+
+GBytes *thumbnail_render_finish(GAsyncResult *result, GError **error)
+{
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static void thumbnail_render_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+    const ThumbnailTask *data = task_data;
+    const double scale = THUMBNAIL_SIZE / MAX(data->width, data->height);
+    const int width = MAX((int)(data->width * scale), 1);
+    const int height = MAX((int)(data->height * scale), 1);
+    GError *error = NULL;
+    cairo_surface_t *surface;
+    GByteArray *png;
+    cairo_status_t status;
+
+    UNUSED(source_object);
+
+    if (g_cancellable_is_cancelled(cancellable)) {
+        g_task_return_error_if_cancelled(task);
+        return;
+    }
+
+    surface = thumbnail_render_surface(data, scale, width, height, &error);
+    if (surface == NULL) {
+        g_task_return_error(task, error);
+        return;
+    }
+
+    png = g_byte_array_new();
+    status = cairo_surface_write_to_png_stream(surface, thumbnail_write_png, png);
+    cairo_surface_destroy(surface);
+    if (status != CAIRO_STATUS_SUCCESS) {
+        g_byte_array_unref(png);
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "%s", cairo_status_to_string(status));
+        return;
+    }
+
+    g_task_return_pointer(task, g_byte_array_free_to_bytes(png), (GDestroyNotify)g_bytes_unref);
+}
+
+static cairo_surface_t *thumbnail_render_surface(const ThumbnailTask *data, double scale, int width, int height, GError **error)
+{
+    PopplerDocument *doc;
+    PopplerPage *page;
+    cairo_surface_t *surface;
+    cairo_t *cr;
+
+    // Keeps a page that crashes poppler out of the viewer, like the pages of the window
+    if (data->pool != NULL) {
+        surface = render_process_pool_render(data->pool, data->uri, data->page_idx, scale, width, height);
+        if (surface == NULL) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Could not render page %d", data->page_idx);
+        }
+        return surface;
+    }
+
+    // The document of the window is used by render threads, so open another one
+    doc = poppler_document_new_from_file(data->uri, NULL, error);
+    if (doc == NULL) {
+        return NULL;
+    }
+    page = poppler_document_get_page(doc, data->page_idx);
+    if (page == NULL) {
+        g_object_unref(doc);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Could not open page %d", data->page_idx);
+        return NULL;
+    }
+
+    surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    cr = cairo_create(surface);
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_paint(cr);
+    cairo_scale(cr, scale, scale);
+    poppler_page_render(page, cr);
+    cairo_destroy(cr);
+
+    g_object_unref(page);
+    g_object_unref(doc);
+
+    return surface;
+}
+
+static cairo_status_t thumbnail_write_png(void *closure, const unsigned char *data, unsigned int length)
+{
+    g_byte_array_append(closure, data, length);
+
+    return CAIRO_STATUS_SUCCESS;
+}
+
+static void thumbnail_task_free(gpointer data)
+{
+    ThumbnailTask *task = data;
+
+    g_free(task->uri);
+    g_free(task);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <gio/gio.h>
+
+#include "render_process.h"
+
+/*
+* Small PNG images of a page, shown when choosing a document to open. They
+* are rendered once per version of a document and cached in the database
+* as DATABASE_METADATA_THUMBNAIL.
+*/
+
+/* Longest side in pixels */
+#define THUMBNAIL_SIZE 128
+#define THUMBNAIL_VARIANT_TYPE "ay"
+
+/*
+* Renders page_idx of the document at uri, whose size in PDF points is
+* width x height, on a worker thread. Uses a render process of pool unless
+* it is NULL, else a separate instance of the document.
+*/
+void thumbnail_render_async(const char *uri, int page_idx, double width, double height, RenderProcessPool *pool,
+    GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+/* PNG data */
+GBytes *thumbnail_render_finish(GAsyncResult *result, GError **error);
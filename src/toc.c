@@ -0,0 +1,229 @@
+#include "toc.h"
+#include "utils.h"
+
+struct _TocItem {
+    GObject parent;
+
+    Outline *outline;
+    int index;
+};
+
+struct _TocModel {
+    GObject parent;
+
+    Outline *outline;
+    GArray *rows;
+    // Items created so far, NULL for rows that weren't asked for
+    GPtrArray *items;
+};
+
+static void toc_model_list_model_init(GListModelInterface *iface);
+static GType toc_model_get_item_type(GListModel *list);
+static guint toc_model_get_n_items(GListModel *list);
+static gpointer toc_model_get_item(GListModel *list, guint position);
+static GListModel *toc_tree_create_children(gpointer item, gpointer user_data);
+static void toc_item_unref(gpointer item);
+static guint toc_get_sibling_position(Outline *outline, int index);
+
+G_DEFINE_TYPE(TocItem, toc_item, G_TYPE_OBJECT)
+G_DEFINE_TYPE_WITH_CODE(TocModel, toc_model, G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, toc_model_list_model_init))
+
+static void toc_item_init(TocItem *item)
+{
+    item->outline = NULL;
+    item->index = -1;
+}
+
+static void toc_item_finalize(GObject *object)
+{
+    TocItem *item = JUMPDF_TOC_ITEM(object);
+
+    g_clear_pointer(&item->outline, outline_unref);
+
+    G_OBJECT_CLASS(toc_item_parent_class)->finalize(object);
+}
+
+static void toc_item_class_init(TocItemClass *class)
+{
+    G_OBJECT_CLASS(class)->finalize = toc_item_finalize;
+}
+
+TocItem *toc_item_new(Outline *outline, int index)
+{
+    TocItem *item = g_object_new(TOC_ITEM_TYPE, NULL);
+
+    item->outline = outline_ref(outline);
+    item->index = index;
+
+    return item;
+}
+
+int toc_item_get_index(TocItem *item)
+{
+    return item->index;
+}
+
+const OutlineEntry *toc_item_get_entry(TocItem *item)
+{
+    return &item->outline->entries[item->index];
+}
+
+TocItem *toc_item_from_row(gpointer row)
+{
+    if (GTK_IS_TREE_LIST_ROW(row)) {
+        return gtk_tree_list_row_get_item(GTK_TREE_LIST_ROW(row));
+    }
+
+    return g_object_ref(JUMPDF_TOC_ITEM(row));
+}
+
+static void toc_model_init(TocModel *model)
+{
+    model->outline = NULL;
+    model->rows = NULL;
+    model->items = g_ptr_array_new_with_free_func(toc_item_unref);
+}
+
+static void toc_model_finalize(GObject *object)
+{
+    TocModel *model = JUMPDF_TOC_MODEL(object);
+
+    g_ptr_array_free(model->items, TRUE);
+    if (model->rows != NULL) {
+        g_array_free(model->rows, TRUE);
+    }
+    g_clear_pointer(&model->outline, outline_unref);
+
+    G_OBJECT_CLASS(toc_model_parent_class)->finalize(object);
+}
+
+static void toc_model_class_init(TocModelClass *class)
+{
+    G_OBJECT_CLASS(class)->finalize = toc_model_finalize;
+}
+
+static void toc_model_list_model_init(GListModelInterface *iface)
+{
+    iface->get_item_type = toc_model_get_item_type;
+    iface->get_n_items = toc_model_get_n_items;
+    iface->get_item = toc_model_get_item;
+}
+
+TocModel *toc_model_new(Outline *outline, GArray *rows)
+{
+    TocModel *model = g_object_new(TOC_MODEL_TYPE, NULL);
+
+    model->outline = outline_ref(outline);
+    model->rows = rows;
+    g_ptr_array_set_size(model->items, rows->len);
+
+    return model;
+}
+
+void toc_model_set_rows(TocModel *model, GArray *rows)
+{
+    const guint removed = model->rows->len;
+
+    g_array_free(model->rows, TRUE);
+    model->rows = rows;
+    g_ptr_array_set_size(model->items, 0);
+    g_ptr_array_set_size(model->items, rows->len);
+
+    g_list_model_items_changed(G_LIST_MODEL(model), 0, removed, rows->len);
+}
+
+GtkTreeListModel *toc_tree_model_new(Outline *outline)
+{
+    TocModel *root = toc_model_new(outline, outline_get_children(outline, -1));
+
+    return gtk_tree_list_model_new(G_LIST_MODEL(root), FALSE, FALSE, toc_tree_create_children,
+        outline_ref(outline), (GDestroyNotify)outline_unref);
+}
+
+guint toc_tree_model_expand_to(GtkTreeListModel *tree, Outline *outline, int index)
+{
+    // Entry at each level from the top down to index
+    int *path = g_new(int, outline->entries[index].level + 1);
+    GtkTreeListRow *row;
+    GtkTreeListRow *child;
+    guint position;
+
+    for (int i = index, level = outline->entries[index].level; i >= 0; i = outline->entries[i].parent, level--) {
+        path[level] = i;
+    }
+
+    row = gtk_tree_list_model_get_child_row(tree, toc_get_sibling_position(outline, path[0]));
+    for (int level = 1; level <= outline->entries[index].level; level++) {
+        gtk_tree_list_row_set_expanded(row, TRUE);
+        child = gtk_tree_list_row_get_child_row(row, toc_get_sibling_position(outline, path[level]));
+        g_object_unref(row);
+        row = child;
+    }
+
+    position = gtk_tree_list_row_get_position(row);
+    g_object_unref(row);
+    g_free(path);
+
+    return position;
+}
+
+static GType toc_model_get_item_type(GListModel *list)
+{
+    UNUSED(list);
+
+    return TOC_ITEM_TYPE;
+}
+
+static guint toc_model_get_n_items(GListModel *list)
+{
+    return JUMPDF_TOC_MODEL(list)->rows->len;
+}
+
+static gpointer toc_model_get_item(GListModel *list, guint position)
+{
+    TocModel *model = JUMPDF_TOC_MODEL(list);
+
+    if (position >= model->rows->len) {
+        return NULL;
+    }
+
+    if (g_ptr_array_index(model->items, position) == NULL) {
+        g_ptr_array_index(model->items, position) = toc_item_new(model->outline, g_array_index(model->rows, int, position));
+    }
+
+    return g_object_ref(g_ptr_array_index(model->items, position));
+}
+
+static GListModel *toc_tree_create_children(gpointer item, gpointer user_data)
+{
+    Outline *outline = user_data;
+    const int index = toc_item_get_index(JUMPDF_TOC_ITEM(item));
+
+    if (outline->entries[index].subtree_end == index + 1) {
+        return NULL;
+    }
+
+    return G_LIST_MODEL(toc_model_new(outline, outline_get_children(outline, index)));
+}
+
+/* Position of the entry at index among the children of its parent */
+static guint toc_get_sibling_position(Outline *outline, int index)
+{
+    const int parent = outline->entries[index].parent;
+    guint position = 0;
+
+    for (int i = parent + 1; i < index; i = outline->entries[i].subtree_end) {
+        position++;
+    }
+
+    return position;
+}
+
+static void toc_item_unref(gpointer item)
+{
+    // Rows that weren't asked for have no item
+    if (item != NULL) {
+        g_object_unref(item);
+    }
+}
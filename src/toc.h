@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "outline.h"
+
+/*
+* List models of the TOC. Items are only created for the rows that are
+* asked for, and children of an entry are only listed once it is expanded.
+*/
+
+#define TOC_ITEM_TYPE (toc_item_get_type())
+G_DECLARE_FINAL_TYPE(TocItem, toc_item, JUMPDF, TOC_ITEM, GObject)
+
+#define TOC_MODEL_TYPE (toc_model_get_type())
+G_DECLARE_FINAL_TYPE(TocModel, toc_model, JUMPDF, TOC_MODEL, GObject)
+
+TocItem *toc_item_new(Outline *outline, int index);
+int toc_item_get_index(TocItem *item);
+const OutlineEntry *toc_item_get_entry(TocItem *item);
+/* Returns a new reference to the TocItem of a row of either kind of TOC model */
+TocItem *toc_item_from_row(gpointer row);
+
+/* Lists the entries of outline at the indices in rows, taking ownership of rows */
+TocModel *toc_model_new(Outline *outline, GArray *rows);
+void toc_model_set_rows(TocModel *model, GArray *rows);
+
+/* Tree of the whole outline, with all entries collapsed */
+GtkTreeListModel *toc_tree_model_new(Outline *outline);
+/* Expands the ancestors of the entry at index and returns the position of its row */
+guint toc_tree_model_expand_to(GtkTreeListModel *tree, Outline *outline, int index);
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+#include "toc_filter.h"
+
+#define TOC_FILTER_SCORE_MATCH 16
+#define TOC_FILTER_BONUS_CONSECUTIVE 8
+#define TOC_FILTER_BONUS_WORD_START 12
+#define TOC_FILTER_PENALTY_GAP 1
+
+typedef struct {
+    int index;
+    int score;
+} TocFilterMatch;
+
+static int toc_filter_score(const gchar *title, const gchar *query);
+static int toc_filter_score_from(const gchar *title, const gchar *start, const gchar *query);
+static gint toc_filter_compare_matches(gconstpointer a, gconstpointer b);
+
+TocFilter *toc_filter_new(const Outline *outline)
+{
+    TocFilter *filter = malloc(sizeof(TocFilter));
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    toc_filter_init(filter, outline);
+
+    return filter;
+}
+
+TocFilter *toc_filter_new_from_titles(const char *const *titles, int n_titles)
+{
+    TocFilter *filter = malloc(sizeof(TocFilter));
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    toc_filter_init_from_titles(filter, titles, n_titles);
+
+    return filter;
+}
+
+void toc_filter_init(TocFilter *filter, const Outline *outline)
+{
+    const char **titles = g_new(const char *, outline->n_entries);
+
+    for (int i = 0; i < outline->n_entries; i++) {
+        titles[i] = outline->entries[i].title;
+    }
+    toc_filter_init_from_titles(filter, titles, outline->n_entries);
+
+    g_free(titles);
+}
+
+void toc_filter_init_from_titles(TocFilter *filter, const char *const *titles, int n_titles)
+{
+    GString *table = g_string_new(NULL);
+    gchar *folded;
+
+    filter->n_entries = n_titles;
+    filter->offsets = g_new(guint, n_titles);
+
+    for (int i = 0; i < n_titles; i++) {
+        folded = g_utf8_casefold(titles[i], -1);
+        filter->offsets[i] = table->len;
+        g_string_append_len(table, folded, strlen(folded) + 1);
+        g_free(folded);
+    }
+
+    filter->table = g_string_free(table, FALSE);
+    filter->last_query = NULL;
+    filter->last_matches = g_array_new(FALSE, FALSE, sizeof(int));
+}
+
+void toc_filter_destroy(TocFilter *filter)
+{
+    g_free(filter->table);
+    g_free(filter->offsets);
+    g_free(filter->last_query);
+    g_array_free(filter->last_matches, TRUE);
+}
+
+GArray *toc_filter_match(TocFilter *filter, const char *query)
+{
+    gchar *folded_query = g_utf8_casefold(query, -1);
+    // Every title matching the extended query also matched the previous one
+    const gboolean narrow = filter->last_query != NULL && g_str_has_prefix(folded_query, filter->last_query);
+    const int n_candidates = narrow ? (int)filter->last_matches->len : filter->n_entries;
+    GArray *matches = g_array_new(FALSE, FALSE, sizeof(TocFilterMatch));
+    GArray *result;
+    TocFilterMatch match;
+
+    for (int i = 0; i < n_candidates; i++) {
+        match.index = narrow ? g_array_index(filter->last_matches, int, i) : i;
+        match.score = toc_filter_score(filter->table + filter->offsets[match.index], folded_query);
+        if (match.score >= 0 || *folded_query == '\0') {
+            g_array_append_val(matches, match);
+        }
+    }
+
+    g_array_sort(matches, toc_filter_compare_matches);
+
+    result = g_array_sized_new(FALSE, FALSE, sizeof(int), matches->len);
+    for (guint i = 0; i < matches->len; i++) {
+        g_array_append_val(result, g_array_index(matches, TocFilterMatch, i).index);
+    }
+    g_array_free(matches, TRUE);
+
+    g_array_set_size(filter->last_matches, 0);
+    g_array_append_vals(filter->last_matches, result->data, result->len);
+    g_free(filter->last_query);
+    filter->last_query = folded_query;
+
+    return result;
+}
+
+/* Best score over all starting points of the match, or -1 if query doesn't match */
+static int toc_filter_score(const gchar *title, const gchar *query)
+{
+    const gunichar first = g_utf8_get_char(query);
+    int best = -1;
+    int score;
+
+    for (const gchar *start = title; *start != '\0'; start = g_utf8_next_char(start)) {
+        if (g_utf8_get_char(start) != first) {
+            continue;
+        }
+
+        score = toc_filter_score_from(title, start, query);
+        // If it doesn't match from here, it doesn't match from any later start
+        if (score < 0) {
+            break;
+        }
+        best = MAX(best, score);
+    }
+
+    return best;
+}
+
+/* Matches each character of query at its first occurrence from start */
+static int toc_filter_score_from(const gchar *title, const gchar *start, const gchar *query)
+{
+    const gchar *position = start;
+    const gchar *previous = NULL;
+    gunichar c;
+    int score = 0;
+
+    for (const gchar *q = query; *q != '\0'; q = g_utf8_next_char(q)) {
+        c = g_utf8_get_char(q);
+        while (*position != '\0' && g_utf8_get_char(position) != c) {
+            position = g_utf8_next_char(position);
+            score -= TOC_FILTER_PENALTY_GAP;
+        }
+        if (*position == '\0') {
+            return -1;
+        }
+
+        score += TOC_FILTER_SCORE_MATCH;
+        if (previous != NULL && g_utf8_next_char(previous) == position) {
+            score += TOC_FILTER_BONUS_CONSECUTIVE;
+        }
+        if (position == title || !g_unichar_isalnum(g_utf8_get_char(g_utf8_prev_char(position)))) {
+            score += TOC_FILTER_BONUS_WORD_START;
+        }
+
+        previous = position;
+        position = g_utf8_next_char(position);
+    }
+
+    return MAX(score, 0);
+}
+
+/* Higher scores first, then in outline order */
+static gint toc_filter_compare_matches(gconstpointer a, gconstpointer b)
+{
+    const TocFilterMatch *match_a = a;
+    const TocFilterMatch *match_b = b;
+
+    if (match_a->score != match_b->score) {
+        return match_b->score - match_a->score;
+    }
+
+    return match_a->index - match_b->index;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glib.h>
+
+#include "outline.h"
+
+/*
+* Fuzzy filter over the titles of an outline. Titles are case-folded once
+* into a single string table. A query matches a title if its characters
+* appear in the title in order, and matches are ranked by how contiguous
+* they are and whether they start words. When a query extends the previous
+* one, only the previous matches are considered again. Also filters other
+* lists of names, whose order breaks ties between equal scores.
+*/
+
+typedef struct {
+    // Case-folded titles, each terminated by '\0'
+    gchar *table;
+    // Start of each title in table
+    guint *offsets;
+    int n_entries;
+
+    // Case-folded, NULL before the first query
+    gchar *last_query;
+    // Indices of the entries matching last_query
+    GArray *last_matches;
+} TocFilter;
+
+TocFilter *toc_filter_new(const Outline *outline);
+void toc_filter_init(TocFilter *filter, const Outline *outline);
+TocFilter *toc_filter_new_from_titles(const char *const *titles, int n_titles);
+void toc_filter_init_from_titles(TocFilter *filter, const char *const *titles, int n_titles);
+void toc_filter_destroy(TocFilter *filter);
+
+/* Returns the indices of the entries matching query, best match first */
+GArray *toc_filter_match(TocFilter *filter, const char *query);
@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* Bounds memory use of long sessions. Later events are counted, but dropped */
+#define TRACE_MAX_EVENTS 1000000
+
+typedef struct {
+    const char *category;
+    const char *name;
+    gint64 ts;
+    gint64 dur;
+    int tid;
+    int page;
+} TraceEvent;
+
+static gint enabled = FALSE;
+static gchar *trace_path = NULL;
+static gint64 trace_start = 0;
+static GMutex trace_mutex;
+static GArray *events = NULL;
+static guint dropped_events = 0;
+static gint next_tid = 1;
+static GPrivate thread_tid;
+
+static int trace_get_tid(void);
+
+void trace_init(const char *path)
+{
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+
+    g_mutex_lock(&trace_mutex);
+    g_free(trace_path);
+    trace_path = g_strdup(path);
+    if (events == NULL) {
+        events = g_array_new(FALSE, FALSE, sizeof(TraceEvent));
+        trace_start = g_get_monotonic_time();
+    }
+    g_mutex_unlock(&trace_mutex);
+
+    // Called from the main thread, so it gets the first tid
+    trace_get_tid();
+    g_atomic_int_set(&enabled, TRUE);
+}
+
+void trace_finish(void)
+{
+    FILE *fp;
+    TraceEvent *event;
+    int pid = getpid();
+
+    if (!trace_enabled()) {
+        return;
+    }
+
+    g_atomic_int_set(&enabled, FALSE);
+    g_mutex_lock(&trace_mutex);
+
+    fp = fopen(trace_path, "w");
+    if (fp == NULL) {
+        g_printerr("Could not write trace to \"%s\": %s\n", trace_path, g_strerror(errno));
+    } else {
+        fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 1, \"args\": {\"name\": \"jumpdf\"}}", pid);
+        for (int tid = 1; tid < g_atomic_int_get(&next_tid); tid++) {
+            fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+                pid, tid, tid == 1 ? "main" : "thread", tid);
+        }
+
+        for (guint i = 0; i < events->len; i++) {
+            event = &g_array_index(events, TraceEvent, i);
+            fprintf(fp, ",\n{\"cat\": \"%s\", \"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %" G_GINT64_FORMAT ", \"dur\": %" G_GINT64_FORMAT,
+                event->category, event->name, pid, event->tid, event->ts - trace_start, event->dur);
+            if (event->page >= 0) {
+                fprintf(fp, ", \"args\": {\"page\": %d}", event->page + 1);
+            }
+            fprintf(fp, "}");
+        }
+
+        fprintf(fp, "\n]}\n");
+        fclose(fp);
+
+        g_print("Wrote %u trace events to %s", events->len, trace_path);
+        if (dropped_events > 0) {
+            g_print(" (%u dropped)", dropped_events);
+        }
+        g_print("\n");
+    }
+
+    g_array_free(events, TRUE);
+    events = NULL;
+    g_free(trace_path);
+    trace_path = NULL;
+
+    g_mutex_unlock(&trace_mutex);
+}
+
+bool trace_enabled(void)
+{
+    return g_atomic_int_get(&enabled);
+}
+
+gint64 trace_begin(void)
+{
+    return trace_enabled() ? g_get_monotonic_time() : 0;
+}
+
+void trace_end(const char *category, const char *name, gint64 begin, int page)
+{
+    TraceEvent event;
+
+    // begin is 0 if tracing was enabled in between
+    if (!trace_enabled() || begin == 0) {
+        return;
+    }
+
+    event.category = category;
+    event.name = name;
+    event.ts = begin;
+    event.dur = g_get_monotonic_time() - begin;
+    event.tid = trace_get_tid();
+    event.page = page;
+
+    g_mutex_lock(&trace_mutex);
+    if (events != NULL && events->len < TRACE_MAX_EVENTS) {
+        g_array_append_val(events, event);
+    } else {
+        dropped_events++;
+    }
+    g_mutex_unlock(&trace_mutex);
+}
+
+void trace_mutex_lock(GMutex *mutex, const char *name, int page)
+{
+    gint64 begin = trace_begin();
+
+    g_mutex_lock(mutex);
+    trace_end("lock", name, begin, page);
+}
+
+static int trace_get_tid(void)
+{
+    int tid = GPOINTER_TO_INT(g_private_get(&thread_tid));
+
+    if (tid == 0) {
+        tid = g_atomic_int_add(&next_tid, 1);
+        g_private_set(&thread_tid, GINT_TO_POINTER(tid));
+    }
+
+    return tid;
+}
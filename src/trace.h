@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+/*
+* Opt-in tracing of the render pipeline. Spans are kept in memory and
+* written as a Chrome/Perfetto-compatible JSON trace by trace_finish.
+* When tracing is disabled, every call below returns immediately.
+*
+* Category and name strings must outlive the trace, i.e. be literals.
+*/
+
+void trace_init(const char *path);
+void trace_finish(void);
+bool trace_enabled(void);
+
+/* Returns the start timestamp to pass to trace_end, or 0 if disabled */
+gint64 trace_begin(void);
+/* page is added to the span's arguments unless it is negative */
+void trace_end(const char *category, const char *name, gint64 begin, int page);
+/* Locks mutex, recording the time spent waiting for it as a "lock" span */
+void trace_mutex_lock(GMutex *mutex, const char *name, int page);
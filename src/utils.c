@@ -21,4 +21,37 @@ gchar *expand_path(char *path)
     } else {
         return path;
     }
-}
\ No newline at end of file
+}
+
+void json_append_string(GString *json, const char *str)
+{
+    if (str == NULL) {
+        g_string_append(json, "null");
+        return;
+    }
+
+    g_string_append_c(json, '"');
+    for (const char *c = str; *c != '\0'; c++) {
+        switch (*c) {
+        case '"':
+            g_string_append(json, "\\\"");
+            break;
+        case '\\':
+            g_string_append(json, "\\\\");
+            break;
+        case '\n':
+            g_string_append(json, "\\n");
+            break;
+        case '\t':
+            g_string_append(json, "\\t");
+            break;
+        default:
+            if ((unsigned char)*c < 0x20) {
+                g_string_append_printf(json, "\\u%04x", (unsigned char)*c);
+            } else {
+                g_string_append_c(json, *c);
+            }
+        }
+    }
+    g_string_append_c(json, '"');
+}
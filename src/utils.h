@@ -5,4 +5,6 @@
 #define UNUSED(x) (void)(x)
 
 void ensure_path_exists(const char *path);
-gchar *expand_path(char *path);
\ No newline at end of file
+gchar *expand_path(char *path);
+/* Appends str to json as a quoted and escaped JSON string, or null if str is NULL */
+void json_append_string(GString *json, const char *str);
@@ -63,11 +63,11 @@ void viewer_update_current_page_size(Viewer *viewer)
     }
 
     for (int i = from; i <= to; i++) {
-        PopplerPage *page = viewer_info_get_poppler_page(viewer->info, i);
+        Page *page = viewer->info->pages[i];
         g_assert(page != NULL);
         
-        double width, height;
-        poppler_page_get_size(page, &width, &height);
+        const double width = page->width;
+        const double height = page->height;
         if (isnan(min_width) || width < min_width) {
             min_width = width;
         }
@@ -135,6 +135,12 @@ void viewer_cursor_goto_poppler_dest(ViewerCursor *cursor, PopplerDest *dest)
     }
 }
 
+double viewer_cursor_get_dest_top(ViewerCursor *cursor)
+{
+    // Inverse of the y_offset computed in viewer_cursor_goto_poppler_dest
+    return cursor->info->max_page_height * (1.0 - cursor->y_offset / g_config->steps);
+}
+
 void viewer_cursor_execute_action(ViewerCursor *cursor, PopplerAction *action)
 {
     PopplerActionUri *action_uri;
@@ -44,6 +44,8 @@ void viewer_cursor_handle_offset_update(ViewerCursor *cursor);
 
 void viewer_cursor_goto_page(ViewerCursor *cursor, unsigned int page);
 void viewer_cursor_goto_poppler_dest(ViewerCursor *cursor, PopplerDest *dest);
+/* Position of the cursor on the current page as dest->top, in PDF points from the bottom */
+double viewer_cursor_get_dest_top(ViewerCursor *cursor);
 void viewer_cursor_execute_action(ViewerCursor *cursor, PopplerAction *action);
 
 void viewer_cursor_get_visible_pages(ViewerCursor *cursor, int *from, int *to);
\ No newline at end of file
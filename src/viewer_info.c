@@ -9,12 +9,12 @@ ViewerInfo *viewer_info_new(PopplerDocument *doc)
         return NULL;
     }
 
-    viewer_info_init(info, doc);
+    viewer_info_init(info, doc, NULL);
 
     return info;
 }
 
-ViewerInfo *viewer_info_new_from_gfile(GFile *file)
+ViewerInfo *viewer_info_new_from_gfile(GFile *file, const char *fingerprint, GVariant *page_sizes)
 {
     ViewerInfo *info;
     GError *error = NULL;
@@ -26,31 +26,52 @@ ViewerInfo *viewer_info_new_from_gfile(GFile *file)
         return NULL;
     }
 
-    info = viewer_info_new(doc);
+    info = malloc(sizeof(ViewerInfo));
     if (info == NULL) {
         g_object_unref(doc);
         return NULL;
     }
 
+    viewer_info_init(info, doc, page_sizes);
+    info->uri = g_file_get_uri(file);
+    info->fingerprint = g_strdup(fingerprint);
+
     return info;
 }
 
-void viewer_info_init(ViewerInfo *info, PopplerDocument *doc)
+void viewer_info_init(ViewerInfo *info, PopplerDocument *doc, GVariant *page_sizes)
 {
+    double width, height;
+
     info->doc = doc;
+    info->uri = NULL;
+    info->fingerprint = NULL;
     info->n_pages = poppler_document_get_n_pages(doc);
     info->pages = malloc(sizeof(Page *) * info->n_pages);
     if (info->pages == NULL) {
         return;
     }
 
-    for (int i = 0; i < info->n_pages; i++) {
-        PopplerPage *page = poppler_document_get_page(doc, i);
-        if (page == NULL) {
-            g_printerr("Could not open %i'th page of document\n", i);
-            g_object_unref(info->pages[i]);
-        } else {
-            info->pages[i] = page_new(page);
+    // Sizes from another version of the document don't apply
+    if (page_sizes != NULL && (!g_variant_is_of_type(page_sizes, G_VARIANT_TYPE(VIEWER_INFO_PAGE_SIZES_TYPE)) ||
+        g_variant_n_children(page_sizes) != (gsize)info->n_pages)) {
+        page_sizes = NULL;
+    }
+
+    if (page_sizes != NULL) {
+        for (int i = 0; i < info->n_pages; i++) {
+            g_variant_get_child(page_sizes, i, "(dd)", &width, &height);
+            info->pages[i] = page_new_from_size(width, height);
+        }
+    } else {
+        for (int i = 0; i < info->n_pages; i++) {
+            PopplerPage *page = poppler_document_get_page(doc, i);
+            if (page == NULL) {
+                g_printerr("Could not open %i'th page of document\n", i);
+                g_object_unref(info->pages[i]);
+            } else {
+                info->pages[i] = page_new(page);
+            }
         }
     }
 
@@ -68,6 +89,8 @@ void viewer_info_destroy(ViewerInfo *info)
         g_object_unref(info->doc);
         info->doc = NULL;
     }
+    g_clear_pointer(&info->uri, g_free);
+    g_clear_pointer(&info->fingerprint, g_free);
 
     if (info->pages) {
         for (int i = 0; i < info->n_pages; i++) {
@@ -81,6 +104,18 @@ void viewer_info_destroy(ViewerInfo *info)
     }
 }
 
+GVariant *viewer_info_page_sizes_to_variant(ViewerInfo *info)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE(VIEWER_INFO_PAGE_SIZES_TYPE));
+    for (int i = 0; i < info->n_pages; i++) {
+        g_variant_builder_add(&builder, "(dd)", info->pages[i]->width, info->pages[i]->height);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
 PopplerDest *viewer_info_get_dest(ViewerInfo *info, PopplerDest *dest)
 {
     PopplerDest *actual_dest = NULL;
@@ -100,5 +135,52 @@ PopplerPage *viewer_info_get_poppler_page(ViewerInfo *info, int page_num)
         return NULL;
     }
 
-    return info->pages[page_num]->poppler_page;
+    Page *page = info->pages[page_num];
+    if (page->poppler_page == NULL) {
+        page->poppler_page = poppler_document_get_page(info->doc, page_num);
+    }
+
+    return page->poppler_page;
+}
+
+LinkMap *viewer_info_get_link_map(ViewerInfo *info, int page_num)
+{
+    PopplerPage *poppler_page = viewer_info_get_poppler_page(info, page_num);
+
+    if (poppler_page == NULL) {
+        return NULL;
+    }
+
+    Page *page = info->pages[page_num];
+    if (page->link_map == NULL) {
+        page->link_map = link_map_new(poppler_page);
+    }
+
+    return page->link_map;
+}
+
+int viewer_info_release_poppler_pages(ViewerInfo *info)
+{
+    int n_released = 0;
+
+    for (int i = 0; i < info->n_pages; i++) {
+        if (page_release_poppler_page(info->pages[i])) {
+            n_released++;
+        }
+    }
+
+    return n_released;
+}
+
+int viewer_info_release_recordings(ViewerInfo *info, int from, int to)
+{
+    int n_released = 0;
+
+    for (int i = 0; i < info->n_pages; i++) {
+        if ((i < from || i > to) && page_release_recording(info->pages[i])) {
+            n_released++;
+        }
+    }
+
+    return n_released;
 }
\ No newline at end of file
@@ -6,6 +6,10 @@
 
 typedef struct ViewerInfo {
     PopplerDocument *doc;
+    // Of the document if opened from a file, for render processes to open it again
+    gchar *uri;
+    // See fingerprint_new_from_gfile. NULL if not opened from a file or it couldn't be read
+    gchar *fingerprint;
     Page **pages;
     int n_pages;
     // View dimensions not known until drawn, so use draw_function to update
@@ -13,10 +17,25 @@ typedef struct ViewerInfo {
     double min_page_width, min_page_height, max_page_width, max_page_height;
 } ViewerInfo;
 
+/* Width and height in points of each page */
+#define VIEWER_INFO_PAGE_SIZES_TYPE "a(dd)"
+
 ViewerInfo *viewer_info_new(PopplerDocument *doc);
-ViewerInfo *viewer_info_new_from_gfile(GFile *file);
-void viewer_info_init(ViewerInfo *info, PopplerDocument *doc);
+/*
+* page_sizes is from viewer_info_page_sizes_to_variant for the same
+* fingerprint, or NULL to get the size of each page from the document
+*/
+ViewerInfo *viewer_info_new_from_gfile(GFile *file, const char *fingerprint, GVariant *page_sizes);
+void viewer_info_init(ViewerInfo *info, PopplerDocument *doc, GVariant *page_sizes);
 void viewer_info_destroy(ViewerInfo *info);
 
+GVariant *viewer_info_page_sizes_to_variant(ViewerInfo *info);
 PopplerDest *viewer_info_get_dest(ViewerInfo *info, PopplerDest *dest);
-PopplerPage *viewer_info_get_poppler_page(ViewerInfo *info, int page_num);
\ No newline at end of file
+/* Reloads the page if it was released. Main thread only */
+PopplerPage *viewer_info_get_poppler_page(ViewerInfo *info, int page_num);
+/* Extracts the links of the page on first use. Main thread only */
+LinkMap *viewer_info_get_link_map(ViewerInfo *info, int page_num);
+/* Releases the PopplerPages of pages that aren't rendered. Returns how many */
+int viewer_info_release_poppler_pages(ViewerInfo *info);
+/* Drops the recordings of pages outside from..to. Returns how many */
+int viewer_info_release_recordings(ViewerInfo *info, int from, int to);
\ No newline at end of file
@@ -1,8 +1,6 @@
 #include "viewer_links.h"
 #include "utils.h"
 
-static void poppler_link_mapping_free_cb(gpointer mapping_ptr, gpointer user_data);
-
 ViewerLinks *viewer_links_new(void)
 {
     ViewerLinks *links = malloc(sizeof(ViewerLinks));
@@ -27,31 +25,16 @@ void viewer_links_destroy(ViewerLinks *links)
     g_ptr_array_free(links->visible_links, FALSE);
 }
 
-unsigned int viewer_links_get_links(ViewerLinks *links, PopplerPage *page)
+unsigned int viewer_links_get_links(ViewerLinks *links, const LinkMap *map)
 {
-    GList *link_mappings = poppler_page_get_link_mapping(page);
-    unsigned int link_count = g_list_length(link_mappings);
-    PopplerLinkMapping *link_mapping;
-
-    for (GList *l = link_mappings; l; l = l->next) {
-        link_mapping = poppler_link_mapping_copy(l->data);
-        g_ptr_array_add(links->visible_links, link_mapping);
+    for (int i = 0; i < map->n_links; i++) {
+        g_ptr_array_add(links->visible_links, (gpointer)&map->links[i]);
     }
 
-    poppler_page_free_link_mapping(link_mappings);
-
-    return link_count;
+    return map->n_links;
 }
 
 void viewer_links_clear_links(ViewerLinks *links)
 {
-    g_ptr_array_foreach(links->visible_links, poppler_link_mapping_free_cb, NULL);
     g_ptr_array_set_size(links->visible_links, 0);
 }
-
-static void poppler_link_mapping_free_cb(gpointer mapping_ptr, gpointer user_data) {
-    UNUSED(user_data);
-
-    PopplerLinkMapping *mapping = mapping_ptr;
-    poppler_link_mapping_free(mapping);
-}
\ No newline at end of file
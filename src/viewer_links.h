@@ -3,7 +3,10 @@
 #include <gtk/gtk.h>
 #include <poppler.h>
 
+#include "link_map.h"
+
 typedef struct ViewerLinks {
+    // const PageLink *, owned by the LinkMap of their page
     GPtrArray *visible_links;
     bool follow_links_mode;
 } ViewerLinks;
@@ -12,5 +15,6 @@ ViewerLinks *viewer_links_new(void);
 void viewer_links_init(ViewerLinks *links);
 void viewer_links_destroy(ViewerLinks *links);
 
-unsigned int viewer_links_get_links(ViewerLinks *links, PopplerPage *page);
+/* Appends the links of the page to visible_links. Returns how many */
+unsigned int viewer_links_get_links(ViewerLinks *links, const LinkMap *map);
 void viewer_links_clear_links(ViewerLinks *links);
\ No newline at end of file
@@ -17,6 +17,28 @@ ViewerMarkManager *viewer_mark_manager_copy(ViewerMarkManager *manager)
     return viewer_mark_manager_new(manager->groups, manager->current_group, manager->previous_group);
 }
 
+ViewerMarkManager *viewer_mark_manager_copy_deep(ViewerMarkManager *manager)
+{
+    ViewerMarkGroup *groups[NUM_GROUPS];
+    ViewerCursor *marks[NUM_MARKS];
+    ViewerMarkGroup *group;
+
+    for (unsigned int i = 0; i < NUM_GROUPS; i++) {
+        group = manager->groups[i];
+        if (group == NULL) {
+            groups[i] = NULL;
+            continue;
+        }
+
+        for (unsigned int j = 0; j < NUM_MARKS; j++) {
+            marks[j] = group->marks[j] != NULL ? viewer_cursor_copy(group->marks[j]) : NULL;
+        }
+        groups[i] = viewer_mark_group_new(marks, group->current_mark, group->previous_mark);
+    }
+
+    return viewer_mark_manager_new(groups, manager->current_group, manager->previous_group);
+}
+
 void viewer_mark_manager_init(ViewerMarkManager *manager, ViewerMarkGroup *groups[NUM_GROUPS], unsigned int current_group, unsigned int previous_group)
 {
     if (manager == NULL) {
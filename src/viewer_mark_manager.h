@@ -12,6 +12,8 @@ typedef struct ViewerMarkManager {
 
 ViewerMarkManager *viewer_mark_manager_new(ViewerMarkGroup *groups[NUM_GROUPS], unsigned int current_group, unsigned int previous_group);
 ViewerMarkManager *viewer_mark_manager_copy(ViewerMarkManager *manager);
+/* Unlike viewer_mark_manager_copy, also copies the groups and marks, e.g. to hand to another thread */
+ViewerMarkManager *viewer_mark_manager_copy_deep(ViewerMarkManager *manager);
 void viewer_mark_manager_init(ViewerMarkManager *manager, ViewerMarkGroup *groups[NUM_GROUPS], unsigned int current_group, unsigned int previous_group);
 void viewer_mark_manager_destroy(ViewerMarkManager *manager);
 
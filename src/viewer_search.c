@@ -2,6 +2,9 @@
 
 #include "viewer_search.h"
 
+static bool viewer_search_may_match(ViewerSearch *search, int page);
+static gint viewer_search_compare_pages(gconstpointer a, gconstpointer b);
+
 ViewerSearch *viewer_search_new(void)
 {
     ViewerSearch *search = malloc(sizeof(ViewerSearch));
@@ -18,6 +21,8 @@ void viewer_search_init(ViewerSearch *search)
 {
     search->search_text = NULL;
     search->last_goto_page = -1;
+    search->index_pages = NULL;
+    search->indexed_pages = 0;
 }
 
 void viewer_search_destroy(ViewerSearch *search)
@@ -26,6 +31,14 @@ void viewer_search_destroy(ViewerSearch *search)
         free((void *)search->search_text);
         search->search_text = NULL;
     }
+    g_clear_pointer(&search->index_pages, g_array_unref);
+}
+
+void viewer_search_set_index(ViewerSearch *search, GArray *index_pages, int indexed_pages)
+{
+    g_clear_pointer(&search->index_pages, g_array_unref);
+    search->index_pages = index_pages;
+    search->indexed_pages = index_pages != NULL ? indexed_pages : 0;
 }
 
 ViewerCursor *viewer_search_get_next_search(ViewerSearch *search, ViewerCursor *current_cursor)
@@ -39,6 +52,10 @@ ViewerCursor *viewer_search_get_next_search(ViewerSearch *search, ViewerCursor *
     }
 
     for (int i = current_cursor->current_page; i < current_cursor->info->n_pages; i++) {
+        if (!viewer_search_may_match(search, i)) {
+            continue;
+        }
+
         matches = poppler_page_find_text(viewer_info_get_poppler_page(current_cursor->info, i), search->search_text);
         if (matches && (i != search->last_goto_page || current_cursor->current_page != search->last_goto_page)) {
             next_page = i;
@@ -72,6 +89,10 @@ ViewerCursor *viewer_search_get_prev_search(ViewerSearch *search, ViewerCursor *
     }
 
     for (int i = current_cursor->current_page; i >= 0; i--) {
+        if (!viewer_search_may_match(search, i)) {
+            continue;
+        }
+
         matches = poppler_page_find_text(viewer_info_get_poppler_page(current_cursor->info, i), search->search_text);
         if (matches && (i != search->last_goto_page || current_cursor->current_page != search->last_goto_page)) {
             prev_page = i;
@@ -92,4 +113,19 @@ ViewerCursor *viewer_search_get_prev_search(ViewerSearch *search, ViewerCursor *
 
         return new_cursor;
     }
-}
\ No newline at end of file
+}
+
+/* Whether the page has to be searched, as the index doesn't rule it out */
+static bool viewer_search_may_match(ViewerSearch *search, int page)
+{
+    if (page >= search->indexed_pages) {
+        return true;
+    }
+
+    return bsearch(&page, search->index_pages->data, search->index_pages->len, sizeof(int), viewer_search_compare_pages) != NULL;
+}
+
+static gint viewer_search_compare_pages(gconstpointer a, gconstpointer b)
+{
+    return *(const int *)a - *(const int *)b;
+}
@@ -5,11 +5,18 @@
 typedef struct ViewerSearch {
     const char *search_text;
     int last_goto_page;
+    // Pages the text index found search_text on, in ascending order. NULL if not looked up
+    GArray *index_pages;
+    // Pages covered by index_pages, the others are searched one by one
+    int indexed_pages;
 } ViewerSearch;
 
 ViewerSearch *viewer_search_new(void);
 void viewer_search_init(ViewerSearch *search);
 void viewer_search_destroy(ViewerSearch *search);
 
+/* Takes ownership of index_pages, see database_find_text_pages */
+void viewer_search_set_index(ViewerSearch *search, GArray *index_pages, int indexed_pages);
+
 ViewerCursor *viewer_search_get_next_search(ViewerSearch *search, ViewerCursor *current_cursor);
 ViewerCursor *viewer_search_get_prev_search(ViewerSearch *search, ViewerCursor *current_cursor);
\ No newline at end of file
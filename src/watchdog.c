@@ -0,0 +1,135 @@
+#include "watchdog.h"
+#include "utils.h"
+
+/* How many times per threshold the heartbeat and watchdog run */
+#define WATCHDOG_CHECKS_PER_THRESHOLD 4
+
+static GThread *watchdog_thread = NULL;
+static guint heartbeat_source_id = 0;
+static gint64 threshold_us = 0;
+
+static GMutex watchdog_mutex;
+static GCond watchdog_cond;
+static gboolean watchdog_running = FALSE;
+static gint64 last_heartbeat = 0;
+
+static gpointer current_operation = NULL;
+
+static gboolean watchdog_heartbeat(gpointer user_data);
+static gpointer watchdog_run(gpointer user_data);
+static void watchdog_report(gint64 stall_start, gint64 stall_end, const char *operation, gboolean ongoing);
+
+void watchdog_start(guint threshold_ms)
+{
+    if (threshold_ms == 0 || watchdog_thread != NULL) {
+        return;
+    }
+
+    threshold_us = (gint64)threshold_ms * 1000;
+
+    g_mutex_lock(&watchdog_mutex);
+    watchdog_running = TRUE;
+    last_heartbeat = g_get_monotonic_time();
+    g_mutex_unlock(&watchdog_mutex);
+
+    heartbeat_source_id = g_timeout_add(MAX(1, threshold_ms / WATCHDOG_CHECKS_PER_THRESHOLD), watchdog_heartbeat, NULL);
+    watchdog_thread = g_thread_new("watchdog", watchdog_run, NULL);
+}
+
+void watchdog_stop(void)
+{
+    if (watchdog_thread == NULL) {
+        return;
+    }
+
+    g_source_remove(heartbeat_source_id);
+    heartbeat_source_id = 0;
+
+    g_mutex_lock(&watchdog_mutex);
+    watchdog_running = FALSE;
+    g_cond_signal(&watchdog_cond);
+    g_mutex_unlock(&watchdog_mutex);
+
+    g_thread_join(watchdog_thread);
+    watchdog_thread = NULL;
+}
+
+const char *watchdog_enter(const char *operation)
+{
+    return g_atomic_pointer_exchange(&current_operation, (gpointer)operation);
+}
+
+void watchdog_leave(const char *previous_operation)
+{
+    g_atomic_pointer_set(&current_operation, (gpointer)previous_operation);
+}
+
+static gboolean watchdog_heartbeat(gpointer user_data)
+{
+    UNUSED(user_data);
+
+    g_mutex_lock(&watchdog_mutex);
+    last_heartbeat = g_get_monotonic_time();
+    g_mutex_unlock(&watchdog_mutex);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gpointer watchdog_run(gpointer user_data)
+{
+    UNUSED(user_data);
+
+    const gint64 interval = threshold_us / WATCHDOG_CHECKS_PER_THRESHOLD;
+    gint64 heartbeat;
+    gint64 stall_start = 0;
+    gboolean reported = FALSE;
+    const char *operation = NULL;
+    const char *stalled_operation = NULL;
+
+    g_mutex_lock(&watchdog_mutex);
+    while (watchdog_running) {
+        g_cond_wait_until(&watchdog_cond, &watchdog_mutex, g_get_monotonic_time() + interval);
+        if (!watchdog_running) {
+            break;
+        }
+
+        heartbeat = last_heartbeat;
+        operation = g_atomic_pointer_get(&current_operation);
+
+        if (stall_start == 0 && g_get_monotonic_time() - heartbeat > threshold_us) {
+            stall_start = heartbeat;
+            stalled_operation = operation;
+            reported = FALSE;
+        }
+
+        if (stall_start != 0) {
+            // The marker may be set after the stall started, so keep the first one seen
+            if (stalled_operation == NULL) {
+                stalled_operation = operation;
+            }
+
+            if (heartbeat > stall_start) {
+                watchdog_report(stall_start, heartbeat, stalled_operation, FALSE);
+                stall_start = 0;
+                stalled_operation = NULL;
+            } else if (!reported) {
+                watchdog_report(stall_start, g_get_monotonic_time(), stalled_operation, TRUE);
+                reported = TRUE;
+            }
+        }
+    }
+    g_mutex_unlock(&watchdog_mutex);
+
+    return NULL;
+}
+
+static void watchdog_report(gint64 stall_start, gint64 stall_end, const char *operation, gboolean ongoing)
+{
+    // The heartbeat only runs every interval, so the stall is at most this much shorter
+    const gint64 duration_ms = (stall_end - stall_start) / 1000;
+
+    g_printerr("Watchdog: main loop %s for %" G_GINT64_FORMAT " ms in %s\n",
+        ongoing ? "has been stalled" : "was stalled",
+        duration_ms,
+        operation != NULL ? operation : "an unmarked operation");
+}
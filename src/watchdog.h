@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+* Detects when the main loop has not iterated for longer than a threshold
+* and reports which operation was running, as marked by watchdog_enter.
+*/
+
+void watchdog_start(guint threshold_ms);
+void watchdog_stop(void);
+
+/*
+* Marks operation (a literal) as running on the main thread. Returns the
+* previously running operation, which must be passed to watchdog_leave.
+*/
+const char *watchdog_enter(const char *operation);
+void watchdog_leave(const char *previous_operation);
@@ -14,6 +14,19 @@
 #include "viewer_mark_manager.h"
 #include "input_FSM.h"
 #include "renderer.h"
+#include "latency.h"
+#include "watchdog.h"
+#include "replay.h"
+#include "toc.h"
+#include "toc_filter.h"
+#include "thumbnail.h"
+
+/* Results shown when searching the text of all documents */
+#define WINDOW_TEXT_SEARCH_LIMIT 50
+/* Recently opened documents offered by quick open */
+#define WINDOW_QUICK_OPEN_LIMIT 100
+/* Longest side of a thumbnail in the quick open list, half of the rendered size for HiDPI */
+#define WINDOW_QUICK_OPEN_THUMBNAIL_SIZE (THUMBNAIL_SIZE / 2)
 
 // TODO: Load from file or resource
 static const char *css = 
@@ -53,20 +66,28 @@ static const Keybinding keybindings[] = {
     {".", "Repeat last command (zoom, scroll, search or switch to previous mark or group)", 0},
     {",", "Repeat last jump command (switch to previous mark or group)", 0},
     {"/, Esc", "Show/hide search dialog", 0},
+    {"S, Esc", "Show/hide dialog to search the text of all documents with marks", 0},
     {"o", "Open file chooser", 0},
+    {"O, Esc", "Show/hide dialog to open a recently opened document", 0},
     {"Tab", "Toggle table of contents", 0},
     {"j, k", "Move down, up in table of contents", 1},
+    {"h, l", "Collapse, expand section in table of contents", 1},
     {"/, Esc", "Focus/unfocus search entry in table of contents", 1},
     {"Enter", "Goto selected page in table of contents", 1},
+    {"F10", "Write a JSON snapshot of memory and cache usage to the cache directory", 0},
     {"F11", "Toggle fullscreen", 0},
+    {"F12", "Print input latency histograms to stdout", 0},
     {"?", "Show help dialog", 0}
 };
 
 static void window_update_cursors(Window *win);
 static void window_redraw_all_windows(Window *win);
-static void window_update_statusline(Window *win);
-static void window_populate_toc(Window *win);
-static void window_add_toc_entries(Window *win, PopplerIndexIter *iter, int level);
+static void window_set_outline(Window *win, Outline *outline);
+static void window_update_section(Window *win);
+static void on_outline_loaded(GObject *source_object, GAsyncResult *res, gpointer user_data);
+static bool window_load_cached_outline(Window *win);
+static void window_cache_thumbnail(Window *win);
+static void on_thumbnail_rendered(GObject *source_object, GAsyncResult *res, gpointer user_data);
 
 static gboolean on_key_pressed(GtkWidget *user_data, guint keyval,
                                guint keycode, GdkModifierType state,
@@ -77,9 +98,32 @@ static void on_resize(GtkDrawingArea *area, int width, int height,
                       gpointer user_data);
 static void draw_function(GtkDrawingArea *area, cairo_t *cr, int width,
                           int height, gpointer user_data);
+static void on_realize(GtkWidget *widget, gpointer user_data);
+static void on_after_paint(GdkFrameClock *frame_clock, gpointer user_data);
+static void window_set_label_text(GtkWidget *label, const gchar *text);
+static void on_is_active_changed(GObject *object, GParamSpec *pspec, gpointer user_data);
+static void on_view_motion(GtkEventControllerMotion *controller, double x, double y, gpointer user_data);
+static void on_view_click_released(GtkGestureClick *gesture, int n_press, double x, double y, gpointer user_data);
+static const PageLink *window_get_link_at(Window *win, double x, double y);
 static void on_search_entry_activate(GtkEntry *entry, gpointer user_data);
 static gboolean on_search_window_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data);
-static void on_toc_row_activated(GtkListBox *box, GtkListBoxRow *row, gpointer user_data);
+static void on_text_search_changed(GtkSearchEntry *entry, gpointer user_data);
+static void on_text_search_activate(GtkSearchEntry *entry, gpointer user_data);
+static void on_text_search_stopped(GtkSearchEntry *entry, gpointer user_data);
+static gboolean on_text_search_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data);
+static void on_text_search_row_activated(GtkListBox *list_box, GtkListBoxRow *row, gpointer user_data);
+static void window_open_text_search_match(Window *win, int index);
+static gboolean window_move_list_selection(GtkListBox *list_box, GtkWidget *entry, guint keyval);
+static void on_quick_open_changed(GtkSearchEntry *entry, gpointer user_data);
+static void on_quick_open_activate(GtkSearchEntry *entry, gpointer user_data);
+static void on_quick_open_stopped(GtkSearchEntry *entry, gpointer user_data);
+static gboolean on_quick_open_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data);
+static void on_quick_open_row_activated(GtkListBox *list_box, GtkListBoxRow *row, gpointer user_data);
+static void window_open_quick_open_match(Window *win, int index);
+static void window_clear_quick_open(Window *win);
+static void on_toc_item_setup(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data);
+static void on_toc_item_bind(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data);
+static void on_toc_activate(GtkListView *list_view, guint position, gpointer user_data);
 static void on_toc_search_changed(GtkSearchEntry *entry, gpointer user_data);
 static void on_toc_search_stopped(GtkSearchEntry *entry, gpointer user_data);
 
@@ -89,6 +133,8 @@ struct _Window {
 
     GtkEventController *event_controller;
     GtkEventController *scroll_controller;
+    GtkEventController *motion_controller;
+    GtkGesture *click_gesture;
 
     GtkWidget *main_container;
 
@@ -103,27 +149,59 @@ struct _Window {
     GtkWidget *middle_label;
     GtkWidget *right_label;
 
-    GtkWidget *toc_scroll_window;
     GtkWidget *toc_box;
     GtkWidget *toc_search_entry;
-    GtkWidget *toc_container;
+    GtkWidget *toc_scroll_window;
+    GtkWidget *toc_list_view;
+    // Model is toc_tree, or a flat list of search results
+    GtkSingleSelection *toc_selection;
+    // NULL until the outline is loaded
+    GtkTreeListModel *toc_tree;
+    Outline *toc_outline;
+    TocFilter *toc_filter;
+    // Reused for every query, NULL until the first one
+    TocModel *toc_results;
+    // Entry of the section the cursor is in, -1 if none
+    int toc_section;
 
     GtkWidget *search_window;
     GtkWidget *search_box;
     GtkWidget *search_entry;
     GtkEventController *search_event_controller;
 
+    // Searches the text index of all documents
+    GtkWidget *text_search_window;
+    GtkWidget *text_search_entry;
+    GtkWidget *text_search_list;
+    // DatabaseTextMatch * shown in text_search_list, NULL before the first query
+    GPtrArray *text_search_matches;
+
+    // Opens a recently opened document, fuzzy matched on its name
+    GtkWidget *quick_open_window;
+    GtkWidget *quick_open_entry;
+    GtkWidget *quick_open_list;
+    // DatabaseRecentDocument *, reloaded each time the dialog is shown. NULL while hidden
+    GPtrArray *quick_open_documents;
+    // GdkPaintable * of each document, empty without a thumbnail
+    GPtrArray *quick_open_thumbnails;
+    // Over the names of quick_open_documents
+    TocFilter *quick_open_filter;
+    // Indices into quick_open_documents of the rows of quick_open_list
+    GArray *quick_open_matches;
+
     /*
     This reference to App is necessary, as the Window is not associated
     with a GtkApplication in the destruction phase, making
     gtk_window_get_application not viable.
     */
     App *app;
+    gchar *uri;
     ViewerMarkManager *mark_manager;
     Viewer *viewer;
     Renderer *renderer;
     bool first_draw;
     InputState current_input_state;
+    LatencyProbe latency_probe;
 };
 
 G_DEFINE_TYPE(Window, window, GTK_TYPE_APPLICATION_WINDOW)
@@ -131,16 +209,26 @@ G_DEFINE_TYPE(Window, window, GTK_TYPE_APPLICATION_WINDOW)
 static void window_init(Window *win)
 {
     GtkCssProvider *css_provider;
+    GtkListItemFactory *toc_factory;
+    GtkWidget *text_search_box;
+    GtkWidget *text_search_scroll_window;
+    GtkEventController *text_search_event_controller;
+    GtkWidget *quick_open_box;
+    GtkWidget *quick_open_scroll_window;
+    GtkEventController *quick_open_event_controller;
 
     win->viewer = NULL;
     win->renderer = NULL;
     win->first_draw = TRUE;
     win->current_input_state = STATE_NORMAL;
+    latency_probe_init(&win->latency_probe);
 
     win->event_controller = gtk_event_controller_key_new();
     g_signal_connect_object(win->event_controller, "key-pressed",
         G_CALLBACK(on_key_pressed), win, G_CONNECT_SWAPPED);
     gtk_widget_add_controller(GTK_WIDGET(win), win->event_controller);
+    g_signal_connect(win, "realize", G_CALLBACK(on_realize), win);
+    g_signal_connect(win, "notify::is-active", G_CALLBACK(on_is_active_changed), win);
 
     win->scroll_controller =
         gtk_event_controller_scroll_new(GTK_EVENT_CONTROLLER_SCROLL_BOTH_AXES);
@@ -156,6 +244,15 @@ static void window_init(Window *win)
         win, NULL);
     g_signal_connect(win->view, "resize", G_CALLBACK(on_resize), win);
 
+    win->motion_controller = gtk_event_controller_motion_new();
+    g_signal_connect(win->motion_controller, "motion", G_CALLBACK(on_view_motion), win);
+    gtk_widget_add_controller(win->view, win->motion_controller);
+
+    win->click_gesture = gtk_gesture_click_new();
+    gtk_gesture_single_set_button(GTK_GESTURE_SINGLE(win->click_gesture), GDK_BUTTON_PRIMARY);
+    g_signal_connect(win->click_gesture, "released", G_CALLBACK(on_view_click_released), win);
+    gtk_widget_add_controller(win->view, GTK_EVENT_CONTROLLER(win->click_gesture));
+
     win->statusline = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
     gtk_widget_add_css_class(win->statusline, "statusline");
 
@@ -191,22 +288,36 @@ static void window_init(Window *win)
     g_signal_connect(win->toc_search_entry, "search-changed", G_CALLBACK(on_toc_search_changed), win);
     g_signal_connect(win->toc_search_entry, "stop-search", G_CALLBACK(on_toc_search_stopped), win);
 
-    win->toc_container = gtk_list_box_new();
-    gtk_widget_set_hexpand(win->toc_container, TRUE);
-    g_signal_connect(win->toc_container, "row-activated", G_CALLBACK(on_toc_row_activated), win);
+    // Only rows in view get widgets, so large outlines stay cheap
+    toc_factory = gtk_signal_list_item_factory_new();
+    g_signal_connect(toc_factory, "setup", G_CALLBACK(on_toc_item_setup), NULL);
+    g_signal_connect(toc_factory, "bind", G_CALLBACK(on_toc_item_bind), NULL);
+
+    win->toc_tree = NULL;
+    win->toc_outline = NULL;
+    win->toc_filter = NULL;
+    win->toc_results = NULL;
+    win->toc_section = -1;
+    win->toc_selection = gtk_single_selection_new(NULL);
+    win->toc_list_view = gtk_list_view_new(GTK_SELECTION_MODEL(g_object_ref(win->toc_selection)), toc_factory);
+    gtk_widget_set_hexpand(win->toc_list_view, TRUE);
+    g_signal_connect(win->toc_list_view, "activate", G_CALLBACK(on_toc_activate), win);
+
+    win->toc_scroll_window = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(win->toc_scroll_window), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_propagate_natural_width(GTK_SCROLLED_WINDOW(win->toc_scroll_window), TRUE);
+    gtk_widget_set_vexpand(win->toc_scroll_window, TRUE);
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(win->toc_scroll_window), win->toc_list_view);
 
     win->toc_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
     gtk_box_append(GTK_BOX(win->toc_box), win->toc_search_entry);
-    gtk_box_append(GTK_BOX(win->toc_box), win->toc_container);
-
-    win->toc_scroll_window = gtk_scrolled_window_new();
-    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(win->toc_scroll_window), win->toc_box);
-    gtk_widget_set_visible(win->toc_scroll_window, FALSE);
+    gtk_box_append(GTK_BOX(win->toc_box), win->toc_scroll_window);
+    gtk_widget_set_visible(win->toc_box, FALSE);
     /*
     * in window_toggle_toc, gtk_box_prepend only increases the ref count
     * the first time it is called, so we need to manually increase it here
     */
-    g_object_ref(win->toc_scroll_window);
+    g_object_ref(win->toc_box);
 
     win->search_window = gtk_window_new();
     gtk_window_set_title(GTK_WINDOW(win->search_window), "Search");
@@ -226,6 +337,72 @@ static void window_init(Window *win)
         G_CALLBACK(on_search_window_key_press), win);
     gtk_widget_add_controller(win->search_window, win->search_event_controller);
 
+    win->text_search_window = gtk_window_new();
+    gtk_window_set_title(GTK_WINDOW(win->text_search_window), "Search all documents");
+    gtk_window_set_modal(GTK_WINDOW(win->text_search_window), TRUE);
+    gtk_window_set_transient_for(GTK_WINDOW(win->text_search_window), GTK_WINDOW(win));
+    gtk_window_set_hide_on_close(GTK_WINDOW(win->text_search_window), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(win->text_search_window), 600, 400);
+
+    text_search_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_window_set_child(GTK_WINDOW(win->text_search_window), text_search_box);
+
+    win->text_search_entry = gtk_search_entry_new();
+    g_signal_connect(win->text_search_entry, "search-changed", G_CALLBACK(on_text_search_changed), win);
+    g_signal_connect(win->text_search_entry, "activate", G_CALLBACK(on_text_search_activate), win);
+    g_signal_connect(win->text_search_entry, "stop-search", G_CALLBACK(on_text_search_stopped), win);
+    gtk_box_append(GTK_BOX(text_search_box), win->text_search_entry);
+
+    text_search_scroll_window = gtk_scrolled_window_new();
+    gtk_widget_set_vexpand(text_search_scroll_window, TRUE);
+    gtk_box_append(GTK_BOX(text_search_box), text_search_scroll_window);
+
+    win->text_search_list = gtk_list_box_new();
+    gtk_list_box_set_selection_mode(GTK_LIST_BOX(win->text_search_list), GTK_SELECTION_BROWSE);
+    g_signal_connect(win->text_search_list, "row-activated", G_CALLBACK(on_text_search_row_activated), win);
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(text_search_scroll_window), win->text_search_list);
+    win->text_search_matches = NULL;
+
+    // Captured, so arrow keys move through the results while typing
+    text_search_event_controller = gtk_event_controller_key_new();
+    gtk_event_controller_set_propagation_phase(text_search_event_controller, GTK_PHASE_CAPTURE);
+    g_signal_connect(text_search_event_controller, "key-pressed", G_CALLBACK(on_text_search_key_press), win);
+    gtk_widget_add_controller(win->text_search_window, text_search_event_controller);
+
+    win->quick_open_window = gtk_window_new();
+    gtk_window_set_title(GTK_WINDOW(win->quick_open_window), "Open recent document");
+    gtk_window_set_modal(GTK_WINDOW(win->quick_open_window), TRUE);
+    gtk_window_set_transient_for(GTK_WINDOW(win->quick_open_window), GTK_WINDOW(win));
+    gtk_window_set_hide_on_close(GTK_WINDOW(win->quick_open_window), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(win->quick_open_window), 600, 500);
+
+    quick_open_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_window_set_child(GTK_WINDOW(win->quick_open_window), quick_open_box);
+
+    win->quick_open_entry = gtk_search_entry_new();
+    g_signal_connect(win->quick_open_entry, "search-changed", G_CALLBACK(on_quick_open_changed), win);
+    g_signal_connect(win->quick_open_entry, "activate", G_CALLBACK(on_quick_open_activate), win);
+    g_signal_connect(win->quick_open_entry, "stop-search", G_CALLBACK(on_quick_open_stopped), win);
+    gtk_box_append(GTK_BOX(quick_open_box), win->quick_open_entry);
+
+    quick_open_scroll_window = gtk_scrolled_window_new();
+    gtk_widget_set_vexpand(quick_open_scroll_window, TRUE);
+    gtk_box_append(GTK_BOX(quick_open_box), quick_open_scroll_window);
+
+    win->quick_open_list = gtk_list_box_new();
+    gtk_list_box_set_selection_mode(GTK_LIST_BOX(win->quick_open_list), GTK_SELECTION_BROWSE);
+    g_signal_connect(win->quick_open_list, "row-activated", G_CALLBACK(on_quick_open_row_activated), win);
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(quick_open_scroll_window), win->quick_open_list);
+    win->quick_open_documents = NULL;
+    win->quick_open_thumbnails = NULL;
+    win->quick_open_filter = NULL;
+    win->quick_open_matches = NULL;
+
+    quick_open_event_controller = gtk_event_controller_key_new();
+    gtk_event_controller_set_propagation_phase(quick_open_event_controller, GTK_PHASE_CAPTURE);
+    g_signal_connect(quick_open_event_controller, "key-pressed", G_CALLBACK(on_quick_open_key_press), win);
+    gtk_widget_add_controller(win->quick_open_window, quick_open_event_controller);
+
     win->main_container = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
     gtk_window_set_child(GTK_WINDOW(win), win->main_container);
     gtk_box_append(GTK_BOX(win->main_container), win->view_box);
@@ -261,6 +438,19 @@ static void window_finalize(GObject *object)
         free(win->viewer);
     }
 
+    g_clear_object(&win->toc_selection);
+    g_clear_object(&win->toc_tree);
+    g_clear_object(&win->toc_results);
+    if (win->toc_filter != NULL) {
+        toc_filter_destroy(win->toc_filter);
+        free(win->toc_filter);
+    }
+    g_clear_pointer(&win->toc_outline, outline_unref);
+    g_clear_pointer(&win->text_search_matches, g_ptr_array_unref);
+    window_clear_quick_open(win);
+
+    g_free(win->uri);
+
     app_remove_window(win->app, win);
 
     G_OBJECT_CLASS(window_parent_class)->finalize(object);
@@ -292,11 +482,20 @@ void window_open(Window *win, GFile *file, ViewerMarkManager *mark_manager)
     search = viewer_search_new();
     links = viewer_links_new();
 
+    win->uri = g_file_get_uri(file);
     win->mark_manager = mark_manager;
     win->viewer = viewer_new(cursor->info, cursor, search, links);
-    win->renderer = renderer_new(win->view);
+    win->renderer = renderer_new(win->view, app_get_render_scheduler(win->app));
+    renderer_set_process_pool(win->renderer, app_get_render_process_pool(win->app));
 
-    window_populate_toc(win);
+    if (!window_load_cached_outline(win)) {
+        // Holds the window until the outline is loaded
+        outline_load_async(win->uri, NULL, on_outline_loaded, g_object_ref(win));
+    }
+    window_cache_thumbnail(win);
+    if (app_get_text_indexer(win->app) != NULL && cursor->info->fingerprint != NULL) {
+        text_indexer_add(app_get_text_indexer(win->app), win->uri, cursor->info->fingerprint);
+    }
     window_update_statusline(win);
 
     file_info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME, G_FILE_QUERY_INFO_NONE, NULL, &error);
@@ -308,7 +507,9 @@ void window_open(Window *win, GFile *file, ViewerMarkManager *mark_manager)
         g_object_unref(file_info);
     }
 
-    poppler_page_get_size(viewer_info_get_poppler_page(win->viewer->info, 0), &default_width, &default_height);
+    // Known without loading the page, see page_new_from_size
+    default_width = win->viewer->info->pages[0]->width;
+    default_height = win->viewer->info->pages[0]->height;
     gtk_window_set_default_size(GTK_WINDOW(win), (int)default_width,
         (int)default_width);
 }
@@ -319,9 +520,43 @@ void window_update_cursor(Window *win)
     viewer_cursor_handle_offset_update(win->viewer->cursor);
 }
 
+void window_handle_key(Window *win, guint keyval, guint32 event_time)
+{
+    CommandKind command_kind = input_state_get_command_kind(win->current_input_state, win, keyval);
+
+    if (command_kind != COMMAND_KIND_NONE) {
+        latency_probe_start(&win->latency_probe, command_kind, event_time);
+    }
+
+    win->current_input_state = execute_state(win->current_input_state, win, keyval);
+    window_update_cursors(win);
+    window_redraw_all_windows(win);
+}
+
+void window_set_search_text(Window *win, const gchar *search_text)
+{
+    const char *fingerprint = win->viewer->info->fingerprint;
+    GArray *index_pages = NULL;
+    int indexed_pages = 0;
+
+    g_free((void *)win->viewer->search->search_text);
+    win->viewer->search->search_text = g_strdup(search_text);
+
+    if (app_get_text_indexer(win->app) != NULL && fingerprint != NULL && search_text != NULL) {
+        index_pages = database_find_text_pages(app_get_database(win->app), fingerprint, search_text, &indexed_pages);
+    }
+    viewer_search_set_index(win->viewer->search, index_pages, indexed_pages);
+
+    gtk_window_close(GTK_WINDOW(win->search_window));
+    window_redraw(win);
+}
+
 void window_redraw(Window *win)
 {
+    // Everything that changes marks or cursors redraws, the writer skips saves that change nothing
+    app_mark_dirty(win->app, win->uri);
     gtk_widget_queue_draw(win->view);
+    window_update_section(win);
     window_update_statusline(win);
     renderer_render_visible_pages(win->renderer, win->viewer);
 }
@@ -413,20 +648,88 @@ void window_show_search_dialog(Window *win)
     gtk_window_present(GTK_WINDOW(win->search_window));
 }
 
+void window_show_text_search_dialog(Window *win)
+{
+    gtk_window_present(GTK_WINDOW(win->text_search_window));
+    gtk_widget_grab_focus(win->text_search_entry);
+}
+
+void window_show_quick_open_dialog(Window *win)
+{
+    DatabaseRecentDocument *document;
+    GFile *file;
+    gchar *basename;
+    const char **names;
+    GdkPaintable *thumbnail;
+    GError *error = NULL;
+
+    // Ranked by recency, which breaks ties of the fuzzy filter
+    window_clear_quick_open(win);
+    win->quick_open_documents = database_get_recent_documents(app_get_database(win->app), WINDOW_QUICK_OPEN_LIMIT);
+    win->quick_open_thumbnails = g_ptr_array_new_full(win->quick_open_documents->len, g_object_unref);
+    names = g_new(const char *, win->quick_open_documents->len);
+
+    for (guint i = 0; i < win->quick_open_documents->len; i++) {
+        document = g_ptr_array_index(win->quick_open_documents, i);
+        file = g_file_new_for_uri(document->uri);
+        basename = g_file_get_basename(file);
+        names[i] = g_filename_display_name(basename);
+
+        // Decoded once, as the rows are created again for every query
+        thumbnail = NULL;
+        if (document->thumbnail != NULL) {
+            thumbnail = GDK_PAINTABLE(gdk_texture_new_from_bytes(document->thumbnail, &error));
+            if (thumbnail == NULL) {
+                g_printerr("gdk_texture_new_from_bytes: %s\n", error->message);
+                g_clear_error(&error);
+            }
+        }
+        if (thumbnail == NULL) {
+            thumbnail = gdk_paintable_new_empty(WINDOW_QUICK_OPEN_THUMBNAIL_SIZE, WINDOW_QUICK_OPEN_THUMBNAIL_SIZE);
+        }
+        g_ptr_array_add(win->quick_open_thumbnails, thumbnail);
+
+        g_free(basename);
+        g_object_unref(file);
+    }
+
+    win->quick_open_filter = toc_filter_new_from_titles(names, win->quick_open_documents->len);
+    for (guint i = 0; i < win->quick_open_documents->len; i++) {
+        g_free((gchar *)names[i]);
+    }
+    g_free(names);
+
+    // Lists all documents even if the text didn't change
+    gtk_editable_set_text(GTK_EDITABLE(win->quick_open_entry), "");
+    on_quick_open_changed(GTK_SEARCH_ENTRY(win->quick_open_entry), win);
+
+    gtk_window_present(GTK_WINDOW(win->quick_open_window));
+    gtk_widget_grab_focus(win->quick_open_entry);
+}
+
+void window_goto_page(Window *win, int page)
+{
+    // Keeps the scale, as the view may not have a size yet to fit the page to
+    win->viewer->cursor->current_page = CLAMP(page, 0, win->viewer->info->n_pages - 1);
+    win->viewer->cursor->y_offset = 0;
+
+    window_redraw_all_windows(win);
+}
+
 void window_toggle_toc(Window *win)
 {
-    gboolean is_visible = gtk_widget_get_visible(win->toc_scroll_window);
+    gboolean is_visible = gtk_widget_get_visible(win->toc_box);
 
-    gtk_widget_set_visible(win->toc_scroll_window, !is_visible);
+    gtk_widget_set_visible(win->toc_box, !is_visible);
 
     // It is necessary to remove from main_container in addition,
     // otherwise it will still occupy space
     if (is_visible) {
-        g_object_ref(win->toc_scroll_window);
-        gtk_box_remove(GTK_BOX(win->main_container), win->toc_scroll_window);
+        g_object_ref(win->toc_box);
+        gtk_box_remove(GTK_BOX(win->main_container), win->toc_box);
     } else {
-        gtk_box_prepend(GTK_BOX(win->main_container), win->toc_scroll_window);
-        g_object_unref(win->toc_scroll_window);
+        gtk_box_prepend(GTK_BOX(win->main_container), win->toc_box);
+        g_object_unref(win->toc_box);
     }
 }
 
@@ -435,21 +738,43 @@ void window_focus_toc_search(Window *win)
     gtk_widget_grab_focus(win->toc_search_entry);
 }
 
-void window_execute_toc_row(Window *win, GtkListBoxRow *row)
+void window_execute_toc_selection(Window *win)
 {
-    GtkWidget *toc_entry_box;
-    PopplerDest *dest;
+    gpointer row = gtk_single_selection_get_selected_item(win->toc_selection);
+    TocItem *item;
 
-    if (row != NULL) {
-        toc_entry_box = gtk_list_box_row_get_child(row);
-        dest = g_object_get_data(G_OBJECT(toc_entry_box), "dest");
-
-        if (dest) {
-            viewer_cursor_goto_poppler_dest(win->viewer->cursor, dest);
-            window_redraw_all_windows(win);
-        } else {
-            g_printerr("Error: TOC entry has no destination\n");
-        }
+    if (row == NULL) {
+        return;
+    }
+
+    item = toc_item_from_row(row);
+    viewer_cursor_goto_poppler_dest(win->viewer->cursor, toc_item_get_entry(item)->dest);
+    g_object_unref(item);
+
+    window_redraw_all_windows(win);
+}
+
+void window_move_toc_selection(Window *win, int offset)
+{
+    const guint n_items = g_list_model_get_n_items(G_LIST_MODEL(win->toc_selection));
+    const guint selected = gtk_single_selection_get_selected(win->toc_selection);
+    gint64 position;
+
+    if (selected == GTK_INVALID_LIST_POSITION) {
+        return;
+    }
+
+    position = CLAMP((gint64)selected + offset, 0, (gint64)n_items - 1);
+    gtk_list_view_scroll_to(GTK_LIST_VIEW(win->toc_list_view), (guint)position, GTK_LIST_SCROLL_SELECT, NULL);
+}
+
+void window_set_toc_selection_expanded(Window *win, bool expanded)
+{
+    gpointer row = gtk_single_selection_get_selected_item(win->toc_selection);
+
+    // Search results have no subtrees
+    if (GTK_IS_TREE_LIST_ROW(row)) {
+        gtk_tree_list_row_set_expanded(GTK_TREE_LIST_ROW(row), expanded);
     }
 }
 
@@ -463,9 +788,23 @@ Viewer *window_get_viewer(Window *win)
     return win->viewer;
 }
 
-GtkListBox *window_get_toc_listbox(Window *win)
+Renderer *window_get_renderer(Window *win)
 {
-    return GTK_LIST_BOX(win->toc_container);
+    return win->renderer;
+}
+
+const gchar *window_get_uri(Window *win)
+{
+    return win->uri;
+}
+
+const OutlineEntry *window_get_current_section(Window *win)
+{
+    if (win->toc_outline == NULL || win->toc_section < 0) {
+        return NULL;
+    }
+
+    return &win->toc_outline->entries[win->toc_section];
 }
 
 static void window_update_cursors(Window *win)
@@ -478,34 +817,41 @@ static void window_redraw_all_windows(Window *win)
     app_redraw_windows(win->app);
 }
 
-static void window_update_statusline(Window *win)
+void window_update_statusline(Window *win)
 {
     gchar *statusline_left_str = statusline_section_to_str(g_config->statusline_left, win);
     gchar *statusline_middle_str = statusline_section_to_str(g_config->statusline_middle, win);
     gchar *statusline_right_str = statusline_section_to_str(g_config->statusline_right, win);
 
-    gtk_label_set_text(GTK_LABEL(win->left_label), statusline_left_str);
-    gtk_label_set_text(GTK_LABEL(win->middle_label), statusline_middle_str);
-    gtk_label_set_text(GTK_LABEL(win->right_label), statusline_right_str);
+    window_set_label_text(win->left_label, statusline_left_str);
+    window_set_label_text(win->middle_label, statusline_middle_str);
+    window_set_label_text(win->right_label, statusline_right_str);
 
     g_free(statusline_left_str);
     g_free(statusline_middle_str);
     g_free(statusline_right_str);
 }
 
+/* Live components are updated every frame, so leave labels whose text is the same alone */
+static void window_set_label_text(GtkWidget *label, const gchar *text)
+{
+    if (g_strcmp0(gtk_label_get_text(GTK_LABEL(label)), text) != 0) {
+        gtk_label_set_text(GTK_LABEL(label), text);
+    }
+}
+
 static gboolean on_key_pressed(GtkWidget *user_data, guint keyval,
     guint keycode, GdkModifierType state,
     GtkEventControllerKey *event_controller)
 {
     UNUSED(keycode);
     UNUSED(state);
-    UNUSED(event_controller);
 
     Window *win = (Window *)user_data;
+    GdkEvent *event = gtk_event_controller_get_current_event(GTK_EVENT_CONTROLLER(event_controller));
 
-    win->current_input_state = execute_state(win->current_input_state, win, keyval);
-    window_update_cursors(win);
-    window_redraw_all_windows(win);
+    key_recorder_add_key(app_get_key_recorder(win->app), keyval);
+    window_handle_key(win, keyval, event != NULL ? gdk_event_get_time(event) : GDK_CURRENT_TIME);
 
     return TRUE;
 }
@@ -554,107 +900,257 @@ static void on_resize(GtkDrawingArea *area, int width, int height,
 static void draw_function(GtkDrawingArea *area, cairo_t *cr, int width,
     int height, gpointer user_data)
 {
-    UNUSED(area);
     UNUSED(width);
     UNUSED(height);
 
     Window *win = (Window *)user_data;
     
     viewer_update_current_page_size(win->viewer);
+    // Suspended in the background, but now on screen again, e.g. uncovered
+    renderer_resume(win->renderer, win->viewer);
 
     if (win->first_draw) {
         renderer_render_visible_pages(win->renderer, win->viewer);
         win->first_draw = FALSE;
     }
     
-    renderer_draw(cr, win->viewer);
+    renderer_draw(win->renderer, cr, win->viewer);
+    app_enforce_memory_budget(win->app);
+
+    if (win->latency_probe.kind != COMMAND_KIND_NONE && renderer_visible_pages_rendered(win->viewer)) {
+        latency_probe_frame_drawn(&win->latency_probe, gtk_widget_get_frame_clock(GTK_WIDGET(area)));
+    }
 }
 
-static void window_populate_toc(Window *win)
+static void on_realize(GtkWidget *widget, gpointer user_data)
 {
-    PopplerIndexIter *iter = poppler_index_iter_new(win->viewer->info->doc);
-    if (iter) {
-        window_add_toc_entries(win, iter, 0);
-        poppler_index_iter_free(iter);
+    Window *win = (Window *)user_data;
+    GdkFrameClock *frame_clock = gtk_widget_get_frame_clock(widget);
+
+    g_signal_connect_object(frame_clock, "after-paint", G_CALLBACK(on_after_paint), win, 0);
+}
+
+static void on_after_paint(GdkFrameClock *frame_clock, gpointer user_data)
+{
+    Window *win = (Window *)user_data;
+
+    latency_probe_after_paint(&win->latency_probe, frame_clock);
+
+    // Not from the draw handler, changing a label there queues another layout
+    if (statusline_is_live()) {
+        window_update_statusline(win);
     }
 }
 
-static void window_add_toc_entries(Window *win, PopplerIndexIter *iter, int level)
+static void on_is_active_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
 {
-    PopplerAction *action;
-    PopplerDest *dest;
-    gchar *title_markup, *page_markup;
-    GtkWidget *title_label, *page_label;
-    GtkWidget *toc_entry_box;
-    PopplerIndexIter *child;
-    GtkListBoxRow *first_row;
+    UNUSED(pspec);
 
-    while (iter) {
-        action = poppler_index_iter_get_action(iter);
-        if (action && action->type == POPPLER_ACTION_GOTO_DEST) {
-            dest = viewer_info_get_dest(win->viewer->info, action->goto_dest.dest);
+    Window *win = (Window *)user_data;
 
-            if (dest == NULL) {
-                poppler_action_free(action);
-                if (!poppler_index_iter_next(iter)) {
-                    break;
-                }
-                continue;
-            }
+    // Render the pages that were dropped while the window was in the background
+    if (win->renderer != NULL && win->renderer->suspended && gtk_window_is_active(GTK_WINDOW(object))) {
+        window_redraw(win);
+    }
+}
 
-            title_markup = g_strdup_printf("%*s%s", level * 2, " ", action->any.title);
-            title_label = gtk_label_new(title_markup);
-            g_free(title_markup);
-            gtk_label_set_xalign(GTK_LABEL(title_label), 0.0);
-            gtk_label_set_justify(GTK_LABEL(title_label), GTK_JUSTIFY_LEFT);
-            gtk_widget_set_hexpand(title_label, TRUE);
-
-            page_markup = g_markup_printf_escaped("%d", dest->page_num + 1);
-            page_label = gtk_label_new(page_markup);
-            g_free(page_markup);
-            gtk_label_set_xalign(GTK_LABEL(page_label), 1.0);
-            gtk_label_set_justify(GTK_LABEL(page_label), GTK_JUSTIFY_RIGHT);
-
-            toc_entry_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-            gtk_box_append(GTK_BOX(toc_entry_box), title_label);
-            gtk_box_append(GTK_BOX(toc_entry_box), page_label);
-
-            g_object_set_data_full(G_OBJECT(toc_entry_box), "dest", poppler_dest_copy(dest), (GDestroyNotify)poppler_dest_free);
-            if (action->goto_dest.dest->type == POPPLER_DEST_NAMED) {
-                // Won't be freed by poppler_action_free
-                poppler_dest_free(dest);
-            }
+static void on_view_motion(GtkEventControllerMotion *controller, double x, double y, gpointer user_data)
+{
+    UNUSED(controller);
 
-            gtk_list_box_append(GTK_LIST_BOX(win->toc_container), toc_entry_box);
+    Window *win = (Window *)user_data;
 
-            child = poppler_index_iter_get_child(iter);
-            if (child) {
-                window_add_toc_entries(win, child, level + 1);
-                poppler_index_iter_free(child);
-            }
-        }
+    gtk_widget_set_cursor_from_name(win->view, window_get_link_at(win, x, y) != NULL ? "pointer" : NULL);
+}
 
-        poppler_action_free(action);
+static void on_view_click_released(GtkGestureClick *gesture, int n_press, double x, double y, gpointer user_data)
+{
+    UNUSED(gesture);
+    UNUSED(n_press);
 
-        if (!poppler_index_iter_next(iter)) {
-            break;
-        }
+    Window *win = (Window *)user_data;
+    const PageLink *link = window_get_link_at(win, x, y);
+
+    if (link == NULL) {
+        return;
     }
 
-    first_row = gtk_list_box_get_row_at_index(GTK_LIST_BOX(win->toc_container), 0);
-    if (first_row != NULL) {
-        gtk_list_box_select_row(GTK_LIST_BOX(win->toc_container), first_row);
+    viewer_cursor_execute_action(win->viewer->cursor, link->action);
+
+    // Same as following a hint by number
+    if (win->viewer->links->follow_links_mode) {
+        win->viewer->links->follow_links_mode = false;
+        win->viewer->cursor->input_number = 0;
+        win->current_input_state = STATE_NORMAL;
     }
+
+    window_update_cursors(win);
+    window_redraw_all_windows(win);
+}
+
+static const PageLink *window_get_link_at(Window *win, double x, double y)
+{
+    int page_idx;
+    double page_x, page_y;
+    LinkMap *link_map;
+
+    if (win->viewer == NULL || !renderer_view_to_page(win->viewer, x, y, &page_idx, &page_x, &page_y)) {
+        return NULL;
+    }
+
+    link_map = viewer_info_get_link_map(win->viewer->info, page_idx);
+    if (link_map == NULL) {
+        return NULL;
+    }
+
+    // Link areas have their origin at the bottom left
+    return link_map_hit_test(link_map, page_x, win->viewer->info->pages[page_idx]->height - page_y);
+}
+
+static void window_set_outline(Window *win, Outline *outline)
+{
+    win->toc_outline = outline_ref(outline);
+    win->toc_tree = toc_tree_model_new(outline);
+    win->toc_filter = toc_filter_new(outline);
+
+    // Also applies a search that was typed while loading
+    on_toc_search_changed(GTK_SEARCH_ENTRY(win->toc_search_entry), win);
+    window_update_section(win);
+    window_update_statusline(win);
+}
+
+/* Finds the section of the cursor and selects it in the TOC, unless search results are shown */
+static void window_update_section(Window *win)
+{
+    ViewerCursor *cursor = win->viewer->cursor;
+    int section;
+    guint position;
+
+    if (win->toc_outline == NULL) {
+        return;
+    }
+
+    section = outline_find_section(win->toc_outline, cursor->current_page, viewer_cursor_get_dest_top(cursor));
+    if (section == win->toc_section) {
+        return;
+    }
+    win->toc_section = section;
+
+    if (section < 0 || gtk_single_selection_get_model(win->toc_selection) != G_LIST_MODEL(win->toc_tree)) {
+        return;
+    }
+
+    position = toc_tree_model_expand_to(win->toc_tree, win->toc_outline, section);
+    gtk_list_view_scroll_to(GTK_LIST_VIEW(win->toc_list_view), position, GTK_LIST_SCROLL_SELECT, NULL);
+}
+
+static void on_outline_loaded(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    UNUSED(source_object);
+
+    Window *win = (Window *)user_data;
+    GError *error = NULL;
+    Outline *outline = outline_load_finish(res, &error);
+    const char *previous_operation;
+
+    // E.g. password protected documents can't be opened again, so use the one of the window
+    if (outline == NULL) {
+        g_error_free(error);
+
+        previous_operation = watchdog_enter("outline_new");
+        g_mutex_lock(&win->renderer->render_mutex);
+        outline = outline_new(win->viewer->info->doc);
+        g_mutex_unlock(&win->renderer->render_mutex);
+        watchdog_leave(previous_operation);
+    }
+
+    if (win->viewer->info->fingerprint != NULL) {
+        database_writer_put_metadata(app_get_database_writer(win->app), win->viewer->info->fingerprint,
+            win->uri, DATABASE_METADATA_OUTLINE, outline_to_variant(outline));
+    }
+
+    window_set_outline(win, outline);
+    outline_unref(outline);
+    g_object_unref(win);
+}
+
+/* The outline with resolved destinations of an earlier opening of the same content */
+static bool window_load_cached_outline(Window *win)
+{
+    const char *fingerprint = win->viewer->info->fingerprint;
+    GVariant *variant;
+    Outline *outline;
+
+    if (fingerprint == NULL) {
+        return false;
+    }
+
+    variant = database_get_metadata(app_get_database(win->app), fingerprint, DATABASE_METADATA_OUTLINE,
+        G_VARIANT_TYPE(OUTLINE_VARIANT_TYPE));
+    if (variant == NULL) {
+        return false;
+    }
+
+    outline = outline_new_from_variant(variant);
+    g_variant_unref(variant);
+    if (outline == NULL) {
+        return false;
+    }
+
+    window_set_outline(win, outline);
+    outline_unref(outline);
+
+    return true;
+}
+
+/* Renders the thumbnail of the first page shown by quick open, once per version of the document */
+static void window_cache_thumbnail(Window *win)
+{
+    ViewerInfo *info = win->viewer->info;
+    GVariant *thumbnail;
+
+    if (info->fingerprint == NULL) {
+        return;
+    }
+
+    thumbnail = database_get_metadata(app_get_database(win->app), info->fingerprint, DATABASE_METADATA_THUMBNAIL,
+        G_VARIANT_TYPE(THUMBNAIL_VARIANT_TYPE));
+    if (thumbnail != NULL) {
+        g_variant_unref(thumbnail);
+        return;
+    }
+
+    // Holds the window until the thumbnail is rendered
+    thumbnail_render_async(win->uri, 0, info->pages[0]->width, info->pages[0]->height,
+        app_get_render_process_pool(win->app), NULL, on_thumbnail_rendered, g_object_ref(win));
+}
+
+static void on_thumbnail_rendered(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    UNUSED(source_object);
+
+    Window *win = (Window *)user_data;
+    GError *error = NULL;
+    GBytes *png = thumbnail_render_finish(res, &error);
+
+    if (png == NULL) {
+        g_printerr("thumbnail_render: %s\n", error->message);
+        g_error_free(error);
+    } else {
+        database_writer_put_metadata(app_get_database_writer(win->app), win->viewer->info->fingerprint, win->uri,
+            DATABASE_METADATA_THUMBNAIL, g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, png, TRUE));
+        g_bytes_unref(png);
+    }
+
+    g_object_unref(win);
 }
 
 static void on_search_entry_activate(GtkEntry *entry, gpointer user_data) {
     Window *win = (Window *)user_data;
     const gchar *text = gtk_editable_get_text(GTK_EDITABLE(entry));
 
-    win->viewer->search->search_text = g_strdup(text);
-
-    gtk_window_close(GTK_WINDOW(win->search_window));
-    window_redraw(win);
+    key_recorder_add_search(app_get_key_recorder(win->app), text);
+    window_set_search_text(win, text);
 }
 
 static gboolean on_search_window_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data)
@@ -675,46 +1171,346 @@ static gboolean on_search_window_key_press(GtkEventControllerKey *controller, gu
     }
 }
 
-static void on_toc_row_activated(GtkListBox *box, GtkListBoxRow *row, gpointer user_data)
+static void on_text_search_changed(GtkSearchEntry *entry, gpointer user_data)
+{
+    Window *win = (Window *)user_data;
+    const gchar *text = gtk_editable_get_text(GTK_EDITABLE(entry));
+    DatabaseTextMatch *match;
+    GFile *file;
+    gchar *basename;
+    gchar *name;
+    gchar *markup;
+    GtkWidget *label;
+
+    gtk_list_box_remove_all(GTK_LIST_BOX(win->text_search_list));
+    g_clear_pointer(&win->text_search_matches, g_ptr_array_unref);
+    if (database_has_text_index(app_get_database(win->app))) {
+        win->text_search_matches = database_search_text(app_get_database(win->app), text, WINDOW_TEXT_SEARCH_LIMIT);
+    } else {
+        win->text_search_matches = g_ptr_array_new();
+    }
+
+    for (guint i = 0; i < win->text_search_matches->len; i++) {
+        match = g_ptr_array_index(win->text_search_matches, i);
+        file = g_file_new_for_uri(match->uri);
+        basename = g_file_get_basename(file);
+        name = g_filename_display_name(basename);
+
+        markup = g_markup_printf_escaped("<b>%s</b>  %d\n%s", name, match->page + 1, match->snippet);
+        label = gtk_label_new(NULL);
+        gtk_label_set_markup(GTK_LABEL(label), markup);
+        gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+        gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+        gtk_list_box_append(GTK_LIST_BOX(win->text_search_list), label);
+
+        g_free(markup);
+        g_free(name);
+        g_free(basename);
+        g_object_unref(file);
+    }
+
+    gtk_list_box_select_row(GTK_LIST_BOX(win->text_search_list),
+        gtk_list_box_get_row_at_index(GTK_LIST_BOX(win->text_search_list), 0));
+}
+
+static void on_text_search_activate(GtkSearchEntry *entry, gpointer user_data)
 {
-    UNUSED(row);
+    UNUSED(entry);
 
     Window *win = (Window *)user_data;
-    GtkListBoxRow *selected_row = gtk_list_box_get_selected_row(box);
+    GtkListBoxRow *row = gtk_list_box_get_selected_row(GTK_LIST_BOX(win->text_search_list));
 
-    window_execute_toc_row(win, selected_row);
+    if (row != NULL) {
+        window_open_text_search_match(win, gtk_list_box_row_get_index(row));
+    }
+}
+
+static void on_text_search_stopped(GtkSearchEntry *entry, gpointer user_data)
+{
+    UNUSED(entry);
+
+    Window *win = (Window *)user_data;
+
+    gtk_window_close(GTK_WINDOW(win->text_search_window));
+}
+
+static gboolean on_text_search_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data)
+{
+    UNUSED(controller);
+    UNUSED(state);
+    UNUSED(keycode);
+
+    Window *win = (Window *)user_data;
+
+    return window_move_list_selection(GTK_LIST_BOX(win->text_search_list), win->text_search_entry, keyval);
+}
+
+/* Moves the selection of the results of a dialog with the arrow keys, keeping the focus in its entry */
+static gboolean window_move_list_selection(GtkListBox *list_box, GtkWidget *entry, guint keyval)
+{
+    GtkListBoxRow *row = gtk_list_box_get_selected_row(list_box);
+    int offset;
+
+    switch (keyval) {
+    case GDK_KEY_Down:
+        offset = 1;
+        break;
+    case GDK_KEY_Up:
+        offset = -1;
+        break;
+    default:
+        return FALSE;
+    }
+
+    if (row != NULL) {
+        row = gtk_list_box_get_row_at_index(list_box, gtk_list_box_row_get_index(row) + offset);
+    }
+    if (row != NULL) {
+        gtk_list_box_select_row(list_box, row);
+        gtk_widget_grab_focus(entry);
+    }
+
+    return TRUE;
+}
+
+static void on_text_search_row_activated(GtkListBox *list_box, GtkListBoxRow *row, gpointer user_data)
+{
+    UNUSED(list_box);
+
+    window_open_text_search_match((Window *)user_data, gtk_list_box_row_get_index(row));
+}
+
+/* Opens the document of the match at its page, with the query as search text */
+static void window_open_text_search_match(Window *win, int index)
+{
+    DatabaseTextMatch *match = g_ptr_array_index(win->text_search_matches, index);
+    GFile *file = g_file_new_for_uri(match->uri);
+    gchar *text = g_strdup(gtk_editable_get_text(GTK_EDITABLE(win->text_search_entry)));
+    Window *target;
+
+    gtk_window_close(GTK_WINDOW(win->text_search_window));
+
+    target = app_open_at_page(win->app, file, match->page);
+    if (target != NULL) {
+        window_set_search_text(target, text);
+    }
+
+    g_free(text);
+    g_object_unref(file);
+}
+
+static void on_quick_open_changed(GtkSearchEntry *entry, gpointer user_data)
+{
+    Window *win = (Window *)user_data;
+    DatabaseRecentDocument *document;
+    GtkWidget *row_box;
+    GtkWidget *picture;
+    GtkWidget *label;
+    GFile *file;
+    gchar *basename;
+    gchar *name;
+    gchar *path;
+    gchar *markup;
+    int index;
+
+    if (win->quick_open_filter == NULL) {
+        return;
+    }
+
+    gtk_list_box_remove_all(GTK_LIST_BOX(win->quick_open_list));
+    g_clear_pointer(&win->quick_open_matches, g_array_unref);
+    win->quick_open_matches = toc_filter_match(win->quick_open_filter, gtk_editable_get_text(GTK_EDITABLE(entry)));
+
+    for (guint i = 0; i < win->quick_open_matches->len; i++) {
+        index = g_array_index(win->quick_open_matches, int, i);
+        document = g_ptr_array_index(win->quick_open_documents, index);
+        file = g_file_new_for_uri(document->uri);
+        basename = g_file_get_basename(file);
+        name = g_filename_display_name(basename);
+        path = g_file_get_parse_name(file);
+
+        row_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+
+        picture = gtk_picture_new_for_paintable(g_ptr_array_index(win->quick_open_thumbnails, index));
+        gtk_picture_set_content_fit(GTK_PICTURE(picture), GTK_CONTENT_FIT_CONTAIN);
+        gtk_widget_set_size_request(picture, WINDOW_QUICK_OPEN_THUMBNAIL_SIZE, WINDOW_QUICK_OPEN_THUMBNAIL_SIZE);
+        gtk_box_append(GTK_BOX(row_box), picture);
+
+        markup = g_markup_printf_escaped("<b>%s</b>\n<small>%s</small>", name, path);
+        label = gtk_label_new(NULL);
+        gtk_label_set_markup(GTK_LABEL(label), markup);
+        gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+        gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_MIDDLE);
+        gtk_widget_set_hexpand(label, TRUE);
+        gtk_box_append(GTK_BOX(row_box), label);
+
+        gtk_list_box_append(GTK_LIST_BOX(win->quick_open_list), row_box);
+
+        g_free(markup);
+        g_free(path);
+        g_free(name);
+        g_free(basename);
+        g_object_unref(file);
+    }
+
+    gtk_list_box_select_row(GTK_LIST_BOX(win->quick_open_list),
+        gtk_list_box_get_row_at_index(GTK_LIST_BOX(win->quick_open_list), 0));
+}
+
+static void on_quick_open_activate(GtkSearchEntry *entry, gpointer user_data)
+{
+    UNUSED(entry);
+
+    Window *win = (Window *)user_data;
+    GtkListBoxRow *row = gtk_list_box_get_selected_row(GTK_LIST_BOX(win->quick_open_list));
+
+    if (row != NULL) {
+        window_open_quick_open_match(win, gtk_list_box_row_get_index(row));
+    }
+}
+
+static void on_quick_open_stopped(GtkSearchEntry *entry, gpointer user_data)
+{
+    UNUSED(entry);
+
+    Window *win = (Window *)user_data;
+
+    gtk_window_close(GTK_WINDOW(win->quick_open_window));
+}
+
+static gboolean on_quick_open_key_press(GtkEventControllerKey *controller, guint keyval, guint keycode, GdkModifierType state, gpointer user_data)
+{
+    UNUSED(controller);
+    UNUSED(state);
+    UNUSED(keycode);
+
+    Window *win = (Window *)user_data;
+
+    return window_move_list_selection(GTK_LIST_BOX(win->quick_open_list), win->quick_open_entry, keyval);
+}
+
+static void on_quick_open_row_activated(GtkListBox *list_box, GtkListBoxRow *row, gpointer user_data)
+{
+    UNUSED(list_box);
+
+    window_open_quick_open_match((Window *)user_data, gtk_list_box_row_get_index(row));
+}
+
+/* Opens the document of the row at its last cursor, or presents its window */
+static void window_open_quick_open_match(Window *win, int index)
+{
+    DatabaseRecentDocument *document = g_ptr_array_index(win->quick_open_documents,
+        g_array_index(win->quick_open_matches, int, index));
+    GFile *file = g_file_new_for_uri(document->uri);
+
+    gtk_window_close(GTK_WINDOW(win->quick_open_window));
+    app_present(win->app, file);
+
+    g_object_unref(file);
+    window_clear_quick_open(win);
+}
+
+/* Frees what the quick open dialog loaded when it was shown */
+static void window_clear_quick_open(Window *win)
+{
+    g_clear_pointer(&win->quick_open_matches, g_array_unref);
+    g_clear_pointer(&win->quick_open_thumbnails, g_ptr_array_unref);
+    g_clear_pointer(&win->quick_open_documents, g_ptr_array_unref);
+    if (win->quick_open_filter != NULL) {
+        toc_filter_destroy(win->quick_open_filter);
+        free(win->quick_open_filter);
+        win->quick_open_filter = NULL;
+    }
+}
+
+static void on_toc_item_setup(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data)
+{
+    UNUSED(factory);
+    UNUSED(user_data);
+
+    GtkWidget *expander = gtk_tree_expander_new();
+    GtkWidget *toc_entry_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    GtkWidget *title_label = gtk_label_new(NULL);
+    GtkWidget *page_label = gtk_label_new(NULL);
+
+    gtk_label_set_xalign(GTK_LABEL(title_label), 0.0);
+    gtk_label_set_justify(GTK_LABEL(title_label), GTK_JUSTIFY_LEFT);
+    gtk_widget_set_hexpand(title_label, TRUE);
+
+    gtk_label_set_xalign(GTK_LABEL(page_label), 1.0);
+    gtk_label_set_justify(GTK_LABEL(page_label), GTK_JUSTIFY_RIGHT);
+
+    gtk_box_append(GTK_BOX(toc_entry_box), title_label);
+    gtk_box_append(GTK_BOX(toc_entry_box), page_label);
+    gtk_tree_expander_set_child(GTK_TREE_EXPANDER(expander), toc_entry_box);
+    gtk_list_item_set_child(list_item, expander);
+}
+
+static void on_toc_item_bind(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data)
+{
+    UNUSED(factory);
+    UNUSED(user_data);
+
+    GtkWidget *expander = gtk_list_item_get_child(list_item);
+    GtkWidget *toc_entry_box = gtk_tree_expander_get_child(GTK_TREE_EXPANDER(expander));
+    gpointer row = gtk_list_item_get_item(list_item);
+    TocItem *item = toc_item_from_row(row);
+    const OutlineEntry *entry = toc_item_get_entry(item);
+    gchar *page_text;
+
+    // Search results are a flat list
+    gtk_tree_expander_set_list_row(GTK_TREE_EXPANDER(expander), GTK_IS_TREE_LIST_ROW(row) ? GTK_TREE_LIST_ROW(row) : NULL);
+
+    gtk_label_set_text(GTK_LABEL(gtk_widget_get_first_child(toc_entry_box)), entry->title);
+    page_text = g_strdup_printf("%d", entry->dest->page_num + 1);
+    gtk_label_set_text(GTK_LABEL(gtk_widget_get_last_child(toc_entry_box)), page_text);
+    g_free(page_text);
+
+    g_object_unref(item);
+}
+
+static void on_toc_activate(GtkListView *list_view, guint position, gpointer user_data)
+{
+    UNUSED(list_view);
+    UNUSED(position);
+
+    Window *win = (Window *)user_data;
+
+    window_execute_toc_selection(win);
 }
 
 static void on_toc_search_changed(GtkSearchEntry *entry, gpointer user_data)
 {
     Window *win = (Window *)user_data;
     const gchar *text = gtk_editable_get_text(GTK_EDITABLE(entry));
-    GtkWidget *child = gtk_widget_get_first_child(GTK_WIDGET(win->toc_container));
-    GtkWidget *box;
-    GtkWidget *title_label;
-    const gchar *child_text;
-    gboolean visible;
-    GtkListBoxRow *first_visible_row;
-
-    while (child) {
-        box = gtk_widget_get_first_child(child);
-        title_label = gtk_widget_get_first_child(box);
-        if (GTK_IS_LABEL(title_label)) {
-            child_text = gtk_label_get_text(GTK_LABEL(title_label));
-
-            visible = strcasestr(child_text, text) != NULL;
-            gtk_widget_set_visible(child, visible);
-        }
+    GArray *rows;
 
-        child = gtk_widget_get_next_sibling(child);
+    if (win->toc_outline == NULL) {
+        return;
+    }
+
+    if (*text == '\0') {
+        gtk_single_selection_set_model(win->toc_selection, G_LIST_MODEL(win->toc_tree));
+        // Select the section of the cursor again
+        win->toc_section = -1;
+        window_update_section(win);
+        return;
+    }
+
+    rows = toc_filter_match(win->toc_filter, text);
+    if (win->toc_results == NULL) {
+        win->toc_results = toc_model_new(win->toc_outline, rows);
+    } else {
+        toc_model_set_rows(win->toc_results, rows);
     }
 
-    first_visible_row = gtk_list_box_get_row_at_index(GTK_LIST_BOX(win->toc_container), 0);
-    while (first_visible_row != NULL && !gtk_widget_get_visible(GTK_WIDGET(first_visible_row))) {
-        first_visible_row = gtk_list_box_get_row_at_index(GTK_LIST_BOX(win->toc_container), gtk_list_box_row_get_index(first_visible_row) + 1);
+    if (gtk_single_selection_get_model(win->toc_selection) != G_LIST_MODEL(win->toc_results)) {
+        gtk_single_selection_set_model(win->toc_selection, G_LIST_MODEL(win->toc_results));
     }
-    if (first_visible_row != NULL) {
-        gtk_list_box_select_row(GTK_LIST_BOX(win->toc_container), first_visible_row);
+    // Best match. The rows are replaced in place, so neither the selection nor the scroll position follow on their own
+    gtk_single_selection_set_selected(win->toc_selection, 0);
+    if (rows->len > 0) {
+        gtk_list_view_scroll_to(GTK_LIST_VIEW(win->toc_list_view), 0, GTK_LIST_SCROLL_SELECT, NULL);
     }
 }
 
@@ -724,5 +1520,5 @@ static void on_toc_search_stopped(GtkSearchEntry *entry, gpointer user_data)
 
     Window *win = (Window *)user_data;
 
-    gtk_widget_grab_focus(win->toc_scroll_window);
+    gtk_widget_grab_focus(win->toc_list_view);
 }
\ No newline at end of file
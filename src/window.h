@@ -4,6 +4,8 @@
 
 #include "viewer_mark_manager.h"
 #include "viewer.h"
+#include "renderer.h"
+#include "outline.h"
 
 typedef struct _App App;
 
@@ -13,15 +15,29 @@ G_DECLARE_FINAL_TYPE(Window, window, JUMPDF, WINDOW, GtkApplicationWindow)
 Window *window_new(App *app);
 void window_open(Window *win, GFile *file, ViewerMarkManager *mark_manager);
 
+/* Runs keyval through the input state machine, as if it was pressed in win */
+void window_handle_key(Window *win, guint keyval, guint32 event_time);
+void window_set_search_text(Window *win, const gchar *search_text);
 void window_update_cursor(Window *win);
 void window_redraw(Window *win);
+void window_update_statusline(Window *win);
 void window_toggle_fullscreen(Window *win);
 void window_show_search_dialog(Window *win);
+/* Searches the text index of all documents with a mark manager */
+void window_show_text_search_dialog(Window *win);
+/* Lists the recently opened documents with a mark manager to open one of them */
+void window_show_quick_open_dialog(Window *win);
+void window_goto_page(Window *win, int page);
 void window_show_help_dialog(Window *win);
 void window_toggle_toc(Window *win);
 void window_focus_toc_search(Window *win);
-void window_execute_toc_row(Window *win, GtkListBoxRow *row);
+void window_execute_toc_selection(Window *win);
+void window_move_toc_selection(Window *win, int offset);
+void window_set_toc_selection_expanded(Window *win, bool expanded);
 
 ViewerMarkManager *window_get_mark_manager(Window *win);
 Viewer *window_get_viewer(Window *win);
-GtkListBox *window_get_toc_listbox(Window *win);
\ No newline at end of file
+Renderer *window_get_renderer(Window *win);
+const gchar *window_get_uri(Window *win);
+/* NULL if the cursor is before the first section, or the outline isn't loaded yet */
+const OutlineEntry *window_get_current_section(Window *win);